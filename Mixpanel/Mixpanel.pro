@@ -2,7 +2,7 @@ APP_NAME = Mixpanel
 VERSION = 1.0.0
 
 CONFIG += qt warn_on
-QT += network
+QT += network sql
 
 # uncomment for building static library
 # CONFIG += staticlib
@@ -34,22 +34,72 @@ config_pri_source_group1 {
     SOURCES += \
         $$quote($$BASEDIR/src/Mixpanel.cpp) \
         $$quote($$BASEDIR/src/MixpanelAnalyticsMessage.cpp) \
+        $$quote($$BASEDIR/src/MixpanelArena.cpp) \
+        $$quote($$BASEDIR/src/MixpanelBatchController.cpp) \
+        $$quote($$BASEDIR/src/MixpanelClock.cpp) \
         $$quote($$BASEDIR/src/MixpanelConfiguration.cpp) \
         $$quote($$BASEDIR/src/MixpanelConstants.cpp) \
+        $$quote($$BASEDIR/src/MixpanelDeadLetterStore.cpp) \
         $$quote($$BASEDIR/src/MixpanelEvent.cpp) \
+        $$quote($$BASEDIR/src/MixpanelEventBuilder.cpp) \
+        $$quote($$BASEDIR/src/MixpanelEventSampler.cpp) \
+        $$quote($$BASEDIR/src/MixpanelEventSchema.cpp) \
+        $$quote($$BASEDIR/src/MixpanelEventTimers.cpp) \
+        $$quote($$BASEDIR/src/MixpanelFileTransport.cpp) \
+        $$quote($$BASEDIR/src/MixpanelHttpTransport.cpp) \
+        $$quote($$BASEDIR/src/MixpanelImportSource.cpp) \
+        $$quote($$BASEDIR/src/MixpanelImporter.cpp) \
+        $$quote($$BASEDIR/src/MixpanelJsonWriter.cpp) \
+        $$quote($$BASEDIR/src/MixpanelLatencyHistogram.cpp) \
+        $$quote($$BASEDIR/src/MixpanelMemoryTransport.cpp) \
         $$quote($$BASEDIR/src/MixpanelMessageQueue.cpp) \
+        $$quote($$BASEDIR/src/MixpanelMessageRing.cpp) \
+        $$quote($$BASEDIR/src/MixpanelMessageStore.cpp) \
         $$quote($$BASEDIR/src/MixpanelPeople.cpp) \
-        $$quote($$BASEDIR/src/MixpanelPersistentIdentity.cpp)
+        $$quote($$BASEDIR/src/MixpanelPersistentIdentity.cpp) \
+        $$quote($$BASEDIR/src/MixpanelProfileCache.cpp) \
+        $$quote($$BASEDIR/src/MixpanelSettings.cpp) \
+        $$quote($$BASEDIR/src/MixpanelSettingsMessageStore.cpp) \
+        $$quote($$BASEDIR/src/MixpanelSqliteMessageStore.cpp) \
+        $$quote($$BASEDIR/src/MixpanelStringPool.cpp) \
+        $$quote($$BASEDIR/src/MixpanelThreadStaging.cpp) \
+        $$quote($$BASEDIR/src/MixpanelTransport.cpp) \
+        $$quote($$BASEDIR/src/MixpanelUploadScheduler.cpp)
 
     HEADERS += \
         $$quote($$BASEDIR/include/Mixpanel.hpp) \
         $$quote($$BASEDIR/include/MixpanelAnalyticsMessage.hpp) \
+        $$quote($$BASEDIR/include/MixpanelArena.hpp) \
+        $$quote($$BASEDIR/include/MixpanelBatchController.hpp) \
+        $$quote($$BASEDIR/include/MixpanelClock.hpp) \
         $$quote($$BASEDIR/include/MixpanelConfiguration.hpp) \
         $$quote($$BASEDIR/include/MixpanelConstants.hpp) \
+        $$quote($$BASEDIR/include/MixpanelDeadLetterStore.hpp) \
         $$quote($$BASEDIR/include/MixpanelEvent.hpp) \
+        $$quote($$BASEDIR/include/MixpanelEventBuilder.hpp) \
+        $$quote($$BASEDIR/include/MixpanelEventSampler.hpp) \
+        $$quote($$BASEDIR/include/MixpanelEventSchema.hpp) \
+        $$quote($$BASEDIR/include/MixpanelEventTimers.hpp) \
+        $$quote($$BASEDIR/include/MixpanelFileTransport.hpp) \
+        $$quote($$BASEDIR/include/MixpanelHttpTransport.hpp) \
+        $$quote($$BASEDIR/include/MixpanelImportSource.hpp) \
+        $$quote($$BASEDIR/include/MixpanelImporter.hpp) \
+        $$quote($$BASEDIR/include/MixpanelJsonWriter.hpp) \
+        $$quote($$BASEDIR/include/MixpanelLatencyHistogram.hpp) \
+        $$quote($$BASEDIR/include/MixpanelMemoryTransport.hpp) \
         $$quote($$BASEDIR/include/MixpanelMessageQueue.hpp) \
+        $$quote($$BASEDIR/include/MixpanelMessageRing.hpp) \
+        $$quote($$BASEDIR/include/MixpanelMessageStore.hpp) \
         $$quote($$BASEDIR/include/MixpanelPeople.hpp) \
         $$quote($$BASEDIR/include/MixpanelPersistentIdentity.hpp) \
+        $$quote($$BASEDIR/include/MixpanelProfileCache.hpp) \
+        $$quote($$BASEDIR/include/MixpanelSettings.hpp) \
+        $$quote($$BASEDIR/include/MixpanelSettingsMessageStore.hpp) \
+        $$quote($$BASEDIR/include/MixpanelSqliteMessageStore.hpp) \
+        $$quote($$BASEDIR/include/MixpanelStringPool.hpp) \
+        $$quote($$BASEDIR/include/MixpanelThreadStaging.hpp) \
+        $$quote($$BASEDIR/include/MixpanelTransport.hpp) \
+        $$quote($$BASEDIR/include/MixpanelUploadScheduler.hpp) \
         $$quote($$BASEDIR/include/mixpanel_global.hpp)
 }
 
@@ -11,6 +11,7 @@
 #include "mixpanel_global.hpp"
 
 #include "../include/MixpanelConfiguration.hpp"
+#include "../include/MixpanelMessageQueue.hpp"
 
 #include <QObject>
 #include <QByteArray>
@@ -19,7 +20,9 @@
 class MixpanelPrivate;
 class MixpanelPeople;
 class MixpanelEvent;
-class MixpanelMessageQueue;
+class MixpanelEventBuilder;
+class MixpanelImporter;
+class MixpanelImportSource;
 
 /// \mainpage Mixpanel BB10 Documentation
 ///
@@ -55,6 +58,8 @@ class MixpanelMessageQueue;
 ///
 ///     -Track events: in order to track events use trackEvent (see MixpanelEvent)
 ///
+///     -Timed events: call timeEvent before tracking an event to include its $duration (see MixpanelEventTimers)
+///
 ///     -Engage profile:
 ///             - Set properties: use setProfileProperties / setProfileProperty
 ///             - Increment property: use incrementProfileProperty
@@ -64,8 +69,21 @@ class MixpanelMessageQueue;
 ///     -Default profile information: In every engage profile analytic message Mixpanel BB10 library will add default information as device model,
 ///                                   OS version, App version...
 ///
+///     -Bulk import: Past events with their own timestamps can be sent to the /import endpoint with importEvents (see MixpanelImporter)
+///
 ///     -Configurations: The library allows to use different configuration to match the needs (see MixpanelConfiguration)
 ///
+/// Threads: trackEvent, tryTrackEvent, timeEvent, the profile updates, the super properties, setEventDistinctId,
+/// flush and shutdown can be called from any thread, the other methods only from the thread of the Mixpanel object:
+///     - The events tracked from other threads are encoded by the calling thread with its own MixpanelEvent and merged
+///       into the message queue by the thread of the Mixpanel object (see MixpanelThreadStaging), so the threads do
+///       not contend with each other. The rate limits are shared by all the threads (see MixpanelEventSampler),
+///       but the timers and the deduplication window apply per thread: timeEvent must be called from the thread
+///       that tracks the event, and identical events tracked by two threads are not discarded as duplicates.
+///     - The profile updates are queued to the thread of the Mixpanel object, in order, as they share the profile cache.
+///     - The identity changes apply right away to the events of the calling thread, and to the events of the other
+///       threads once the thread of the Mixpanel object has processed them.
+///
 
 class MIXPANEL_EXPORT Mixpanel: public QObject
 {
@@ -77,26 +95,38 @@ public:
 
     void setConfiguration(const MixpanelConfiguration& config);
     void setToken(const QString& token);
-    void setEventDistinctId(const QString& distinctId);
+    Q_INVOKABLE void setEventDistinctId(const QString& distinctId);
 
     MixpanelPeople& people() const;
     MixpanelEvent& event() const;
     MixpanelMessageQueue& messageQueue() const;
+    MixpanelImporter& importer() const;
+
+    void trackEvent(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+
+    MixpanelMessageQueue::AdmissionStatus tryTrackEvent(const QString& eventName, const QVariantMap& properties = QVariantMap(), const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    MixpanelMessageQueue::AdmissionStatus tryTrackEvent(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+
+    Q_INVOKABLE void setEventSampleRate(const QString& eventName, const double sampleRate);
+    Q_INVOKABLE void setEventRateLimit(const QString& eventName, const double eventsPerSecond, const int burstSize);
+
+    bool importEvents(MixpanelImportSource* source);
+    bool importEventsFile(const QString& filePath);
 
 public slots:
     void identify(const QString& distinctId);
 
-    void setProfileProperties(const QVariantMap& properties);
-    void setProfileProperty(const QString& propertyName, const QVariant& value);
+    void setProfileProperties(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    void setProfileProperty(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void setOnceProfileProperties(const QVariantMap& properties);
-    void setOnceProfileProperty(const QString& propertyName, const QVariant& value);
+    void setOnceProfileProperties(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    void setOnceProfileProperty(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void setCustomAction(const QVariantMap& actionProperties);
+    void setCustomAction(const QVariantMap& actionProperties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void incrementProfileProperty(const QString& property, const double& value);
+    void incrementProfileProperty(const QString& property, const double& value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void deleteUser();
+    void deleteUser(const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
     void registerSuperProperties(const QVariantMap& superProperties);
     void registerSuperPropertiesOnce(const QVariantMap& superProperties);
@@ -104,12 +134,18 @@ public slots:
     void unregisterSuperProperty(const QString& superPropertyName);
     void unregisterAllSuperProperties();
 
-    void trackEvent(const QString& eventName, const QVariantMap& properties = QVariantMap());
+    void timeEvent(const QString& eventName);
+    void trackEvent(const QString& eventName, const QVariantMap& properties = QVariantMap(), const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
     void flush();
+    void shutdown(const int deadlineMs);
 
     static QString convertToMixpanelDateFormat(const QDateTime& dateTime);
 
+private slots:
+    void appAboutToQuit();
+    void admissionChanged(MixpanelMessageQueue::AdmissionStatus admission);
+
 private:
     MixpanelPrivate * const d;
 };
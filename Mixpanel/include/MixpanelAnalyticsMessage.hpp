@@ -8,6 +8,7 @@
 #ifndef ANALYTICSMESSAGE_HPP_
 #define ANALYTICSMESSAGE_HPP_
 
+#include <QMetaType>
 #include <QNetworkRequest>
 #include <QSharedData>
 
@@ -27,8 +28,16 @@ public:
        Event    ///< Event message type
     };
 
+    /// An enumeration for the priority of analytics message.
+    enum Priority
+    {
+       NormalPriority = 0, ///< Batched with the other messages (default)
+       HighPriority        ///< Sent right away in a small batch, ahead of the normal messages
+    };
+
     MixpanelAnalyticsMessage();
-    MixpanelAnalyticsMessage(const MessageType, const QByteArray&);
+    MixpanelAnalyticsMessage(const MessageType, const QByteArray&, const Priority = NormalPriority);
+    MixpanelAnalyticsMessage(const MessageType, const QByteArray&, const Priority, const qint64 enqueueTime, const qint64 enqueueClock);
     MixpanelAnalyticsMessage(const MixpanelAnalyticsMessage &other);
     MixpanelAnalyticsMessage(const QVariantMap&);
     ~MixpanelAnalyticsMessage();
@@ -36,9 +45,25 @@ public:
 
     QNetworkRequest toNetworkRequest() const;
     QVariantMap toVariantMap() const;
+    QVariantMap toStorageMap() const;
+
+    MessageType type() const;
+    Priority priority() const;
+    QByteArray content() const;
+    QByteArray expandedContent() const;
+    static QByteArray expandedContent(const MessageType type, const QByteArray& content, const qint64 enqueueTime, const qint64 enqueueClock);
+    int contentSize() const;
+
+    qint64 enqueueTime() const;
+    qint64 enqueueClock() const;
+
+    qint64 storageId() const;
+    void setStorageId(const qint64 storageId);
 
 private:
     QSharedDataPointer <MixpanelAnalyticsMessagePrivate> d;
 };
 
+Q_DECLARE_METATYPE(MixpanelAnalyticsMessage::Priority)
+
 #endif /* ANALYTICSMESSAGE_HPP_ */
@@ -0,0 +1,75 @@
+/*
+ * MixpanelArena.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELARENA_HPP_
+#define MIXPANELARENA_HPP_
+
+#include <QByteArray>
+
+#include <string.h>
+
+/// \brief The MixpanelArena class is the reusable memory where a MixpanelEvent encodes its messages.
+///
+/// The bytes are appended at the end of a single buffer, which grows by doubling and is never shrunk:
+/// clear() only rewinds the end. Once the buffer has grown to the largest message of its thread,
+/// encoding a message allocates no memory.
+///
+/// It has the append() functions of QByteArray used by MixpanelJsonWriter, so it can be written the same way.
+///
+/// \note The bytes are valid until the next clear(). Use toByteArray() to keep a copy.
+///
+
+class MixpanelArena
+{
+public:
+    explicit MixpanelArena(const int capacity);
+    ~MixpanelArena();
+
+    void clear();
+
+    inline void append(const char c)
+    {
+        if (m_size == m_capacity)
+            grow(1);
+        m_data[m_size++] = c;
+    }
+
+    inline void append(const char* data, const int size)
+    {
+        if (m_size + size > m_capacity)
+            grow(size);
+        memcpy(m_data + m_size, data, size);
+        m_size += size;
+    }
+
+    inline void append(const char* data)
+    {
+        append(data, int(strlen(data)));
+    }
+
+    inline void append(const QByteArray& data)
+    {
+        append(data.constData(), data.size());
+    }
+
+    const char* constData() const;
+    int size() const;
+    int capacity() const;
+
+    QByteArray toByteArray() const;
+
+private:
+    Q_DISABLE_COPY(MixpanelArena)
+
+    void grow(const int size);
+
+    char* m_data;
+    int m_size;
+    int m_capacity;
+};
+
+#endif /* MIXPANELARENA_HPP_ */
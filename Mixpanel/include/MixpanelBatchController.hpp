@@ -0,0 +1,59 @@
+/*
+ * MixpanelBatchController.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELBATCHCONTROLLER_HPP_
+#define MIXPANELBATCHCONTROLLER_HPP_
+
+#include <QtGlobal>
+
+/// \brief The MixpanelBatchController class adapts the batch size and the in flight window to the link.
+///
+/// It follows an additive increase / multiplicative decrease scheme:
+///     - Every accepted batch whose round trip time stays under twice the minimum observed, floored
+///       to half the moving average, grows the batch size by g_batchSizeIncrement messages. The window grows by one batch once a whole
+///       window of batches has been accepted.
+///     - A batch that times out halves both values, a batch too large (HTTP 413) halves the batch
+///       size and a throttled batch (HTTP 429) halves the window. The minimum round trip time is
+///       learnt again after a back off, since the link has probably changed.
+///     - Other network errors stop the growth until the next accepted batch.
+///
+/// Both values are kept between the limits given with setLimits().
+///
+
+class MixpanelBatchController
+{
+public:
+    MixpanelBatchController();
+
+    void setLimits(const int minBatchSize, const int maxBatchSize, const int maxWindow);
+
+    int batchSize() const;
+    int window() const;
+    qint64 smoothedRoundTripTime() const;
+    qint64 backOffs() const;
+
+    void batchAccepted(const qint64 roundTripTime);
+    void batchFailed();
+    void batchTimedOut();
+    void batchTooLarge();
+    void batchThrottled();
+
+private:
+    void recordRoundTripTime(const qint64 roundTripTime);
+
+    int m_minBatchSize;
+    int m_maxBatchSize;
+    int m_maxWindow;
+    int m_batchSize;
+    int m_window;
+    int m_windowCredit;
+    qint64 m_minRoundTripTime;
+    qint64 m_smoothedRoundTripTime;
+    qint64 m_backOffs;
+};
+
+#endif /* MIXPANELBATCHCONTROLLER_HPP_ */
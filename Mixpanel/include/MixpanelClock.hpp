@@ -0,0 +1,71 @@
+/*
+ * MixpanelClock.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELCLOCK_HPP_
+#define MIXPANELCLOCK_HPP_
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+
+/// \brief The MixpanelClock class provides the time stamps of the analytic messages.
+///
+/// Reading the wall clock (QDateTime) converts the system time on every call. The clock reads it
+/// once, and then returns that time plus the monotonic time elapsed since, so every time stamp costs
+/// a single monotonic read. The wall clock is read again every g_clockSynchronisationInterval to
+/// follow the changes of the system time.
+///
+/// currentMSecsSinceEpoch() and elapsed() can be called from any thread. The wall clock offset is kept
+/// in two slots, the synchronisation writes the unused one and then publishes its index, so reading the
+/// time takes no lock. The server time is only sampled and read by the thread of the message queue.
+///
+/// elapsed() is the monotonic time shared by the timers of the library (see MixpanelEventTimers).
+///
+/// The device clock is often minutes or days off, so the clock also estimates the server time from
+/// the Date header of the Mixpanel replies (see addServerTimeSample). The estimate is an offset between
+/// the monotonic clock and the server time, smoothed over the samples, so it is not affected by the
+/// changes of the system time. The time stamps are recorded with the device clock and corrected with
+/// the estimate when the messages are sent (see MixpanelAnalyticsMessage::expandedContent).
+///
+
+class MixpanelClock
+{
+public:
+    static qint64 currentMSecsSinceEpoch();
+    static qint64 elapsed();
+    static qint64 nsecsElapsed();
+
+    static void synchronise();
+
+    static void addServerTimeSample(const qint64 serverTime, const qint64 roundTripTime);
+    static bool hasServerTime();
+    static qint64 serverTime(const qint64 monotonicTime);
+    static qint64 serverTimeOffset();
+    static void resetServerTime();
+
+private:
+    MixpanelClock();
+
+    static MixpanelClock& instance();
+
+    struct Synchronisation
+    {
+        qint64 wallClockOffset;
+        qint64 nextSynchronisation;
+    };
+
+    void synchronise(const qint64 now);
+
+    QElapsedTimer m_monotonicClock;
+    Synchronisation m_synchronisations[2];
+    QAtomicInt m_synchronisation;
+    QMutex m_synchronisationMutex;
+    qint64 m_serverClockOffset;
+    int m_serverTimeSamples;
+};
+
+#endif /* MIXPANELCLOCK_HPP_ */
@@ -37,6 +37,29 @@ public:
        Manual    ///< The user will manually call flush
     };
 
+    /// An enumeration for the storage engine of the pending analytics messages.
+    enum StorageEngine
+    {
+       SettingsStorage = 0, ///< The whole queue is saved into QSettings when the queue is destroyed (default)
+       SqliteStorage        ///< Every message is stored as soon as it is queued in a SQLite database
+    };
+
+    /// An enumeration for the messages dropped when the queue is over budget (see setMaxQueuedMessages).
+    enum DropPolicy
+    {
+       DropNewest = 0,      ///< The new messages are rejected (default)
+       DropOldest,          ///< The oldest queued messages are dropped to make room for the new ones
+       SampleByEventName    ///< Over the high watermark only one of every pressureSampleInterval events of each name is accepted
+    };
+
+    /// An enumeration for the transport the batches of analytics messages are sent with.
+    enum Transport
+    {
+       HttpTransport = 0,   ///< The batches are posted to the Mixpanel servers (default)
+       MemoryTransport,     ///< The batches are accepted and counted in memory, for tests and benchmarks
+       FileTransport        ///< The messages are appended as NDJSON to transportFilePath, for offline capture
+    };
+
     MixpanelConfiguration();
     MixpanelConfiguration(const MixpanelConfiguration &other);
     ~MixpanelConfiguration();
@@ -54,6 +77,87 @@ public:
     int messatesToFlush() const;
     void setMessagesToFlush(const int);
 
+    StorageEngine storageEngine() const;
+    void setStorageEngine(const StorageEngine);
+
+    int shutdownDeadline() const;
+    void setShutdownDeadline(const int);
+
+    int maxQueuedMessages() const;
+    void setMaxQueuedMessages(const int);
+
+    int maxQueuedBytes() const;
+    void setMaxQueuedBytes(const int);
+
+    DropPolicy dropPolicy() const;
+    void setDropPolicy(const DropPolicy);
+
+    int highWatermark() const;
+    void setHighWatermark(const int);
+
+    int lowWatermark() const;
+    void setLowWatermark(const int);
+
+    int pressureSampleInterval() const;
+    void setPressureSampleInterval(const int);
+
+    int deduplicationWindow() const;
+    void setDeduplicationWindow(const int);
+
+    int deduplicationWindowSize() const;
+    void setDeduplicationWindowSize(const int);
+
+    int connectTimeout() const;
+    void setConnectTimeout(const int);
+
+    int requestTimeout() const;
+    void setRequestTimeout(const int);
+
+    Transport transport() const;
+    void setTransport(const Transport);
+
+    QString transportFilePath() const;
+    void setTransportFilePath(const QString&);
+
+    int minBatchSize() const;
+    void setMinBatchSize(const int);
+
+    int maxBatchSize() const;
+    void setMaxBatchSize(const int);
+
+    int maxInFlightBatches() const;
+    void setMaxInFlightBatches(const int);
+
+    QString importUrl() const;
+    void setImportUrl(const QString&);
+
+    QString importApiSecret() const;
+    void setImportApiSecret(const QString&);
+
+    int importBatchSize() const;
+    void setImportBatchSize(const int);
+
+    int importParallelRequests() const;
+    void setImportParallelRequests(const int);
+
+    int maxDeadLetters() const;
+    void setMaxDeadLetters(const int);
+
+    qint64 eventTtl() const;
+    void setEventTtl(const qint64);
+
+    qint64 profileTtl() const;
+    void setProfileTtl(const qint64);
+
+    int maxPersistedMessages() const;
+    void setMaxPersistedMessages(const int);
+
+    int maxCachedProfiles() const;
+    void setMaxCachedProfiles(const int);
+
+    QString token() const;
+    void setToken(const QString&);
+
 
 private:
     QSharedDataPointer <MixpanelConfigurationPrivate> d;
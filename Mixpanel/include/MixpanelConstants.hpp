@@ -8,13 +8,50 @@
 #ifndef MIXPANELCONSTANTS_HPP_
 #define MIXPANELCONSTANTS_HPP_
 
+#include <QtGlobal>
+
 extern const char* g_urlEngageProfile;
 extern const char* g_urlTrackEvent;
 extern const char* g_organizationName;
 extern const char* g_superPropertiesKey;
 extern const char* g_peopleDistinctIdKey;
 extern const char* g_analyticsMessagesKey;
+extern const char* g_stringPoolKey;
+extern const char* g_sqliteQueueFileName;
+extern const char* g_sampleRateProperty;
+extern const char* g_durationProperty;
+extern const char* g_transportFileName;
+extern const char* g_deadLettersKey;
+extern const char* g_profileCacheKey;
 extern const int MAX_SIZE_QUEUE;
 extern const int g_defaultFlushInterval ;
+extern const int g_defaultShutdownDeadline;
+extern const int g_maxBatchSize;
+extern const int g_maxParallelRequests;
+extern const int g_maxSharedRequests;
+extern const int g_initialBatchSize;
+extern const int g_batchSizeIncrement;
+extern const int g_defaultDeduplicationWindowSize;
+extern const int g_defaultConnectTimeout;
+extern const int g_defaultRequestTimeout;
+extern const char* g_urlImport;
+extern const int g_maxImportBatchSize;
+extern const int g_maxImportBatchBytes;
+extern const int g_maxImportAttempts;
+extern const int g_importRetryDelay;
+extern const int g_maxDeadLetters;
+extern const qint64 g_defaultEventTtl;
+extern const int g_maxEventTimers;
+extern const int g_clockSynchronisationInterval;
+extern const int g_serverTimeSmoothing;
+extern const int g_maxServerTimeJump;
+extern const int g_minClockCorrection;
+extern const int g_maxCachedProfileProperties;
+extern const int g_profileCacheSyncDelay;
+extern const int g_stagingChunkSize;
+extern const int g_stagingLatency;
+extern const int g_arenaSize;
+extern const int g_messageSlabSize;
+extern const int g_messageStoreSyncDelay;
 
 #endif /* MIXPANELCONSTANTS_HPP_ */
@@ -0,0 +1,49 @@
+/*
+ * MixpanelDeadLetterStore.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELDEADLETTERSTORE_HPP_
+#define MIXPANELDEADLETTERSTORE_HPP_
+
+#include "MixpanelAnalyticsMessage.hpp"
+
+#include <QStringList>
+#include <QVariantList>
+
+/// \brief The MixpanelDeadLetterStore class quarantines the messages refused by the Mixpanel server.
+///
+/// The messages are kept expanded, with the reason they were refused and when, in QSettings so they
+/// survive the application restarts and can be inspected or reported. Only the last maxMessages
+/// messages are kept.
+///
+/// \note The store is written once per quarantined batch, which only happens when the server refuses
+///  records, so it stays out of the common path.
+///
+
+class MixpanelDeadLetterStore
+{
+public:
+    explicit MixpanelDeadLetterStore(const int maxMessages = 0);
+
+    void setMaxMessages(const int maxMessages);
+    void setStorageNamespace(const QString& storageNamespace);
+
+    void append(const QList<MixpanelAnalyticsMessage>& messages, const QStringList& errors);
+
+    QVariantList messages() const;
+    int size() const;
+    void clear();
+
+private:
+    void load() const;
+
+    int m_maxMessages;
+    QString m_storageNamespace;
+    mutable bool m_loaded;
+    mutable QVariantList m_messages;
+};
+
+#endif /* MIXPANELDEADLETTERSTORE_HPP_ */
@@ -8,15 +8,39 @@
 #ifndef MIXPANELEVENT_HPP_
 #define MIXPANELEVENT_HPP_
 
+#include <QDateTime>
 #include <QObject>
 
 #include "MixpanelPersistentIdentity.hpp"
+#include "MixpanelAnalyticsMessage.hpp"
 
+class MixpanelArena;
 class MixpanelEventPrivate;
+class MixpanelEventBuilder;
+class MixpanelEventSampler;
+class MixpanelEventTimers;
+
+/// \brief The MixpanelEventSink class receives the messages of a MixpanelEvent instead of its signal.
+///
+/// The message bytes live in the MixpanelArena of the event, reused for the next message, so they are only
+/// valid during the call: the sink copies them into storage of its own.
+///
+
+class MixpanelEventSink
+{
+public:
+    virtual ~MixpanelEventSink() {}
+
+    virtual void recordEventMessage(const char* eventMessage, const int size, const MixpanelAnalyticsMessage::Priority priority) = 0;
+};
 
 /// \brief The MixpanelEvent class provides an interface for using Mixpanel Event Analytics features.
 ///
-/// The recordEventMessage() signal is emitted whenever a event analytics message is tracked
+/// The recordEventMessage() signal is emitted whenever a event analytics message is tracked, unless
+/// a MixpanelEventSink is set.
+///
+/// The messages are encoded straight into a MixpanelArena owned by the event, so tracking an event
+/// builds no QVariantMap and, with a sink, allocates no memory once the arena has grown.
 ///
 
 class MixpanelEvent : public QObject
@@ -38,22 +62,41 @@ public:
 
     void setDistinctId(const QString& distinctId);
 
+    void setSink(MixpanelEventSink* sink);
+
     QString distinctId() const;
 
     MixpanelPersistentIdentity& persistentIdentity();
+    MixpanelEventSampler& sampler();
+    MixpanelEventTimers& timers();
+
+    void setDeduplicationWindow(const int window, const int maxEntries);
+    qint64 duplicateEvents() const;
+
+    void timeEvent(const QString& name);
 
-    void track(const QString& name, const QVariantMap& properties);
+    void track(const QString& name, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
     QByteArray stdTrackEvent(const QString& name, const QVariantMap& properties) const;
 
+    void track(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    QByteArray stdTrackEvent(const MixpanelEventBuilder& builder) const;
+
+    QByteArray stdImportEvent(const QString& name, const QVariantMap& properties, const QDateTime& time) const;
+
 private:
     bool eventHasErrors(const QString& eventName, const QVariantMap& properties);
+    bool isDuplicate(const quint64 eventHash);
+    QByteArray stdEvent(const QString& name, const QVariantMap& properties, const QVariant& time) const;
+    void recordMessage(const MixpanelAnalyticsMessage::Priority priority);
+
+    static QByteArray nextInsertId();
 
 signals:
 
     /// This signal is emitted when a valid event analytic message
     /// has to be recorded in order to be posted to the Mixpanel server.
     ///
-    void recordEventMessage(const QByteArray& eventMessage);
+    void recordEventMessage(const QByteArray& eventMessage, const MixpanelAnalyticsMessage::Priority priority);
 
     /// This signal is emitted when in invalid event message has
     /// failed to be recorded due an error.
@@ -0,0 +1,71 @@
+/*
+ * MixpanelEventBuilder.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELEVENTBUILDER_HPP_
+#define MIXPANELEVENTBUILDER_HPP_
+
+#include "mixpanel_global.hpp"
+
+#include <QByteArray>
+#include <QString>
+#include <QVarLengthArray>
+
+/// \brief The MixpanelEventBuilder class builds an event without going through QVariantMap.
+///
+/// It is meant to be created on the stack in hot paths (e.g. render loops). Every typed add()
+/// call writes the property straight into the JSON encoding buffer, so no QVariant boxing nor
+/// map node allocations are done per property.
+///
+/// The event is committed with MixpanelEvent::track(const MixpanelEventBuilder&) or
+/// Mixpanel::trackEvent(const MixpanelEventBuilder&):
+///
+///     MixpanelEventBuilder builder("Frame rendered");
+///     builder.add("fps", 59.7).add("dropped frames", 2).add("vsync", true);
+///     mixpanel->trackEvent(builder);
+///
+/// \note Super properties, referrer properties, token, distinct id and time are merged when the event
+///  is tracked, with the same precedence than MixpanelEvent::track(). The "token", "distinct_id" and "time"
+///  keys are reserved and ignored here. If a key is added twice, the first value is kept.
+///  A key or string value that is not valid Unicode (see MixpanelJsonWriter) makes the whole event
+///  invalid, it is rejected when tracked.
+///
+
+class MIXPANEL_EXPORT MixpanelEventBuilder
+{
+public:
+    explicit MixpanelEventBuilder(const QString& eventName);
+
+    MixpanelEventBuilder& add(const QString& key, int value);
+    MixpanelEventBuilder& add(const QString& key, qint64 value);
+    MixpanelEventBuilder& add(const QString& key, double value);
+    MixpanelEventBuilder& add(const QString& key, bool value);
+    MixpanelEventBuilder& add(const QString& key, const QString& value);
+    MixpanelEventBuilder& add(const QString& key, const QByteArray& value);
+    MixpanelEventBuilder& add(const QString& key, const char* value);
+
+    QString name() const;
+    bool contains(const QString& key) const;
+    bool isEmpty() const;
+    bool isValid() const;
+
+    const QByteArray& encodedProperties() const;
+
+    static bool isReservedKey(const QString& key);
+
+    QByteArray& beginEncodedProperty(const QString& key, const char* encodedKey, int size);
+    void endEncodedProperty(bool valid);
+
+private:
+    bool beginProperty(const QString& key);
+
+    QString m_name;
+    QByteArray m_properties;
+    QVarLengthArray<QString, 16> m_keys;
+    bool m_valid;
+};
+
+#endif /* MIXPANELEVENTBUILDER_HPP_ */
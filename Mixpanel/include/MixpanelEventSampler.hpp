@@ -0,0 +1,80 @@
+/*
+ * MixpanelEventSampler.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELEVENTSAMPLER_HPP_
+#define MIXPANELEVENTSAMPLER_HPP_
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+/// \brief The MixpanelEventSampler class decides, before an event is encoded, whether it is tracked.
+///
+/// Every event name can have:
+///     - A sample rate: the fraction of users that track the event. The decision is a deterministic
+///       hash of the event name and the distinct id, so a given user tracks all or none of the
+///       occurrences of a sampled event and the sampled funnels are still consistent.
+///     - A rate limit: a token bucket that allows at most eventsPerSecond events with bursts of
+///       burstSize events.
+///
+/// Events without rules are always accepted. The sample rate applied is returned so it can be
+/// stamped into the event properties (g_sampleRateProperty) and the server side counts re-weighted.
+///
+/// The copies of a sampler share the token buckets of its rate limits, so the copies read by the
+/// threads tracking events (see MixpanelThreadStaging) draw from the same budget. Every bucket has its
+/// own lock, taken only by the events of its rule.
+///
+/// \note Rejecting an event costs a hash lookup on its name, the distinct id hash is cached.
+///
+
+class MixpanelEventSampler
+{
+public:
+    MixpanelEventSampler();
+
+    void setSampleRate(const QString& eventName, const double sampleRate);
+    void setRateLimit(const QString& eventName, const double eventsPerSecond, const int burstSize);
+    void removeRules(const QString& eventName);
+    void clear();
+
+    bool accept(const QString& eventName, const QString& distinctId, double& sampleRate);
+
+    qint64 sampledEvents() const;
+    qint64 rateLimitedEvents() const;
+
+private:
+    struct RateLimit
+    {
+        QMutex mutex;
+        double eventsPerSecond;
+        double burstSize;
+        double tokens;
+        qint64 lastRefill;
+    };
+
+    struct Rule
+    {
+        Rule();
+
+        double sampleRate;
+        quint32 sampleThreshold;
+        quint32 nameHash;
+        QSharedPointer<RateLimit> rateLimit;
+    };
+
+    Rule& rule(const QString& eventName);
+    quint32 distinctIdHash(const QString& distinctId);
+
+    QHash<QString, Rule> m_rules;
+    QString m_distinctId;
+    quint32 m_distinctIdHash;
+    qint64 m_sampledEvents;
+    qint64 m_rateLimitedEvents;
+};
+
+#endif /* MIXPANELEVENTSAMPLER_HPP_ */
@@ -0,0 +1,367 @@
+/*
+ * MixpanelEventSchema.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELEVENTSCHEMA_HPP_
+#define MIXPANELEVENTSCHEMA_HPP_
+
+#include "mixpanel_global.hpp"
+
+#include "MixpanelEventBuilder.hpp"
+#include "MixpanelJsonWriter.hpp"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/// \brief The MixpanelSchemaValue template provides the serializer of a property type.
+///
+/// Only the specialized types can be used in an event schema, any other type fails to compile.
+/// The write() function returns false if the value is not valid Unicode text.
+///
+
+template <typename T>
+struct MixpanelSchemaValue;
+
+template <>
+struct MixpanelSchemaValue<int>
+{
+    typedef int ArgType;
+    static bool write(QByteArray& out, ArgType value) { MixpanelJsonWriter::appendNumber(out, value); return true; }
+};
+
+template <>
+struct MixpanelSchemaValue<qint64>
+{
+    typedef qint64 ArgType;
+    static bool write(QByteArray& out, ArgType value) { MixpanelJsonWriter::appendNumber(out, value); return true; }
+};
+
+template <>
+struct MixpanelSchemaValue<double>
+{
+    typedef double ArgType;
+    static bool write(QByteArray& out, ArgType value) { MixpanelJsonWriter::appendNumber(out, value); return true; }
+};
+
+template <>
+struct MixpanelSchemaValue<bool>
+{
+    typedef bool ArgType;
+    static bool write(QByteArray& out, ArgType value) { MixpanelJsonWriter::appendBool(out, value); return true; }
+};
+
+template <>
+struct MixpanelSchemaValue<QString>
+{
+    typedef const QString& ArgType;
+    static bool write(QByteArray& out, ArgType value) { return MixpanelJsonWriter::appendString(out, value); }
+};
+
+template <>
+struct MixpanelSchemaValue<QByteArray>
+{
+    typedef const QByteArray& ArgType;
+    static bool write(QByteArray& out, ArgType value) { return MixpanelJsonWriter::appendUtf8String(out, value); }
+};
+
+/// \brief The MixpanelSchemaKeys class holds the pre-escaped keys of an event schema.
+///
+/// The keys of a schema are escaped only once, when the schema is used for the first time, and
+/// stored contiguously. Building an event from a schema only copies those bytes and formats the values.
+///
+
+class MIXPANEL_EXPORT MixpanelSchemaKeys
+{
+public:
+    MixpanelSchemaKeys(const char* eventName, const char* const* keys, int count);
+
+    const QString& name() const;
+
+    bool isValid(int index) const;
+    const QString& key(int index) const;
+    const char* encodedKey(int index) const;
+    int encodedKeySize(int index) const;
+
+private:
+    QString m_name;
+    QVector<QString> m_keys;
+    QByteArray m_encodedKeys;
+    QVector<int> m_offsets;
+};
+
+/// Fails to compile if the key is not a non empty string literal
+#define MIXPANEL_SCHEMA_CHECK_KEY(index, key) \
+    typedef char MixpanelSchemaKeyCheck##index[(sizeof("" key "") > 1) ? 1 : -1];
+
+/// Writes a schema property into the builder
+#define MIXPANEL_SCHEMA_WRITE(index, T, value) \
+    if (schemaKeys.isValid(index)) \
+        builder.endEncodedProperty(MixpanelSchemaValue<T>::write(builder.beginEncodedProperty(schemaKeys.key(index), \
+                schemaKeys.encodedKey(index), schemaKeys.encodedKeySize(index)), value));
+
+/// \brief The MIXPANEL_EVENT_SCHEMA_N macros declare an event with a fixed shape.
+///
+/// The schema declares the event name and the type and key of every property. The keys must
+/// be non empty string literals and the types must be supported by MixpanelSchemaValue, both are checked
+/// at compile time. Reserved or duplicated keys are reported the first time the schema is used.
+///
+/// The declared struct provides a build() function taking one typed argument per property, in the
+/// declared order, that returns a MixpanelEventBuilder ready to be tracked. Schemas have up to 8
+/// properties, larger events can add the others to the returned builder:
+///
+///     MIXPANEL_EVENT_SCHEMA_2(LevelCompleteEvent, "Level Complete",
+///                             int, "Level Number",
+///                             QString, "Difficulty")
+///
+///     mixpanel->trackEvent(LevelCompleteEvent::build(9, "Hard"));
+///
+
+#define MIXPANEL_EVENT_SCHEMA_1(Schema, eventName, T0, key0) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 1); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_2(Schema, eventName, T0, key0, T1, key1) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 2); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_3(Schema, eventName, T0, key0, T1, key1, T2, key2) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 3); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_4(Schema, eventName, T0, key0, T1, key1, T2, key2, T3, key3) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        MIXPANEL_SCHEMA_CHECK_KEY(3, key3) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2, key3 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 4); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2, \
+                                          MixpanelSchemaValue<T3>::ArgType v3) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            MIXPANEL_SCHEMA_WRITE(3, T3, v3) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_5(Schema, eventName, T0, key0, T1, key1, T2, key2, T3, key3, T4, key4) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        MIXPANEL_SCHEMA_CHECK_KEY(3, key3) \
+        MIXPANEL_SCHEMA_CHECK_KEY(4, key4) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2, key3, key4 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 5); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2, \
+                                          MixpanelSchemaValue<T3>::ArgType v3, \
+                                          MixpanelSchemaValue<T4>::ArgType v4) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            MIXPANEL_SCHEMA_WRITE(3, T3, v3) \
+            MIXPANEL_SCHEMA_WRITE(4, T4, v4) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_6(Schema, eventName, T0, key0, T1, key1, T2, key2, T3, key3, T4, key4, T5, key5) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        MIXPANEL_SCHEMA_CHECK_KEY(3, key3) \
+        MIXPANEL_SCHEMA_CHECK_KEY(4, key4) \
+        MIXPANEL_SCHEMA_CHECK_KEY(5, key5) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2, key3, key4, key5 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 6); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2, \
+                                          MixpanelSchemaValue<T3>::ArgType v3, \
+                                          MixpanelSchemaValue<T4>::ArgType v4, \
+                                          MixpanelSchemaValue<T5>::ArgType v5) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            MIXPANEL_SCHEMA_WRITE(3, T3, v3) \
+            MIXPANEL_SCHEMA_WRITE(4, T4, v4) \
+            MIXPANEL_SCHEMA_WRITE(5, T5, v5) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_7(Schema, eventName, T0, key0, T1, key1, T2, key2, T3, key3, T4, key4, T5, key5, T6, key6) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        MIXPANEL_SCHEMA_CHECK_KEY(3, key3) \
+        MIXPANEL_SCHEMA_CHECK_KEY(4, key4) \
+        MIXPANEL_SCHEMA_CHECK_KEY(5, key5) \
+        MIXPANEL_SCHEMA_CHECK_KEY(6, key6) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2, key3, key4, key5, key6 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 7); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2, \
+                                          MixpanelSchemaValue<T3>::ArgType v3, \
+                                          MixpanelSchemaValue<T4>::ArgType v4, \
+                                          MixpanelSchemaValue<T5>::ArgType v5, \
+                                          MixpanelSchemaValue<T6>::ArgType v6) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            MIXPANEL_SCHEMA_WRITE(3, T3, v3) \
+            MIXPANEL_SCHEMA_WRITE(4, T4, v4) \
+            MIXPANEL_SCHEMA_WRITE(5, T5, v5) \
+            MIXPANEL_SCHEMA_WRITE(6, T6, v6) \
+            return builder; \
+        } \
+    };
+
+#define MIXPANEL_EVENT_SCHEMA_8(Schema, eventName, T0, key0, T1, key1, T2, key2, T3, key3, T4, key4, T5, key5, T6, key6, T7, key7) \
+    struct Schema \
+    { \
+        MIXPANEL_SCHEMA_CHECK_KEY(Name, eventName) \
+        MIXPANEL_SCHEMA_CHECK_KEY(0, key0) \
+        MIXPANEL_SCHEMA_CHECK_KEY(1, key1) \
+        MIXPANEL_SCHEMA_CHECK_KEY(2, key2) \
+        MIXPANEL_SCHEMA_CHECK_KEY(3, key3) \
+        MIXPANEL_SCHEMA_CHECK_KEY(4, key4) \
+        MIXPANEL_SCHEMA_CHECK_KEY(5, key5) \
+        MIXPANEL_SCHEMA_CHECK_KEY(6, key6) \
+        MIXPANEL_SCHEMA_CHECK_KEY(7, key7) \
+        static const MixpanelSchemaKeys& keys() \
+        { \
+            static const char* const keyNames[] = { key0, key1, key2, key3, key4, key5, key6, key7 }; \
+            static const MixpanelSchemaKeys schemaKeys(eventName, keyNames, 8); \
+            return schemaKeys; \
+        } \
+        static MixpanelEventBuilder build(MixpanelSchemaValue<T0>::ArgType v0, \
+                                          MixpanelSchemaValue<T1>::ArgType v1, \
+                                          MixpanelSchemaValue<T2>::ArgType v2, \
+                                          MixpanelSchemaValue<T3>::ArgType v3, \
+                                          MixpanelSchemaValue<T4>::ArgType v4, \
+                                          MixpanelSchemaValue<T5>::ArgType v5, \
+                                          MixpanelSchemaValue<T6>::ArgType v6, \
+                                          MixpanelSchemaValue<T7>::ArgType v7) \
+        { \
+            const MixpanelSchemaKeys& schemaKeys = keys(); \
+            MixpanelEventBuilder builder(schemaKeys.name()); \
+            MIXPANEL_SCHEMA_WRITE(0, T0, v0) \
+            MIXPANEL_SCHEMA_WRITE(1, T1, v1) \
+            MIXPANEL_SCHEMA_WRITE(2, T2, v2) \
+            MIXPANEL_SCHEMA_WRITE(3, T3, v3) \
+            MIXPANEL_SCHEMA_WRITE(4, T4, v4) \
+            MIXPANEL_SCHEMA_WRITE(5, T5, v5) \
+            MIXPANEL_SCHEMA_WRITE(6, T6, v6) \
+            MIXPANEL_SCHEMA_WRITE(7, T7, v7) \
+            return builder; \
+        } \
+    };
+
+#endif /* MIXPANELEVENTSCHEMA_HPP_ */
@@ -0,0 +1,46 @@
+/*
+ * MixpanelEventTimers.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELEVENTTIMERS_HPP_
+#define MIXPANELEVENTTIMERS_HPP_
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+/// \brief The MixpanelEventTimers class measures the time between MixpanelEvent::timeEvent and the
+/// tracking of the event, which is sent as its $duration property.
+///
+/// Every timer is the event name and its start time on the monotonic clock (MixpanelClock::elapsed).
+/// The name is shared with the string given to start(), so thousands of timers are cheap to keep. The
+/// timers are kept in a ring of maxTimers entries: when it is full, starting a timer discards the oldest one.
+///
+
+class MixpanelEventTimers
+{
+public:
+    explicit MixpanelEventTimers(const int maxTimers = 0);
+
+    void setMaxTimers(const int maxTimers);
+
+    void start(const QString& eventName);
+    qint64 take(const QString& eventName);
+    void cancel(const QString& eventName);
+    void clear();
+
+    int size() const;
+    qint64 discardedTimers() const;
+
+private:
+    QVector<QPair<QString, qint64> > m_timers;
+    int m_head;
+    QHash<QString, qint64> m_startTimes;
+    qint64 m_discardedTimers;
+};
+
+#endif /* MIXPANELEVENTTIMERS_HPP_ */
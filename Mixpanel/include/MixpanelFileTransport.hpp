@@ -0,0 +1,45 @@
+/*
+ * MixpanelFileTransport.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELFILETRANSPORT_HPP_
+#define MIXPANELFILETRANSPORT_HPP_
+
+#include "MixpanelTransport.hpp"
+
+#include <QFile>
+
+/// \brief The MixpanelFileTransport class appends the batches to a NDJSON file.
+///
+/// Every message is written expanded, as the JSON object that would be sent to Mixpanel, in its own
+/// line. The file can be inspected offline or replayed later.
+///
+/// \note Batches are finished synchronously: Accepted when they are written and flushed, Failed otherwise.
+///
+
+class MixpanelFileTransport : public MixpanelTransport
+{
+    Q_OBJECT
+public:
+    explicit MixpanelFileTransport(const QString& filePath = QString(), QObject* parent = 0);
+    virtual ~MixpanelFileTransport();
+
+    virtual MixpanelConfiguration::Transport type() const;
+    virtual void setConfiguration(const MixpanelConfiguration& config);
+
+    virtual void send(const int batchId, const MixpanelMessageBatch& batch);
+    virtual void abort(const int batchId);
+
+    QString fileName() const;
+
+private:
+    void open(const QString& filePath);
+
+private:
+    QFile m_file;
+};
+
+#endif /* MIXPANELFILETRANSPORT_HPP_ */
@@ -0,0 +1,70 @@
+/*
+ * MixpanelHttpTransport.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELHTTPTRANSPORT_HPP_
+#define MIXPANELHTTPTRANSPORT_HPP_
+
+#include "MixpanelTransport.hpp"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+class QNetworkReply;
+
+/// \brief The MixpanelHttpTransport class posts the batches to the Mixpanel servers.
+///
+/// Every batch is a POST request (see MixpanelAnalyticsMessage::toNetworkRequest) asking for the verbose
+/// JSON reply of the Mixpanel API, which is parsed by parseResponse(). The Date header of the replies is
+/// reported with the serverTimeReceived() signal.
+///
+/// The requests are posted by the MixpanelUploadScheduler, which shares the connections and the number of
+/// requests in flight between the transports of all the Mixpanel instances.
+///
+/// \note A request is aborted and reported as TimedOut when it has not uploaded data nor received the
+///  reply headers after MixpanelConfiguration::connectTimeout, or has not finished after
+///  MixpanelConfiguration::requestTimeout.
+///
+
+class MixpanelHttpTransport : public MixpanelTransport
+{
+    Q_OBJECT
+public:
+    explicit MixpanelHttpTransport(QObject* parent = 0);
+    virtual ~MixpanelHttpTransport();
+
+    virtual MixpanelConfiguration::Transport type() const;
+    virtual void setConfiguration(const MixpanelConfiguration& config);
+
+    virtual void send(const int batchId, const MixpanelMessageBatch& batch);
+    virtual void abort(const int batchId);
+
+    static BatchResult parseResponse(const QByteArray& response, QVariantList& recordErrors);
+    static qint64 parseDate(const QByteArray& date);
+
+private slots:
+    void requestUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void requestMetaDataChanged();
+    void requestTimerTimeout();
+
+private:
+    friend class MixpanelUploadScheduler;
+
+    void requestStarted(const int batchId, QNetworkReply* reply);
+    void requestFinished(QNetworkReply* reply);
+    void startRequestTimer(QNetworkReply* reply);
+
+    QHash<QNetworkReply*, int> m_batchIds;
+    QHash<QNetworkReply*, qint64> m_sendTimes;
+    QSet<QNetworkReply*> m_connectedRequests;
+    QSet<QNetworkReply*> m_timedOutRequests;
+    QElapsedTimer m_clock;
+    int m_connectTimeout;
+    int m_requestTimeout;
+};
+
+#endif /* MIXPANELHTTPTRANSPORT_HPP_ */
@@ -0,0 +1,68 @@
+/*
+ * MixpanelImportSource.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELIMPORTSOURCE_HPP_
+#define MIXPANELIMPORTSOURCE_HPP_
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+/// \brief The MixpanelImportSource class is the iterator the MixpanelImporter reads the events from.
+///
+/// Every event is a JSON object as sent to Mixpanel, with its own "time" property
+/// (see MixpanelEvent::stdImportEvent). The events are read as the batches are built, so a source
+/// does not need to hold the whole event set in memory.
+///
+
+class MixpanelImportSource
+{
+public:
+    virtual ~MixpanelImportSource();
+
+    /// Reads the next event, returns false when there are no more events.
+    virtual bool next(QByteArray& event) = 0;
+};
+
+/// \brief The MixpanelListImportSource class imports a list of events held in memory.
+
+class MixpanelListImportSource : public MixpanelImportSource
+{
+public:
+    MixpanelListImportSource();
+    explicit MixpanelListImportSource(const QList<QByteArray>& events);
+
+    void append(const QByteArray& event);
+    int size() const;
+
+    virtual bool next(QByteArray& event);
+
+private:
+    QList<QByteArray> m_events;
+    int m_position;
+};
+
+/// \brief The MixpanelFileImportSource class imports a NDJSON file, one event per line.
+///
+/// \note The files written by the MixpanelFileTransport can be imported as they are. Empty lines are skipped.
+///
+
+class MixpanelFileImportSource : public MixpanelImportSource
+{
+public:
+    explicit MixpanelFileImportSource(const QString& filePath);
+    virtual ~MixpanelFileImportSource();
+
+    bool isOpen() const;
+
+    virtual bool next(QByteArray& event);
+
+private:
+    QFile m_file;
+};
+
+#endif /* MIXPANELIMPORTSOURCE_HPP_ */
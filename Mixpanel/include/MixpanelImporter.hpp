@@ -0,0 +1,100 @@
+/*
+ * MixpanelImporter.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELIMPORTER_HPP_
+#define MIXPANELIMPORTER_HPP_
+
+#include "MixpanelConfiguration.hpp"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QVariantMap>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class MixpanelImportSource;
+
+/// \brief The MixpanelImporter class sends large sets of past events to the Mixpanel /import endpoint.
+///
+/// Unlike the events tracked with MixpanelEvent, the imported events keep the time they were
+/// recorded at and bypass the message queue:
+///     - The events are streamed from a MixpanelImportSource, a batch at a time.
+///     - Every batch holds up to MixpanelConfiguration::importBatchSize events and g_maxImportBatchBytes
+///       bytes, and is sent gzip compressed to MixpanelConfiguration::importUrl.
+///     - Up to MixpanelConfiguration::importParallelRequests batches are in flight at once.
+///     - Batches failing due network errors, throttling (HTTP 429) or server errors are sent again
+///       after g_importRetryDelay, up to g_maxImportAttempts times. Other failures are counted as failed events.
+///
+/// The importProgress() signal reports the throughput after every batch and importFinished() the totals.
+///
+
+class MixpanelImporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MixpanelImporter(QObject* parent = 0, const MixpanelConfiguration& config = MixpanelConfiguration());
+    virtual ~MixpanelImporter();
+
+    void setConfiguration(const MixpanelConfiguration& config);
+
+    bool start(MixpanelImportSource* source);
+    void cancel();
+    bool isRunning() const;
+
+    qint64 importedEvents() const;
+    qint64 failedEvents() const;
+    double eventsPerSecond() const;
+    QVariantMap statistics() const;
+
+    static QByteArray gzipCompress(const QByteArray& data);
+
+signals:
+
+    /// This signal is emitted when a batch finishes, with the events imported so far and the throughput.
+    ///
+    void importProgress(qint64 importedEvents, double eventsPerSecond);
+
+    /// This signal is emitted when all the events of the source have been sent or the import is cancelled.
+    ///
+    void importFinished(qint64 importedEvents, qint64 failedEvents);
+
+private slots:
+    void postBatches();
+    void networkRequestFinished(QNetworkReply* reply);
+
+private:
+    struct Batch
+    {
+        Batch();
+
+        QByteArray content;
+        int events;
+        int attempts;
+        qint64 notBefore;
+    };
+
+    bool readBatch(Batch& batch);
+    void postBatch(Batch& batch);
+    void finish();
+
+    QNetworkAccessManager* m_networkAccessManager;
+    MixpanelConfiguration m_configuration;
+    MixpanelImportSource* m_source;
+    QByteArray m_nextEvent;
+    QHash<QNetworkReply*, Batch> m_inFlightBatches;
+    QList<Batch> m_retryBatches;
+    QElapsedTimer m_clock;
+    qint64 m_duration;
+    qint64 m_importedEvents;
+    qint64 m_failedEvents;
+    qint64 m_sentBytes;
+    qint64 m_retries;
+};
+
+#endif /* MIXPANELIMPORTER_HPP_ */
@@ -0,0 +1,55 @@
+/*
+ * MixpanelJsonWriter.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELJSONWRITER_HPP_
+#define MIXPANELJSONWRITER_HPP_
+
+#include "mixpanel_global.hpp"
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+/// \brief The MixpanelJsonWriter class appends JSON tokens straight into a byte buffer.
+///
+/// It is used by the event and people encoders instead of JsonDataAccess, so that the tracked events
+/// (see MixpanelEventBuilder) need no intermediate QVariantMap and every analytic message writes its
+/// numbers the same way: doubles with the shortest digits that read back as the same value, NaN and
+/// infinity as null.
+///
+/// The buffer is a QByteArray or a MixpanelArena. Strings are transcoded to UTF-8 and numbers
+/// formatted straight into the buffer, so the writer itself allocates no memory.
+///
+/// \note The functions appending strings return false when the text is not valid Unicode (a lone
+///  surrogate in a QString, a malformed UTF-8 sequence in a QByteArray). The buffer is still valid JSON,
+///  the invalid units are written as U+FFFD, but the encoders reject the message instead of sending a
+///  text that is not the one given.
+///
+
+class MIXPANEL_EXPORT MixpanelJsonWriter
+{
+public:
+    template <typename Output> static bool appendString(Output& out, const QString& value);
+    template <typename Output> static bool appendUtf8String(Output& out, const QByteArray& value);
+    template <typename Output> static bool appendKey(Output& out, const QString& key);
+
+    template <typename Output> static void appendNumber(Output& out, int value);
+    template <typename Output> static void appendNumber(Output& out, qint64 value);
+    template <typename Output> static void appendNumber(Output& out, quint64 value);
+    template <typename Output> static void appendNumber(Output& out, double value);
+
+    template <typename Output> static void appendBool(Output& out, bool value);
+    template <typename Output> static void appendNull(Output& out);
+
+    template <typename Output> static bool appendVariant(Output& out, const QVariant& value);
+    template <typename Output> static bool appendVariantMap(Output& out, const QVariantMap& map);
+
+private:
+    MixpanelJsonWriter();
+};
+
+#endif /* MIXPANELJSONWRITER_HPP_ */
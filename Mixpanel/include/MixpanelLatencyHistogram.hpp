@@ -0,0 +1,51 @@
+/*
+ * MixpanelLatencyHistogram.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELLATENCYHISTOGRAM_HPP_
+#define MIXPANELLATENCYHISTOGRAM_HPP_
+
+#include <QVariant>
+
+/// \brief The MixpanelLatencyHistogram class records latencies in logarithmic buckets.
+///
+/// Bucket 0 counts the latencies under 1 ms and bucket i the ones in [2^(i-1), 2^i) ms, the
+/// last bucket also counts everything over its lower bound. Recording a value is a couple of
+/// integer operations and the memory used is constant, so it can be kept for the whole session.
+///
+/// \note The percentiles are estimated with the upper bound of the bucket where they fall.
+///
+
+class MixpanelLatencyHistogram
+{
+public:
+    enum
+    {
+        BucketCount = 24  ///< Number of buckets, the last one starts at ~70 minutes
+    };
+
+    MixpanelLatencyHistogram();
+
+    void record(const qint64 latencyMs);
+    void clear();
+
+    qint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    double mean() const;
+    qint64 percentile(const double fraction) const;
+
+    QVariantMap toVariantMap() const;
+
+private:
+    qint64 m_buckets[BucketCount];
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+};
+
+#endif /* MIXPANELLATENCYHISTOGRAM_HPP_ */
@@ -0,0 +1,54 @@
+/*
+ * MixpanelMemoryTransport.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELMEMORYTRANSPORT_HPP_
+#define MIXPANELMEMORYTRANSPORT_HPP_
+
+#include "MixpanelTransport.hpp"
+
+/// \brief The MixpanelMemoryTransport class delivers the batches in memory.
+///
+/// Every batch is finished synchronously with the configured result, so the message queue can be
+/// exercised and profiled without network. The transport counts the batches, messages and bytes
+/// received and, if asked to, keeps the messages of the accepted batches.
+///
+
+class MixpanelMemoryTransport : public MixpanelTransport
+{
+    Q_OBJECT
+public:
+    explicit MixpanelMemoryTransport(QObject* parent = 0);
+    virtual ~MixpanelMemoryTransport();
+
+    virtual MixpanelConfiguration::Transport type() const;
+
+    virtual void send(const int batchId, const MixpanelMessageBatch& batch);
+    virtual void abort(const int batchId);
+
+    void setResult(const BatchResult result);
+    void setRecordErrors(const QVariantList& recordErrors);
+    void setRejectedContent(const QByteArray& rejectedContent);
+    void setKeepMessages(const bool keepMessages);
+
+    QList<MixpanelAnalyticsMessage> messages() const;
+    qint64 batchCount() const;
+    qint64 messageCount() const;
+    qint64 byteCount() const;
+    void clear();
+
+private:
+    BatchResult m_result;
+    QVariantList m_recordErrors;
+    QByteArray m_rejectedContent;
+    bool m_keepMessages;
+    QList<MixpanelAnalyticsMessage> m_messages;
+    qint64 m_batchCount;
+    qint64 m_messageCount;
+    qint64 m_byteCount;
+};
+
+#endif /* MIXPANELMEMORYTRANSPORT_HPP_ */
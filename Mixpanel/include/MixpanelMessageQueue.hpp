@@ -11,11 +11,12 @@
 #include "../include/MixpanelConfiguration.hpp"
 
 #include <QObject>
-#include <QNetworkReply>
 
 #include "MixpanelAnalyticsMessage.hpp"
+#include "MixpanelTransport.hpp"
 
 class MixpanelMessageQueuePrivate;
+class MixpanelMessageRing;
 
 /// \brief The MixpanelMessageQueue class manages communication of analytic messages to the servers.
 ///
@@ -35,14 +36,33 @@ public:
        NoError             ///< No error.
     };
 
+    /// An enumeration for the admission of new events (see admit()).
+    enum AdmissionStatus
+    {
+       Accepted = 0,       ///< The event can be tracked
+       Sampled,            ///< The event has been sampled out because the queue is under pressure
+       Rejected            ///< The event has been rejected because the queue is over budget
+    };
+
     MixpanelMessageQueue(QObject *parent = 0, MixpanelConfiguration config = MixpanelConfiguration());
     virtual ~MixpanelMessageQueue();
 
     void setConfiguration(const MixpanelConfiguration& config);
 
+    void setTransport(MixpanelTransport* transport);
+    MixpanelTransport& transport() const;
+
     void saveMessageQueue();
     void restoreMessageQueue();
 
+    QVariantMap statistics() const;
+
+    QVariantList deadLetters() const;
+    void clearDeadLetters();
+
+    AdmissionStatus admit(const QString& eventName);
+    AdmissionStatus admission() const;
+
 signals:
 
     /// This signal is emitted when a mixpanel message has been posted to
@@ -50,25 +70,75 @@ signals:
     ///
     void mixpanelMessagePosted(const MixpanelMessageQueue::MixpanelPostMessageError errorId, const QVariantMap analyticMessage);
 
+    /// This signal is emitted when shutdown() finishes, with the number of messages
+    /// sent to the Mixpanel server and the number of messages persisted for the next session.
+    ///
+    void shutdownCompleted(int sentMessages, int persistedMessages);
+
+    /// This signal is emitted when the pending messages reach the high watermark of the queue
+    /// budget (see MixpanelConfiguration::setHighWatermark).
+    ///
+    void highWatermarkReached(int pendingMessages, qint64 pendingBytes);
+
+    /// This signal is emitted when the pending messages go back under the low watermark of the queue
+    /// budget (see MixpanelConfiguration::setLowWatermark).
+    ///
+    void lowWatermarkReached(int pendingMessages, qint64 pendingBytes);
+
+    /// This signal is emitted when messages are dropped because the queue is over budget, or pruned
+    /// from the message store because they expired or the backlog was too large.
+    ///
+    void messagesDropped(int droppedMessages);
+
+    /// This signal is emitted when messages refused by the Mixpanel server are quarantined
+    /// (see deadLetters()).
+    ///
+    void messagesQuarantined(int quarantinedMessages);
+
+    /// This signal is emitted when the admission of new events changes (see admission()), so producers
+    /// in other threads can shed events before encoding them.
+    ///
+    void admissionChanged(MixpanelMessageQueue::AdmissionStatus admission);
+
 public slots:
-    void recordPeopleMessage(const QByteArray& peopleMessage);
-    void recordEventMessage(const QByteArray& eventMessage);
+    void recordPeopleMessage(const QByteArray& peopleMessage, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    void recordEventMessage(const QByteArray& eventMessage, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
     void postToServer();
+    void shutdown(const int deadlineMs);
 
 
 private slots:
     void flushIntervalTimeout();
     void appThumbnail();
-    void networkRequestFinished(QNetworkReply* reply);
+    void appAboutToQuit();
+    void batchFinished(int batchId, MixpanelTransport::BatchResult result, const QVariantList& recordErrors);
+    void serverTimeReceived(qint64 serverTime, qint64 roundTripTime);
+    void syncMessageStore();
 
 
 private:
     void initialise();
+    void initialiseTransport();
+    void initialiseMessageStore();
+    bool isOverBudget(const int extraMessages, const qint64 extraBytes) const;
+    bool makeRoom(const qint64 bytes);
+    void checkWatermarks();
+    void updateAdmission();
     void setFlushTimerInterval(const int flushInterval);
+    void scheduleMessageStoreSync();
     void setThumbnailFlush(const bool);
-    void recordAnalyticMessageAndProcessQueue(const MixpanelAnalyticsMessage::MessageType, const QByteArray&);
+    void recordAnalyticMessageAndProcessQueue(const MixpanelAnalyticsMessage::MessageType, const QByteArray&, const MixpanelAnalyticsMessage::Priority);
     void processMessageQueue();
-    void postAnalyticsMessage(const MixpanelAnalyticsMessage&);
+    MixpanelMessageBatch takeBatch();
+    void requeueBatch(const MixpanelMessageBatch& batch);
+    MixpanelMessageRing& lane(const MixpanelAnalyticsMessage::Priority priority);
+    int queuedMessages() const;
+    int prunedMessages() const;
+    QList<MixpanelAnalyticsMessage> pendingMessages() const;
+    void postAnalyticsBatch(const MixpanelMessageBatch& batch);
+    MixpanelMessageBatch takeInFlightBatch(const int batchId);
+    void postDrainBatches();
+    void abortInFlightBatches();
 
 
 
@@ -0,0 +1,122 @@
+/*
+ * MixpanelMessageRing.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELMESSAGERING_HPP_
+#define MIXPANELMESSAGERING_HPP_
+
+#include "MixpanelAnalyticsMessage.hpp"
+
+#include <QList>
+#include <QNetworkRequest>
+#include <QVector>
+
+class MixpanelMessageSlab;
+
+/// \brief The MixpanelMessageBatch class is a batch of analytic messages taken from a MixpanelMessageRing.
+///
+/// The batch keeps the records of its messages as they were in the slabs, copied one after the other in
+/// a single buffer, so a batch costs two allocations whatever its size. It is implicitly shared, the
+/// in flight batches of the queue are kept and requeued as they are.
+///     - toNetworkRequest() writes the request body straight from the records.
+///     - The header fields of a record are read without decoding the others (see contentSize,
+///       enqueueTime and storageId).
+///     - at() and messages() turn records into MixpanelAnalyticsMessage objects, for the message stores
+///       and the MixpanelDeadLetterStore.
+///
+/// \note Every message of a batch has the type and priority of the first one.
+///
+
+class MixpanelMessageBatch
+{
+public:
+    MixpanelMessageBatch();
+
+    bool isEmpty() const;
+    int size() const;
+    qint64 bytes() const;
+
+    MixpanelAnalyticsMessage::MessageType type() const;
+    MixpanelAnalyticsMessage::Priority priority() const;
+
+    int contentSize(const int index) const;
+    qint64 enqueueTime(const int index) const;
+    qint64 storageId(const int index) const;
+    QList<qint64> storageIds() const;
+    QByteArray expandedContent(const int index) const;
+
+    MixpanelAnalyticsMessage at(const int index) const;
+    QList<MixpanelAnalyticsMessage> messages() const;
+    MixpanelMessageBatch records(const QList<int>& indexes) const;
+
+    QNetworkRequest toNetworkRequest(QByteArray& postData) const;
+
+private:
+    friend class MixpanelMessageRing;
+
+    const char* record(const int index) const;
+    int recordSize(const int index) const;
+    void appendRecord(const char* record, const int space);
+
+    QByteArray m_records;
+    QVector<int> m_offsets;
+    qint64 m_bytes;
+};
+
+/// \brief The MixpanelMessageRing class is a FIFO of analytic messages stored inline in large slabs.
+///
+/// Every message is a record written at the end of the last slab: a header (type, priority, enqueue
+/// times, storage id and size) followed by the content, padded to 8 bytes. So a queued message costs
+/// no heap object of its own and the messages of a batch are read from contiguous memory.
+///     - append() writes a record at the tail, opening a new slab when the last one is full.
+///     - takeFirst() and take() move the records at the head to a MixpanelMessageBatch and only advance
+///       its offset. An emptied slab is kept for the next one needed, so a queue that is steadily filled
+///       and emptied reuses the same slabs.
+///     - prepend() writes records before the head, to put back a batch that could not be sent.
+///
+/// \note The records are copied as they are between the slabs and the batches, they are only turned
+///  into MixpanelAnalyticsMessage objects when the queue is persisted (see messages()).
+///
+
+class MixpanelMessageRing
+{
+public:
+    MixpanelMessageRing();
+    ~MixpanelMessageRing();
+
+    void append(const MixpanelAnalyticsMessage& message);
+    void append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority, const QByteArray& content,
+                const qint64 enqueueTime, const qint64 enqueueClock, const qint64 storageId);
+    void prepend(const MixpanelAnalyticsMessage& message);
+    void prepend(const MixpanelMessageBatch& batch);
+
+    void takeFirst(MixpanelMessageBatch& batch);
+    MixpanelMessageBatch take(const int maxMessages);
+    MixpanelAnalyticsMessage::MessageType firstType() const;
+
+    QList<MixpanelAnalyticsMessage> messages() const;
+    void clear();
+
+    bool isEmpty() const;
+    int size() const;
+    qint64 bytes() const;
+    int slabs() const;
+
+private:
+    Q_DISABLE_COPY(MixpanelMessageRing)
+
+    char* appendSpace(const int space);
+    char* prependSpace(const int space);
+    MixpanelMessageSlab* newSlab(const int space);
+    void releaseFirstSlab();
+
+    QList<MixpanelMessageSlab*> m_slabs;
+    MixpanelMessageSlab* m_spareSlab;
+    int m_size;
+    qint64 m_bytes;
+};
+
+#endif /* MIXPANELMESSAGERING_HPP_ */
@@ -0,0 +1,74 @@
+/*
+ * MixpanelMessageStore.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELMESSAGESTORE_HPP_
+#define MIXPANELMESSAGESTORE_HPP_
+
+#include "MixpanelConfiguration.hpp"
+#include "MixpanelAnalyticsMessage.hpp"
+
+#include <QList>
+#include <QVariant>
+
+/// \brief The MixpanelMessageStore class is the interface of the engines persisting the message queue.
+///
+/// The MixpanelMessageQueue keeps its messages in memory and notifies the store of every change:
+///     - append() when a message is queued, it returns the storage id of the message
+///     - remove() when a batch of messages has been acknowledged by the Mixpanel server, by storage id
+///     - save() when the queue is destroyed
+///     - restore() to load the messages left by the previous session
+///
+/// Each engine decides when the data actually reaches the disk (see MixpanelConfiguration::StorageEngine).
+/// An engine may group the appended messages in a single write, the queue calls sync() shortly after
+/// an append leaves the store dirty (see isDirty), when it flushes and when it shuts down.
+///
+/// The messages expired according to the retention (see setRetention) are pruned when the queue is
+/// restored and when it is saved, using only their type and enqueue time, so their content is not decoded.
+///
+
+class MixpanelMessageStore
+{
+public:
+    MixpanelMessageStore();
+    virtual ~MixpanelMessageStore();
+
+    static MixpanelMessageStore* create(const MixpanelConfiguration::StorageEngine engine, const QString& storageNamespace = QString());
+
+    virtual MixpanelConfiguration::StorageEngine engine() const = 0;
+
+    void append(MixpanelAnalyticsMessage& message);
+    void remove(const QList<MixpanelAnalyticsMessage>& messages);
+
+    virtual qint64 append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                          const qint64 enqueueTime, const QByteArray& content) = 0;
+    virtual void remove(const QList<qint64>& storageIds) = 0;
+
+    virtual void save(const QList<MixpanelAnalyticsMessage>& messages) = 0;
+    virtual QList<MixpanelAnalyticsMessage> restore() = 0;
+
+    virtual bool isDirty() const;
+    virtual void sync();
+
+    void setRetention(const qint64 eventTtl, const qint64 profileTtl, const int maxMessages);
+    int expiredMessages() const;
+    int trimmedMessages() const;
+
+protected:
+    static bool adoptStringPool(const QVariantList& stringPoolEntries);
+    static QByteArray restoreContent(const QByteArray& content, const QVariantList& stringPoolEntries, bool stringPoolAdopted);
+
+    qint64 expiryTime(const MixpanelAnalyticsMessage::MessageType type) const;
+    QList<MixpanelAnalyticsMessage> pruneMessages(const QList<MixpanelAnalyticsMessage>& messages);
+
+    qint64 m_eventTtl;
+    qint64 m_profileTtl;
+    int m_maxMessages;
+    int m_expiredMessages;
+    int m_trimmedMessages;
+};
+
+#endif /* MIXPANELMESSAGESTORE_HPP_ */
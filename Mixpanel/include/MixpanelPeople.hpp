@@ -14,8 +14,10 @@
 #include <QVariant>
 
 #include "MixpanelPersistentIdentity.hpp"
+#include "MixpanelAnalyticsMessage.hpp"
 
 class MixpanelPeoplePrivate;
+class MixpanelProfileCache;
 
 ///
 /// \brief  The MixpanelPeople class provides an interface for using Mixpanel People Analytics features.
@@ -48,37 +50,45 @@ public:
     ~MixpanelPeople();
 
     MixpanelPersistentIdentity& persistentIdentity();
+    MixpanelProfileCache& profileCache();
+
+    QVariantMap cachedProperties() const;
 
     void identify(const QString& distinctId);
 
     void setDistinctId(const QString& distinctId);
 
-    void set(const QVariantMap& properties);
-    void set(const QString& propertyName, const QVariant& value);
+    void set(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    void set(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void setOnce(const QVariantMap& properties);
-    void setOnce(const QString& propertyName, const QVariant& value);
+    void setOnce(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
+    void setOnce(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void setCustomAction(const QVariantMap& actionProperies);
+    void setCustomAction(const QVariantMap& actionProperies, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void increment(const QString& propertyName, double value);
+    void increment(const QString& propertyName, double value, const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
-    void deleteUser();
+    void deleteUser(const MixpanelAnalyticsMessage::Priority priority = MixpanelAnalyticsMessage::NormalPriority);
 
     QByteArray stdPeopleMessage(const QString& action, const QVariantMap& properties);
 
     QString distinctId() const;
 
 private:
-    void engageProfileMessage(const QString& action, const QVariantMap& properties);
+    bool engageProfileMessage(const QString& action, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority);
     bool engageHasErrors(const QString& action, const QVariantMap& properties);
+    void scheduleProfileCacheSync();
+
+public slots:
+    void clearProfileCache();
+    void syncProfileCache();
 
 signals:
 
     /// This signal is emitted when a valid profile engage analytic message
     /// has to be recorded in order to be posted to the Mixpanel server.
     ///
-    void recordPeopleMessage(QByteArray message);
+    void recordPeopleMessage(QByteArray message, MixpanelAnalyticsMessage::Priority priority);
 
     /// This signal is emitted when in invalid event message has
     /// failed to be recorded due an error.
@@ -31,9 +31,14 @@ public:
     virtual ~MixpanelPersistentIdentity();
     MixpanelPersistentIdentity& operator=(const MixpanelPersistentIdentity &other);
 
+    MixpanelPersistentIdentity snapshot() const;
+
     QString token() const;
     void setToken(const QString&);
 
+    QString storageNamespace() const;
+    void setStorageNamespace(const QString&);
+
     QString eventDistinctId() const;
     void setEventDistinctId(const QString&);
 
@@ -55,6 +60,7 @@ public:
     void readIdentities();
 
 private:
+    void internSuperPropertyKeys();
     void saveSuperProperties();
     void saveDistinctPeopleId();
 
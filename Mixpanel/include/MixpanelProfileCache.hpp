@@ -0,0 +1,82 @@
+/*
+ * MixpanelProfileCache.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELPROFILECACHE_HPP_
+#define MIXPANELPROFILECACHE_HPP_
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+
+/// \brief The MixpanelProfileCache class keeps the last known properties of the People Analytics profiles.
+///
+/// MixpanelPeople records in the cache the properties of every profile update it queues, so:
+///     - The $set updates only contain the properties whose value changed (see changedProperties).
+///     - The $set_once updates skip the properties already set (see unknownProperties).
+///     - The $add updates are folded into the known numeric values.
+///     - The known profile properties can be read locally (see properties).
+///
+/// The values are kept encoded as JSON, as they are sent, so two values are equal when they would be
+/// sent alike. The cache is persisted in QSettings, one JSON object per profile, and bounded to
+/// maxProfiles profiles (the least recently updated ones are removed first) of
+/// g_maxCachedProfileProperties properties (the properties beyond are not cached, so always sent).
+///
+/// The updates are written to QSettings by sync() only, so several updates cost one write. MixpanelPeople
+/// syncs the cache g_profileCacheSyncDelay after an update, the cache also syncs when it is destroyed or
+/// its namespace changes.
+///
+/// \note The queued updates are sent until the Mixpanel server accepts them, the cache must be
+///  cleared when updates are lost (dropped or quarantined) so the next updates send every property.
+///
+
+class MixpanelProfileCache
+{
+public:
+    explicit MixpanelProfileCache(const int maxProfiles = 0);
+    ~MixpanelProfileCache();
+
+    void setMaxProfiles(const int maxProfiles);
+    void setStorageNamespace(const QString& storageNamespace);
+    bool isEnabled() const;
+
+    bool contains(const QString& distinctId) const;
+    QVariantMap properties(const QString& distinctId) const;
+
+    QVariantMap changedProperties(const QString& distinctId, const QVariantMap& properties) const;
+    QVariantMap unknownProperties(const QString& distinctId, const QVariantMap& properties) const;
+
+    void set(const QString& distinctId, const QVariantMap& properties);
+    void add(const QString& distinctId, const QString& propertyName, const double value);
+    void remove(const QString& distinctId);
+    void clear();
+
+    bool isDirty() const;
+    void sync();
+
+    qint64 skippedProperties() const;
+
+private:
+    typedef QHash<QString, QByteArray> Profile;
+
+    static QByteArray encode(const QVariant& value);
+    static QByteArray toJson(const Profile& profile);
+
+    void load() const;
+    void save() const;
+    void trim();
+
+    int m_maxProfiles;
+    QString m_storageNamespace;
+    mutable bool m_loaded;
+    bool m_dirty;
+    mutable QHash<QString, Profile> m_profiles;
+    mutable QStringList m_recentProfiles;
+    mutable qint64 m_skippedProperties;
+};
+
+#endif /* MIXPANELPROFILECACHE_HPP_ */
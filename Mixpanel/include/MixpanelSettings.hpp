@@ -0,0 +1,33 @@
+/*
+ * MixpanelSettings.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELSETTINGS_HPP_
+#define MIXPANELSETTINGS_HPP_
+
+#include <QSettings>
+#include <QString>
+
+/// \brief The MixpanelSettings class gives access to the state persisted by a Mixpanel instance.
+///
+/// The state of every Mixpanel token (super properties, distinct id, message queue, dead letters and
+/// profile cache) is kept in its own QSettings group and files, named after the token, so several
+/// Mixpanel instances with different tokens do not overwrite each other. An empty namespace uses the
+/// keys and files of the previous versions of the library.
+///
+
+class MixpanelSettings : public QSettings
+{
+public:
+    explicit MixpanelSettings(const QString& storageNamespace = QString());
+
+    static QString filePath(const QString& fileName, const QString& storageNamespace);
+
+private:
+    static QString groupName(const QString& storageNamespace);
+};
+
+#endif /* MIXPANELSETTINGS_HPP_ */
@@ -0,0 +1,41 @@
+/*
+ * MixpanelSettingsMessageStore.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELSETTINGSMESSAGESTORE_HPP_
+#define MIXPANELSETTINGSMESSAGESTORE_HPP_
+
+#include "MixpanelMessageStore.hpp"
+
+/// \brief The MixpanelSettingsMessageStore class persists the message queue as a single QSettings value.
+///
+/// \note The whole queue is written when the queue is destroyed and read back (and removed) on restore,
+///  messages queued in between are only kept in memory.
+///
+
+class MixpanelSettingsMessageStore : public MixpanelMessageStore
+{
+public:
+    explicit MixpanelSettingsMessageStore(const QString& storageNamespace = QString());
+    virtual ~MixpanelSettingsMessageStore();
+
+    virtual MixpanelConfiguration::StorageEngine engine() const;
+
+    using MixpanelMessageStore::append;
+    using MixpanelMessageStore::remove;
+
+    virtual qint64 append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                          const qint64 enqueueTime, const QByteArray& content);
+    virtual void remove(const QList<qint64>& storageIds);
+
+    virtual void save(const QList<MixpanelAnalyticsMessage>& messages);
+    virtual QList<MixpanelAnalyticsMessage> restore();
+
+private:
+    QString m_storageNamespace;
+};
+
+#endif /* MIXPANELSETTINGSMESSAGESTORE_HPP_ */
@@ -0,0 +1,65 @@
+/*
+ * MixpanelSqliteMessageStore.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELSQLITEMESSAGESTORE_HPP_
+#define MIXPANELSQLITEMESSAGESTORE_HPP_
+
+#include "MixpanelMessageStore.hpp"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+/// \brief The MixpanelSqliteMessageStore class persists the message queue in a SQLite database.
+///
+/// Every message is stored in its own row as soon as it is queued, so nothing is lost if the
+/// application is killed and the queue is never rewritten as a whole. The rows appended are written
+/// in a single transaction, opened by the first append and committed by sync(): the message queue
+/// syncs the store g_messageStoreSyncDelay after an append, so a burst of events costs one write. The rows are keyed by an
+/// autoincrement id, which keeps the queue order, and contain the message type, priority,
+/// enqueue time and compacted content.
+///
+/// \note The database runs in WAL mode. Acknowledged batches are deleted in a single transaction
+///  and the queue is restored by pages using range scans on the id.
+///
+
+class MixpanelSqliteMessageStore : public MixpanelMessageStore
+{
+public:
+    explicit MixpanelSqliteMessageStore(const QString& databasePath = QString());
+    virtual ~MixpanelSqliteMessageStore();
+
+    virtual MixpanelConfiguration::StorageEngine engine() const;
+
+    using MixpanelMessageStore::append;
+    using MixpanelMessageStore::remove;
+
+    virtual qint64 append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                          const qint64 enqueueTime, const QByteArray& content);
+    virtual void remove(const QList<qint64>& storageIds);
+
+    virtual void save(const QList<MixpanelAnalyticsMessage>& messages);
+    virtual QList<MixpanelAnalyticsMessage> restore();
+
+    virtual bool isDirty() const;
+    virtual void sync();
+
+    QList<MixpanelAnalyticsMessage> load(const qint64 afterId, const int maxMessages);
+
+private:
+    void beginTransaction();
+    bool execute(const QString& statement);
+    void pruneStoredMessages();
+    void saveStringPool();
+
+    QString m_connectionName;
+    QSqlDatabase m_database;
+    QSqlQuery* m_insertQuery;
+    int m_savedStringPoolEntries;
+    bool m_inTransaction;
+};
+
+#endif /* MIXPANELSQLITEMESSAGESTORE_HPP_ */
@@ -0,0 +1,72 @@
+/*
+ * MixpanelStringPool.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELSTRINGPOOL_HPP_
+#define MIXPANELSTRINGPOOL_HPP_
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+
+/// \brief The MixpanelStringPool class interns the identifiers repeated in every analytic message.
+///
+/// Most bytes of a queued message are keys ("token", "distinct_id", "$os"...) and event names that are
+/// the same in every message. The pool assigns them a small id so the queued messages store a two bytes
+/// reference (ReferenceMarker followed by the id) instead of the whole JSON string. The references are
+/// expanded only when the message is sent.
+///
+/// Only a known set of strings is interned: the seed identifiers, the event names and keys of the event
+/// schemas (see MixpanelEventSchema) and the names of the super properties. Entries are never evicted,
+/// since the persisted messages refer to them.
+///
+/// \note ReferenceMarker is a control character, which can never appear unescaped in valid JSON.
+///  The pool is shared by all the encoders and message queues of the process, it is bounded to
+///  MaxEntries strings and its dynamic part is persisted together with the message queue. It can be
+///  used from any thread (e.g. the event schemas intern their keys in the thread that first builds
+///  them), its mutex is only contended when a string is interned while the queue compacts a message.
+///
+
+class MixpanelStringPool
+{
+public:
+    enum
+    {
+        ReferenceMarker = 0x01,  ///< First byte of an interned string reference
+        MaxEntries = 255,        ///< Maximum number of interned strings
+        MaxStringSize = 64       ///< Longest string (in bytes) that will be interned
+    };
+
+    static MixpanelStringPool& instance();
+
+    void intern(const QString& value);
+
+    QByteArray compact(const QByteArray& json);
+    QByteArray expand(const QByteArray& compactJson) const;
+
+    int size() const;
+
+    QVariantList dynamicEntries() const;
+    bool adoptDynamicEntries(const QVariantList& entries);
+
+    static QByteArray expand(const QByteArray& compactJson, const QVariantList& dynamicEntries);
+
+private:
+    MixpanelStringPool();
+
+    quint8 lookup(const QByteArray& token) const;
+    quint8 internToken(const QByteArray& token);
+
+    QList<QByteArray> m_entries;
+    QHash<QByteArray, quint8> m_ids;
+    int m_seedCount;
+    mutable QMutex m_mutex;
+};
+
+#endif /* MIXPANELSTRINGPOOL_HPP_ */
@@ -0,0 +1,138 @@
+/*
+ * MixpanelThreadStaging.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELTHREADSTAGING_HPP_
+#define MIXPANELTHREADSTAGING_HPP_
+
+#include "MixpanelAnalyticsMessage.hpp"
+#include "MixpanelEvent.hpp"
+#include "MixpanelEventSampler.hpp"
+#include "MixpanelMessageQueue.hpp"
+#include "MixpanelPersistentIdentity.hpp"
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QSharedPointer>
+
+class MixpanelStagingChunk;
+class MixpanelStagingState;
+
+/// \brief The MixpanelThreadContext class tracks the events of one thread for a MixpanelThreadStaging.
+///
+/// It is created the first time a thread tracks an event and destroyed when the thread finishes. Its
+/// MixpanelEvent reads a copy of the identity, sampling rules and deduplication window published by the
+/// MixpanelThreadStaging, copied again only when they change.
+///
+/// It is the MixpanelEventSink of its MixpanelEvent, so the messages are copied from the arena of the
+/// event straight to a chunk owned by the thread: a record header (time stamp, sequence number, priority
+/// and size) and the message bytes, written at the end of the used part of the chunk. The chunk is handed off to the staging, the only time the shared mutex is taken, when:
+///     - It is full, or the message is high priority.
+///     - Its first message is older than g_stagingLatency.
+///     - The staging asked for it (see MixpanelThreadStaging::requestHandOff) or the thread finishes.
+///
+/// \note Staging a message takes no lock and no memory allocation, the generation numbers of the
+///  staging are only read and the record is published with a single atomic store. A thread that stops
+///  tracking keeps its last chunk until it tracks again or finishes, but the messages already staged
+///  in it are taken by MixpanelThreadStaging::collect().
+///
+
+class MixpanelThreadContext : public QObject, public MixpanelEventSink
+{
+    Q_OBJECT
+public:
+    explicit MixpanelThreadContext(const QSharedPointer<MixpanelStagingState>& state);
+    virtual ~MixpanelThreadContext();
+
+    MixpanelEvent& event();
+
+    virtual void recordEventMessage(const char* eventMessage, const int size, const MixpanelAnalyticsMessage::Priority priority);
+
+    MixpanelMessageQueue::AdmissionStatus admit(const QString& eventName);
+
+private:
+    friend class MixpanelThreadStaging;
+
+    void handOff(const int space);
+
+    QSharedPointer<MixpanelStagingState> m_state;
+    MixpanelEvent* m_event;
+    MixpanelStagingChunk* m_chunk;
+    int m_id;
+    quint32 m_sequence;
+    int m_generation;
+    int m_handOffGeneration;
+    int m_deduplicationWindow;
+    int m_deduplicationWindowSize;
+    int m_admission;
+    QHash<QString, int> m_pressureSampleCounters;
+};
+
+/// \brief The MixpanelThreadStaging class lets threads other than the one of the Mixpanel object track events.
+///
+/// Every thread tracks its events with its own MixpanelEvent (see event()) and stages them in chunks of
+/// its own (see MixpanelThreadContext), so the threads share no mutable state on the track path:
+///     - The identity, sampling rules and deduplication window are published with publish() by the
+///       thread of the Mixpanel object. The threads only read a generation number to know whether
+///       their copy is up to date.
+///     - merge() takes the chunks handed off by the threads and emits their messages with
+///       recordEventMessage(), ordered by their monotonic time stamp (nanoseconds). Messages stamped at the
+///       same time keep the order of the thread that tracked them (sequence number), then the thread order.
+///     - The merged chunks are kept and handed back to the threads, so staging allocates no memory
+///       once every thread has its chunks.
+///     - collect() also takes the messages staged in the chunks the threads still fill, so a flush or
+///       a shutdown does not wait for idle threads.
+///     - The admission of the message queue is published with setAdmission(), so admit() sheds the
+///       events of the threads before they are encoded, as MixpanelMessageQueue::admit does.
+///
+/// \note The order is recovered within a merge, a chunk handed off late is merged after the messages
+///  merged before it. Timers and the deduplication window apply per thread, the rate limits of the
+///  sampler are shared with the thread of the staging (see MixpanelEventSampler).
+///
+
+class MixpanelThreadStaging : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MixpanelThreadStaging(QObject* parent = 0);
+    virtual ~MixpanelThreadStaging();
+
+    void publish(const MixpanelPersistentIdentity& identity, const MixpanelEventSampler& sampler, const int deduplicationWindow, const int deduplicationWindowSize);
+
+    MixpanelEvent& event();
+
+    void setAdmission(const MixpanelMessageQueue::AdmissionStatus admission, const int pressureSampleInterval);
+    MixpanelMessageQueue::AdmissionStatus admit(const QString& eventName);
+
+    void requestHandOff();
+
+    int threads() const;
+    qint64 mergedMessages() const;
+    qint64 mergedChunks() const;
+    qint64 sampledEvents() const;
+    qint64 rejectedEvents() const;
+
+public slots:
+    void merge();
+    void collect();
+
+signals:
+
+    /// This signal is emitted, in the thread of the staging, for every message merged.
+    ///
+    void recordEventMessage(const QByteArray& eventMessage, const MixpanelAnalyticsMessage::Priority priority);
+
+private:
+    MixpanelThreadContext& context();
+    void mergeChunks(const bool collectActive);
+
+    QSharedPointer<MixpanelStagingState> m_state;
+    qint64 m_mergedMessages;
+    qint64 m_mergedChunks;
+};
+
+#endif /* MIXPANELTHREADSTAGING_HPP_ */
@@ -0,0 +1,79 @@
+/*
+ * MixpanelTransport.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELTRANSPORT_HPP_
+#define MIXPANELTRANSPORT_HPP_
+
+#include "MixpanelConfiguration.hpp"
+#include "MixpanelAnalyticsMessage.hpp"
+#include "MixpanelMessageRing.hpp"
+
+#include <QList>
+#include <QObject>
+#include <QVariantList>
+
+/// \brief The MixpanelTransport class is the interface of the sinks the message queue sends its batches to.
+///
+/// The MixpanelMessageQueue decides what is sent and when, the transport only delivers batches:
+///     - send() starts the delivery of a batch identified by the queue
+///     - batchFinished() reports the result of the batch, it may be emitted from send() itself
+///     - abort() cancels a batch, no result is reported for it
+///
+/// The queue requeues the batches that fail or time out and forgets the ones that are accepted
+/// or rejected (see BatchResult). When the transport knows which records of a batch are invalid,
+/// it reports them in the recordErrors of batchFinished(), a QVariantMap per record with:
+///     - index: position of the record in the batch
+///     - message: reason why the record has been rejected
+///
+/// Only those records are quarantined in the MixpanelDeadLetterStore, the rest of the batch is
+/// sent again if it was Rejected or forgotten if it was PartiallyAccepted.
+///
+/// \note Every batch contains messages of the same type. The messages are compacted by the
+///  MixpanelStringPool, use MixpanelMessageBatch::toNetworkRequest or expandedContent to expand them.
+///
+
+class MixpanelTransport : public QObject
+{
+    Q_OBJECT
+public:
+
+    /// An enumeration for the result of a batch.
+    enum BatchResult
+    {
+       Accepted = 0,  ///< The batch has been delivered
+       Rejected,      ///< The batch has been refused because of its content, only its valid records can be sent again
+       Failed,        ///< The batch could not be delivered, it can be sent again
+       TimedOut,      ///< The batch took too long to be delivered and has been cancelled, it can be sent again
+       TooLarge,      ///< The batch has been refused because of its size, it can be sent again in smaller batches
+       Throttled,     ///< The batch has been refused because too many requests were sent, it can be sent again later
+       PartiallyAccepted ///< The batch has been delivered except the records reported in the record errors
+    };
+
+    explicit MixpanelTransport(QObject* parent = 0);
+    virtual ~MixpanelTransport();
+
+    static MixpanelTransport* create(const MixpanelConfiguration& config, QObject* parent = 0);
+
+    virtual MixpanelConfiguration::Transport type() const = 0;
+    virtual void setConfiguration(const MixpanelConfiguration& config);
+
+    virtual void send(const int batchId, const MixpanelMessageBatch& batch) = 0;
+    virtual void abort(const int batchId) = 0;
+
+signals:
+
+    /// This signal is emitted when the delivery of a batch finishes.
+    ///
+    void batchFinished(int batchId, MixpanelTransport::BatchResult result, const QVariantList& recordErrors);
+
+    /// This signal is emitted when a reply carries the server time, before the batchFinished() signal
+    /// of its batch, with the time elapsed since the request was sent (see MixpanelClock).
+    ///
+    void serverTimeReceived(qint64 serverTime, qint64 roundTripTime);
+};
+
+#endif /* MIXPANELTRANSPORT_HPP_ */
@@ -0,0 +1,74 @@
+/*
+ * MixpanelUploadScheduler.hpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#ifndef MIXPANELUPLOADSCHEDULER_HPP_
+#define MIXPANELUPLOADSCHEDULER_HPP_
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QNetworkRequest>
+#include <QObject>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class MixpanelHttpTransport;
+
+/// \brief The MixpanelUploadScheduler class posts the requests of all the Mixpanel instances of the process.
+///
+/// Every MixpanelHttpTransport (one per message queue, so per token) hands its requests to the scheduler,
+/// which posts them with a single QNetworkAccessManager, so the connections to the Mixpanel servers are
+/// reused across instances and at most maxRequests requests are in flight at once. When the budget is
+/// used, the waiting requests are posted in turns, one per transport, so no token starves the others.
+///
+/// \note Each message queue still sizes its own batches and in flight window (see MixpanelBatchController),
+///  the scheduler only shares the connection budget. MixpanelImporter uses the same network access manager.
+///
+
+class MixpanelUploadScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    static MixpanelUploadScheduler& instance();
+    static bool exists();
+
+    QNetworkAccessManager* networkAccessManager() const;
+
+    void setMaxRequests(const int maxRequests);
+    int maxRequests() const;
+
+    void post(MixpanelHttpTransport* transport, const int requestId, const QNetworkRequest& request, const QByteArray& data);
+    bool cancel(MixpanelHttpTransport* transport, const int requestId);
+    void removeTransport(MixpanelHttpTransport* transport);
+
+    int waitingRequests() const;
+    int inFlightRequests() const;
+
+private slots:
+    void networkRequestFinished(QNetworkReply* reply);
+
+private:
+    struct WaitingRequest
+    {
+        int requestId;
+        QNetworkRequest request;
+        QByteArray data;
+    };
+
+    explicit MixpanelUploadScheduler(QObject* parent = 0);
+
+    void postWaitingRequests();
+
+    QNetworkAccessManager* m_networkAccessManager;
+    QList<MixpanelHttpTransport*> m_waitingTransports;
+    QHash<MixpanelHttpTransport*, QList<WaitingRequest> > m_waitingRequests;
+    QHash<QNetworkReply*, MixpanelHttpTransport*> m_inFlightRequests;
+    int m_maxRequests;
+    int m_nextTransport;
+};
+
+#endif /* MIXPANELUPLOADSCHEDULER_HPP_ */
@@ -10,9 +10,17 @@
 #include "../include/MixpanelEvent.hpp"
 #include "../include/MixpanelPersistentIdentity.hpp"
 #include "../include/MixpanelMessageQueue.hpp"
+#include "../include/MixpanelEventBuilder.hpp"
+#include "../include/MixpanelEventSampler.hpp"
+#include "../include/MixpanelImporter.hpp"
+#include "../include/MixpanelImportSource.hpp"
+#include "../include/MixpanelProfileCache.hpp"
+#include "../include/MixpanelThreadStaging.hpp"
 
 #include "qdebug.h"
+#include <QCoreApplication>
 #include <QDateTime>
+#include <QThread>
 
 class MixpanelPrivate {
 public:
@@ -22,6 +30,18 @@ public:
     MixpanelEvent *mixpanelEvent;
     MixpanelPersistentIdentity persistentIdentity;
     MixpanelMessageQueue *messageQueue;
+    MixpanelImporter *importer;
+    MixpanelThreadStaging *staging;
+    MixpanelConfiguration configuration;
+
+    void connectProfileCache();
+    void connectAboutToQuit();
+    void connectAdmission();
+    void setStorageNamespace(const QString& token);
+
+    bool isOwnerThread() const;
+    MixpanelEvent& currentEvent();
+    void publish();
 
 private:
     Mixpanel *q;
@@ -32,11 +52,100 @@ MixpanelPrivate::MixpanelPrivate(Mixpanel *qq)
     : mixpanelPeople(0)
     , mixpanelEvent(0)
     , messageQueue(0)
+    , importer(0)
+    , staging(0)
     , q(qq)
 {
 
 }
 
+/// Clears the profile cache when queued messages are lost, so the next profile updates send every property.
+///
+/// \note The message queue drops its connections when it is configured again, so it is called every time.
+///
+
+void MixpanelPrivate::connectProfileCache()
+{
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = QObject::connect(messageQueue, SIGNAL(messagesDropped(int)), mixpanelPeople, SLOT(clearProfileCache()), Qt::UniqueConnection);
+    Q_ASSERT(connectResult);
+
+    connectResult = QObject::connect(messageQueue, SIGNAL(messagesQuarantined(int)), mixpanelPeople, SLOT(clearProfileCache()), Qt::UniqueConnection);
+    Q_ASSERT(connectResult);
+}
+
+/// Shuts down with Mixpanel::shutdown when the application quits, instead of the message queue alone,
+/// so the events staged by other threads are sent or persisted too.
+///
+/// \note The message queue connects itself again when it is configured again, so it is called every time.
+///
+
+void MixpanelPrivate::connectAboutToQuit()
+{
+    QCoreApplication* application = QCoreApplication::instance();
+    if (!application)
+        return;
+
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    QObject::disconnect(application, SIGNAL(aboutToQuit()), messageQueue, SLOT(appAboutToQuit()));
+
+    connectResult = QObject::connect(application, SIGNAL(aboutToQuit()), q, SLOT(appAboutToQuit()), Qt::UniqueConnection);
+    Q_ASSERT(connectResult);
+}
+
+/// Publishes the admission of the message queue to the other threads, now and every time it changes,
+/// so tryTrackEvent sheds their events as it sheds the ones of the thread of the Mixpanel object.
+///
+/// \note The message queue drops its connections when it is configured again, so it is called every time.
+///
+
+void MixpanelPrivate::connectAdmission()
+{
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = QObject::connect(messageQueue, SIGNAL(admissionChanged(MixpanelMessageQueue::AdmissionStatus)), q, SLOT(admissionChanged(MixpanelMessageQueue::AdmissionStatus)), Qt::UniqueConnection);
+    Q_ASSERT(connectResult);
+
+    staging->setAdmission(messageQueue->admission(), configuration.pressureSampleInterval());
+}
+
+/// Uses the token as namespace of the persisted identities and profile cache, so several Mixpanel
+/// objects with different tokens do not share them.
+///
+
+void MixpanelPrivate::setStorageNamespace(const QString& token)
+{
+    persistentIdentity.setToken(token);
+    persistentIdentity.setStorageNamespace(token);
+    mixpanelPeople->profileCache().setStorageNamespace(token);
+}
+
+/// Returns whether the calling thread is the thread of the Mixpanel object.
+
+bool MixpanelPrivate::isOwnerThread() const
+{
+    return QThread::currentThread() == q->thread();
+}
+
+/// Returns the event object of the calling thread, the one of the thread context in other threads.
+
+MixpanelEvent& MixpanelPrivate::currentEvent()
+{
+    return isOwnerThread() ? *mixpanelEvent : staging->event();
+}
+
+/// Publishes the identity, sampling rules and deduplication window to the event objects of the other threads.
+
+void MixpanelPrivate::publish()
+{
+    staging->publish(persistentIdentity, mixpanelEvent->sampler(), configuration.deduplicationWindow(), configuration.deduplicationWindowSize());
+}
+
 /// Creates a Mixpanel object.
 /// \param parent is passed to the QObject's constructor.
 /// The default value is 0.
@@ -47,51 +156,91 @@ Mixpanel::Mixpanel(QObject *parent, MixpanelConfiguration config)
 {
     d->mixpanelPeople = new MixpanelPeople(this);
     d->mixpanelEvent = new MixpanelEvent(this);
+    d->configuration = config;
     d->messageQueue = new MixpanelMessageQueue(this, config);
+    d->importer = new MixpanelImporter(this, config);
+    d->staging = new MixpanelThreadStaging(this);
+    d->mixpanelEvent->setDeduplicationWindow(config.deduplicationWindow(), config.deduplicationWindowSize());
+    d->mixpanelPeople->profileCache().setMaxProfiles(config.maxCachedProfiles());
+
+    if (!config.token().isEmpty())
+        d->setStorageNamespace(config.token());
 
     d->persistentIdentity.loadPersistentData();
     d->persistentIdentity.readIdentities();
 
     d->mixpanelEvent->persistentIdentity() = d->persistentIdentity;
     d->mixpanelPeople->persistentIdentity() = d->persistentIdentity;
+    d->publish();
+
+    qRegisterMetaType<MixpanelAnalyticsMessage::Priority>("MixpanelAnalyticsMessage::Priority");
 
     bool connectResult = false;
     Q_UNUSED(connectResult);
 
-    connectResult = connect(d->mixpanelPeople, SIGNAL(recordPeopleMessage(QByteArray)), d->messageQueue, SLOT(recordPeopleMessage(QByteArray)));
+    connectResult = connect(d->mixpanelPeople, SIGNAL(recordPeopleMessage(QByteArray,MixpanelAnalyticsMessage::Priority)), d->messageQueue, SLOT(recordPeopleMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+    Q_ASSERT(connectResult);
+
+    connectResult = connect(d->mixpanelEvent, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)), d->messageQueue, SLOT(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
     Q_ASSERT(connectResult);
 
-    connectResult = connect(d->mixpanelEvent, SIGNAL(recordEventMessage(QByteArray)), d->messageQueue, SLOT(recordEventMessage(QByteArray)));
+    connectResult = connect(d->staging, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)), d->messageQueue, SLOT(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
     Q_ASSERT(connectResult);
 
+    d->connectProfileCache();
+    d->connectAboutToQuit();
+    d->connectAdmission();
 }
 
 /// Destructor, destroys the Mixpanel object.
 ///
+/// \note The events staged by other threads are merged into the message queue first. The other threads
+///  must not use the object any more.
+///
 
 Mixpanel::~Mixpanel()
 {
+    d->staging->collect();
     delete d;
 }
 
 /// Sets the Mixpanel configuration
 ///
+/// \note A configuration without token keeps the current one.
+///
 /// \param Mixpanel configuration
 ///
 
 void Mixpanel::setConfiguration(const MixpanelConfiguration& config)
 {
-    d->messageQueue->setConfiguration(config);
+    d->configuration = config;
+    if (config.token().isEmpty())
+        d->configuration.setToken(d->persistentIdentity.token());
+    else
+        d->setStorageNamespace(config.token());
+
+    d->messageQueue->setConfiguration(d->configuration);
+    d->importer->setConfiguration(d->configuration);
+    d->mixpanelEvent->setDeduplicationWindow(config.deduplicationWindow(), config.deduplicationWindowSize());
+    d->mixpanelPeople->profileCache().setMaxProfiles(config.maxCachedProfiles());
+    d->connectProfileCache();
+    d->connectAboutToQuit();
+    d->connectAdmission();
+    d->publish();
 }
 
 /// Sets the Mixpanel token linked to the mixpanel account.
 ///
+/// \note The token is also the namespace of the persisted state (see MixpanelSettings), the state saved
+///  before a token was set is moved to its namespace.
+///
 /// \param Mixpanel token, all the network request will contain this token
 ///
 
 void Mixpanel::setToken(const QString& token)
 {
-    d->persistentIdentity.setToken(token);
+    d->configuration.setToken(token);
+    setConfiguration(d->configuration);
 }
 
 
@@ -102,65 +251,119 @@ void Mixpanel::setToken(const QString& token)
 
 void Mixpanel::setEventDistinctId(const QString& distinctId)
 {
+    if (!d->isOwnerThread())
+    {
+        d->staging->event().setDistinctId(distinctId);
+        QMetaObject::invokeMethod(this, "setEventDistinctId", Qt::QueuedConnection, Q_ARG(QString, distinctId));
+        return;
+    }
+
     d->mixpanelEvent->setDistinctId(distinctId);
+    d->publish();
 }
 
+/// Identifies the user of the profile updates.
+///
+/// \param distinctId The distinct id of the profile
+///
+
 void Mixpanel::identify(const QString& distinctId)
 {
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "identify", Qt::QueuedConnection, Q_ARG(QString, distinctId));
+        return;
+    }
+
     d->mixpanelPeople->identify(distinctId);
 }
 
 /// Sets the properties in the profile.
 ///
 /// \param properties The properties to be set
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
-void Mixpanel::setProfileProperties(const QVariantMap& properties)
+void Mixpanel::setProfileProperties(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->set(properties);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setProfileProperties", Qt::QueuedConnection, Q_ARG(QVariantMap, properties), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->set(properties, priority);
 }
 
 /// Sets the property in the profile.
 ///
 /// \param propertyName The name of the property
 /// \param value The value of the property in a QVariant object
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
-void Mixpanel::setProfileProperty(const QString& propertyName, const QVariant& value)
+void Mixpanel::setProfileProperty(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->set(propertyName, value);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setProfileProperty", Qt::QueuedConnection, Q_ARG(QString, propertyName), Q_ARG(QVariant, value), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->set(propertyName, value, priority);
 }
 
 /// Sets once the properties in the profile.
 ///
 /// \param properties The properties to be set
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
-void Mixpanel::setOnceProfileProperties(const QVariantMap& properties)
+void Mixpanel::setOnceProfileProperties(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->setOnce(properties);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setOnceProfileProperties", Qt::QueuedConnection, Q_ARG(QVariantMap, properties), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->setOnce(properties, priority);
 }
 
 /// Sets once the property in the profile.
 ///
 /// \param propertyName The name of the property
 /// \param value The value of the property in a QVariant object
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
 
-void Mixpanel::setOnceProfileProperty(const QString& propertyName, const QVariant& value)
+void Mixpanel::setOnceProfileProperty(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->setOnce(propertyName, value);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setOnceProfileProperty", Qt::QueuedConnection, Q_ARG(QString, propertyName), Q_ARG(QVariant, value), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->setOnce(propertyName, value, priority);
 }
 
 /// Sets a profile update containing the action given and its properties
 ///
 /// \actionProperties A QVariantMap with the action and its properties
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
-void Mixpanel::setCustomAction(const QVariantMap& actionProperties)
+void Mixpanel::setCustomAction(const QVariantMap& actionProperties, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->setCustomAction(actionProperties);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setCustomAction", Qt::QueuedConnection, Q_ARG(QVariantMap, actionProperties), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->setCustomAction(actionProperties, priority);
 }
 
 /// Registers super properites in the persistent identity
@@ -170,7 +373,15 @@ void Mixpanel::setCustomAction(const QVariantMap& actionProperties)
 
 void Mixpanel::registerSuperProperties(const QVariantMap& superProperties)
 {
+    if (!d->isOwnerThread())
+    {
+        d->staging->event().persistentIdentity().registerSuperProperties(superProperties);
+        QMetaObject::invokeMethod(this, "registerSuperProperties", Qt::QueuedConnection, Q_ARG(QVariantMap, superProperties));
+        return;
+    }
+
     d->persistentIdentity.registerSuperProperties(superProperties);
+    d->publish();
 }
 
 /// Registers super properites in the persistent identity only if
@@ -180,7 +391,15 @@ void Mixpanel::registerSuperProperties(const QVariantMap& superProperties)
 
 void Mixpanel::registerSuperPropertiesOnce(const QVariantMap& superProperties)
 {
+    if (!d->isOwnerThread())
+    {
+        d->staging->event().persistentIdentity().registerSuperPropertiesOnce(superProperties);
+        QMetaObject::invokeMethod(this, "registerSuperPropertiesOnce", Qt::QueuedConnection, Q_ARG(QVariantMap, superProperties));
+        return;
+    }
+
     d->persistentIdentity.registerSuperPropertiesOnce(superProperties);
+    d->publish();
 }
 
 /// Unregisters a super property in the persistent identity.
@@ -189,7 +408,15 @@ void Mixpanel::registerSuperPropertiesOnce(const QVariantMap& superProperties)
 
 void Mixpanel::unregisterSuperProperty(const QString& superPropertyName)
 {
+    if (!d->isOwnerThread())
+    {
+        d->staging->event().persistentIdentity().unregisterSuperProperty(superPropertyName);
+        QMetaObject::invokeMethod(this, "unregisterSuperProperty", Qt::QueuedConnection, Q_ARG(QString, superPropertyName));
+        return;
+    }
+
     d->persistentIdentity.unregisterSuperProperty(superPropertyName);
+    d->publish();
 }
 
 /// Unregisters all the super properties stored in the persistent identity.
@@ -197,46 +424,271 @@ void Mixpanel::unregisterSuperProperty(const QString& superPropertyName)
 
 void Mixpanel::unregisterAllSuperProperties()
 {
+    if (!d->isOwnerThread())
+    {
+        d->staging->event().persistentIdentity().clearSuperProperties();
+        QMetaObject::invokeMethod(this, "unregisterAllSuperProperties", Qt::QueuedConnection);
+        return;
+    }
+
     d->persistentIdentity.clearSuperProperties();
+    d->publish();
+}
+
+/// Starts timing an event, the next trackEvent call of the event will include its $duration in seconds.
+/// \param eventName as QString
+///
+/// \note The timers are kept per thread, only a trackEvent call from the same thread includes the $duration.
+///
+
+void Mixpanel::timeEvent(const QString& eventName)
+{
+    d->currentEvent().timeEvent(eventName);
 }
 
 /// Tracks an event to Mixpanel server.
 /// \param eventName as QString
 /// \param properties as QVaraintMap containing the event properties
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
+///
+
+void Mixpanel::trackEvent(const QString& eventName, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
+{
+    d->currentEvent().track(eventName, properties, priority);
+}
+
+/// Tracks an event built without QVariantMap to Mixpanel server.
+/// \param builder as MixpanelEventBuilder containing the event name and its typed properties
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
+///
+
+void Mixpanel::trackEvent(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority)
+{
+    d->currentEvent().track(builder, priority);
+}
+
+/// Tracks an event to Mixpanel server only if the message queue admits it (see MixpanelMessageQueue::admit).
+/// \param eventName as QString
+/// \param properties as QVaraintMap containing the event properties
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
+/// \return Accepted if the event has been tracked, otherwise the reason why it has been discarded
+///
+/// \note From other threads the admission published by the message queue is checked instead (see
+///  MixpanelThreadStaging::admit), it follows the queue once the thread of the Mixpanel object has
+///  recorded the merged events.
 ///
 
-void Mixpanel::trackEvent(const QString& eventName, const QVariantMap& properties)
+MixpanelMessageQueue::AdmissionStatus Mixpanel::tryTrackEvent(const QString& eventName, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelEvent->track(eventName, properties);
+    if (!d->isOwnerThread())
+    {
+        const MixpanelMessageQueue::AdmissionStatus status = d->staging->admit(eventName);
+        if (status == MixpanelMessageQueue::Accepted)
+            d->staging->event().track(eventName, properties, priority);
+        return status;
+    }
+
+    const MixpanelMessageQueue::AdmissionStatus status = d->messageQueue->admit(eventName);
+    if (status == MixpanelMessageQueue::Accepted)
+        d->mixpanelEvent->track(eventName, properties, priority);
+    return status;
+}
+
+/// Tracks an event built without QVariantMap only if the message queue admits it (see MixpanelMessageQueue::admit).
+/// \param builder as MixpanelEventBuilder containing the event name and its typed properties
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
+/// \return Accepted if the event has been tracked, otherwise the reason why it has been discarded
+///
+/// \note From other threads the admission published by the message queue is checked instead, as
+///  tryTrackEvent(QString, QVariantMap, Priority).
+///
+
+MixpanelMessageQueue::AdmissionStatus Mixpanel::tryTrackEvent(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority)
+{
+    if (!d->isOwnerThread())
+    {
+        const MixpanelMessageQueue::AdmissionStatus status = d->staging->admit(builder.name());
+        if (status == MixpanelMessageQueue::Accepted)
+            d->staging->event().track(builder, priority);
+        return status;
+    }
+
+    const MixpanelMessageQueue::AdmissionStatus status = d->messageQueue->admit(builder.name());
+    if (status == MixpanelMessageQueue::Accepted)
+        d->mixpanelEvent->track(builder, priority);
+    return status;
+}
+
+/// Sets the fraction of users that track an event (see MixpanelEventSampler).
+/// \param eventName as QString containing the event name
+/// \param sampleRate as double between 0 and 1, it is added to the tracked events as "sample_rate"
+///
+/// \note Called from another thread, the change is queued to the thread of the Mixpanel object.
+///
+
+void Mixpanel::setEventSampleRate(const QString& eventName, const double sampleRate)
+{
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setEventSampleRate", Qt::QueuedConnection, Q_ARG(QString, eventName), Q_ARG(double, sampleRate));
+        return;
+    }
+
+    d->mixpanelEvent->sampler().setSampleRate(eventName, sampleRate);
+    d->publish();
+}
+
+/// Limits how often an event is tracked (see MixpanelEventSampler).
+/// \param eventName as QString containing the event name
+/// \param eventsPerSecond as double containing the sustained rate allowed, 0 removes the limit
+/// \param burstSize as int containing the events that can be tracked at once
+///
+/// \note Called from another thread, the change is queued to the thread of the Mixpanel object.
+///
+
+void Mixpanel::setEventRateLimit(const QString& eventName, const double eventsPerSecond, const int burstSize)
+{
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "setEventRateLimit", Qt::QueuedConnection, Q_ARG(QString, eventName), Q_ARG(double, eventsPerSecond),
+                                  Q_ARG(int, burstSize));
+        return;
+    }
+
+    d->mixpanelEvent->sampler().setRateLimit(eventName, eventsPerSecond, burstSize);
+    d->publish();
+}
+
+/// Imports past events to Mixpanel through the /import endpoint (see MixpanelImporter).
+///
+/// \note The events keep their own "time" property, use MixpanelEvent::stdImportEvent to build them.
+///  The importer takes ownership of the source.
+///
+/// \param source The events to import
+/// \return False if another import is running
+///
+
+bool Mixpanel::importEvents(MixpanelImportSource* source)
+{
+    return d->importer->start(source);
+}
+
+/// Imports the events of a NDJSON file, one event per line.
+///
+/// \param filePath Path of the file, e.g. one written by the MixpanelFileTransport
+/// \return False if the file can not be opened or another import is running
+///
+
+bool Mixpanel::importEventsFile(const QString& filePath)
+{
+    MixpanelFileImportSource* source = new MixpanelFileImportSource(filePath);
+    if (!source->isOpen())
+    {
+        delete source;
+        return false;
+    }
+
+    return d->importer->start(source);
 }
 
 /// Sends a profile "add" update to Mixpanel.
 /// \param property as QString containing the property name
 /// \param value as Double containing the amount to be increased
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
 ///
 
-void Mixpanel::incrementProfileProperty(const QString& property, const double& value)
+void Mixpanel::incrementProfileProperty(const QString& property, const double& value, const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->increment(property, value);
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "incrementProfileProperty", Qt::QueuedConnection, Q_ARG(QString, property), Q_ARG(double, value), Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->increment(property, value, priority);
 }
 
 /// Permanently deletes the identified user's record from People Analytics.
 ///
 /// \note Calling deleteUser deletes an entire record completely. Any future calls
 ///  to People Analytics using the same distinct id will create and store new values.
+///
+/// \param priority High priority messages are sent right away instead of waiting for the next flush
+///
 
-void Mixpanel::deleteUser()
+void Mixpanel::deleteUser(const MixpanelAnalyticsMessage::Priority priority)
 {
-    d->mixpanelPeople->deleteUser();
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "deleteUser", Qt::QueuedConnection, Q_ARG(MixpanelAnalyticsMessage::Priority, priority));
+        return;
+    }
+
+    d->mixpanelPeople->deleteUser(priority);
 }
 
 /// Flushes all messages in the message queue to the Mixpanel server
+///
+/// \note The events staged by other threads are merged first, including the ones in the chunks the
+///  threads have not handed off yet. Called from another thread, the flush is queued to the thread of the
+///  Mixpanel object.
+///
 
 void Mixpanel::flush()
 {
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+        return;
+    }
+
+    d->staging->collect();
+    d->mixpanelPeople->syncProfileCache();
     d->messageQueue->postToServer();
 }
 
+/// Sends the pending messages during at most deadlineMs and persists the ones left.
+///
+/// \note It is called automatically when the application quits with MixpanelConfiguration::shutdownDeadline.
+///  See MixpanelMessageQueue::shutdownCompleted to know how many messages were sent and persisted.
+///
+/// \note Called from another thread, it runs in the thread of the Mixpanel object and the calling thread
+///  waits until it finishes.
+///
+/// \param deadlineMs Maximum time in miliseconds to send the pending messages
+///
+
+void Mixpanel::shutdown(const int deadlineMs)
+{
+    if (!d->isOwnerThread())
+    {
+        QMetaObject::invokeMethod(this, "shutdown", Qt::BlockingQueuedConnection, Q_ARG(int, deadlineMs));
+        return;
+    }
+
+    d->staging->collect();
+    d->mixpanelPeople->syncProfileCache();
+    d->messageQueue->shutdown(deadlineMs);
+}
+
+/// Slot called when the application is about to quit
+///
+/// \note It shuts down during MixpanelConfiguration::shutdownDeadline, see shutdown().
+///
+
+void Mixpanel::appAboutToQuit()
+{
+    qDebug() << "App about to quit -> shutdown Mixpanel";
+    shutdown(d->configuration.shutdownDeadline());
+}
+
+/// Slot called when the admission of the message queue changes, it publishes it to the other threads.
+
+void Mixpanel::admissionChanged(MixpanelMessageQueue::AdmissionStatus admission)
+{
+    d->staging->setAdmission(admission, d->configuration.pressureSampleInterval());
+}
+
 /// Returns a QString containing the date given using the Mixpanel format
 ///
 /// \param dateTime The QDateTime object to convert
@@ -268,4 +720,11 @@ MixpanelMessageQueue& Mixpanel::messageQueue() const
     return *d->messageQueue;
 }
 
+/// Returns the reference to MixpanelImporter
+
+MixpanelImporter& Mixpanel::importer() const
+{
+    return *d->importer;
+}
+
 
@@ -7,7 +7,73 @@
 
 #include "../include/MixpanelAnalyticsMessage.hpp"
 
+#include "../include/MixpanelClock.hpp"
 #include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+/// Returns the position of the value of a key of the JSON objects at a depth (1 is the outer object),
+/// -1 if the key is not found.
+///
+/// \note The strings are skipped as a whole, so their content is never mistaken for a key.
+///
+
+static int findValue(const QByteArray& json, const char* key, const int keyDepth)
+{
+    const char* data = json.constData();
+    const int size = json.size();
+    const int keySize = qstrlen(key);
+
+    int depth = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (data[i] == '{')
+        {
+            depth++;
+        } else if (data[i] == '}') {
+            depth--;
+        } else if (data[i] == '"') {
+            const int start = ++i;
+            while (i < size && data[i] != '"')
+                i += data[i] == '\\' ? 2 : 1;
+
+            if (depth != keyDepth || i - start != keySize || qstrncmp(data + start, key, keySize) != 0)
+                continue;
+
+            int position = i + 1;
+            while (position < size && (data[position] == ' ' || data[position] == '\n'))
+                position++;
+            if (position >= size || data[position] != ':')
+                continue;
+
+            position++;
+            while (position < size && (data[position] == ' ' || data[position] == '\n'))
+                position++;
+            return position;
+        }
+    }
+
+    return -1;
+}
+
+/// Adds a delta to the integer at a position of a JSON message, non integer values are left untouched.
+
+static void shiftInteger(QByteArray& json, const int position, const qint64 delta)
+{
+    if (position < 0)
+        return;
+
+    int end = position;
+    while (end < json.size() && (json.at(end) == '-' || (json.at(end) >= '0' && json.at(end) <= '9')))
+        end++;
+
+    if (end == position || (end < json.size() && (json.at(end) == '.' || json.at(end) == 'e' || json.at(end) == 'E')))
+        return;
+
+    bool ok = false;
+    const qint64 value = json.mid(position, end - position).toLongLong(&ok);
+    if (ok)
+        json.replace(position, end - position, QByteArray::number(value + delta));
+}
 
 class MixpanelAnalyticsMessagePrivate : public QSharedData
 {
@@ -15,6 +81,10 @@ public:
     MixpanelAnalyticsMessagePrivate();
     QByteArray content;
     MixpanelAnalyticsMessage::MessageType type;
+    MixpanelAnalyticsMessage::Priority priority;
+    qint64 enqueueTime;
+    qint64 enqueueClock;
+    qint64 storageId;
 };
 
 /// Creates a MixpanelAnalyticsMessagePrivate object.
@@ -22,6 +92,10 @@ public:
 MixpanelAnalyticsMessagePrivate::MixpanelAnalyticsMessagePrivate()
     : content(QByteArray())
     , type(MixpanelAnalyticsMessage::Profile)
+    , priority(MixpanelAnalyticsMessage::NormalPriority)
+    , enqueueTime(MixpanelClock::currentMSecsSinceEpoch())
+    , enqueueClock(MixpanelClock::elapsed())
+    , storageId(-1)
 {
 
 }
@@ -37,14 +111,36 @@ MixpanelAnalyticsMessage::MixpanelAnalyticsMessage()
 /// Creates a MixpanelAnalyticsMessage object.
 ///
 /// \param messageType Type of the analytic message
-/// \param messageContent Raw data of the analytic message
+/// \param messageContent Raw data of the analytic message, it may be compacted by MixpanelStringPool
+/// \param messagePriority Priority of the analytic message
+///
+
+MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const MessageType messageType, const QByteArray& messageContent, const Priority messagePriority)
+    : d(new MixpanelAnalyticsMessagePrivate)
+{
+    d->type = messageType;
+    d->content = messageContent;
+    d->priority = messagePriority;
+}
+
+/// Creates a MixpanelAnalyticsMessage object queued at a given time, e.g. when it is taken from a MixpanelMessageRing.
+///
+/// \param messageType Type of the analytic message
+/// \param messageContent Raw data of the analytic message, it may be compacted by MixpanelStringPool
+/// \param messagePriority Priority of the analytic message
+/// \param enqueueTime Time the message was queued (ms since epoch)
+/// \param enqueueClock Monotonic clock when the message was queued, -1 if it was restored from a previous run
 ///
 
-MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const MessageType messageType, const QByteArray& messageContent)
+MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const MessageType messageType, const QByteArray& messageContent, const Priority messagePriority,
+                                                   const qint64 enqueueTime, const qint64 enqueueClock)
     : d(new MixpanelAnalyticsMessagePrivate)
 {
     d->type = messageType;
     d->content = messageContent;
+    d->priority = messagePriority;
+    d->enqueueTime = enqueueTime;
+    d->enqueueClock = enqueueClock;
 }
 
 /// Assigns \a other to this MixpanelAnalyticsMessage.
@@ -56,7 +152,7 @@ MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const MixpanelAnalyticsMessag
 
 /// Creates a MixpanelAnalyticsMessage object from a QVaraintMap.
 ///
-/// \param analyticsMap An analytic message cointained in a QVariantMap
+/// \param analyticsMap An analytic message cointained in a QVariantMap (see toStorageMap)
 ///
 
 MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const QVariantMap& analyticsMap)
@@ -64,6 +160,13 @@ MixpanelAnalyticsMessage::MixpanelAnalyticsMessage(const QVariantMap& analyticsM
 {
     d->type = (MixpanelAnalyticsMessage::MessageType) analyticsMap.value("type").toInt();
     d->content = analyticsMap.value("content").toByteArray();
+    d->priority = (MixpanelAnalyticsMessage::Priority) analyticsMap.value("priority").toInt();
+
+    if (analyticsMap.contains("time"))
+    {
+        d->enqueueTime = analyticsMap.value("time").toLongLong();
+        d->enqueueClock = -1;
+    }
 }
 
 
@@ -97,7 +200,7 @@ QNetworkRequest MixpanelAnalyticsMessage::toNetworkRequest() const
     else
         request = g_urlEngageProfile;
 
-    request += "?data=" + QString(d->content.toBase64());
+    request += "?data=" + QString(expandedContent().toBase64());
 
     networkRequest.setUrl(QUrl(request));
 
@@ -113,8 +216,130 @@ QVariantMap MixpanelAnalyticsMessage::toVariantMap() const
 {
     QVariantMap analyticsMap;
 
+    analyticsMap.insert("type", QVariant::fromValue((int)d->type));
+    analyticsMap.insert("content", QVariant::fromValue(MixpanelStringPool::instance().expand(d->content)));
+
+    return analyticsMap;
+}
+
+/// Returns a QVariantMap containing the analytic message to be persisted.
+///
+/// \note Unlike toVariantMap, the content is kept compacted. The string pool entries
+///  must be persisted with it (see MixpanelStringPool::dynamicEntries).
+///
+/// \retun analyticsMap
+///
+
+QVariantMap MixpanelAnalyticsMessage::toStorageMap() const
+{
+    QVariantMap analyticsMap;
+
     analyticsMap.insert("type", QVariant::fromValue((int)d->type));
     analyticsMap.insert("content", QVariant::fromValue(d->content));
+    analyticsMap.insert("time", d->enqueueTime);
+
+    if (d->priority != NormalPriority)
+        analyticsMap.insert("priority", (int)d->priority);
 
     return analyticsMap;
 }
+
+/// Returns the type of the analytic message.
+
+MixpanelAnalyticsMessage::MessageType MixpanelAnalyticsMessage::type() const
+{
+    return d->type;
+}
+
+/// Returns the priority of the analytic message.
+
+MixpanelAnalyticsMessage::Priority MixpanelAnalyticsMessage::priority() const
+{
+    return d->priority;
+}
+
+/// Returns the stored content, it may be compacted by MixpanelStringPool.
+
+QByteArray MixpanelAnalyticsMessage::content() const
+{
+    return d->content;
+}
+
+/// Returns the content as it is sent to the Mixpanel server: expanded (see MixpanelStringPool) and
+/// with its time corrected by the server time estimate (see MixpanelClock).
+///
+/// \note The event "time" (seconds) or profile "$time" (miliseconds) recorded with the device clock is
+///  moved by the difference between the server time and the device time when the message was queued.
+///  The messages restored from a previous run are moved by the current difference instead. The content
+///  is not modified when the difference is below g_minClockCorrection.
+///
+
+QByteArray MixpanelAnalyticsMessage::expandedContent() const
+{
+    return expandedContent(d->type, d->content, d->enqueueTime, d->enqueueClock);
+}
+
+/// Returns the content of a message as it is sent to the Mixpanel server, see expandedContent().
+///
+/// \note It lets a MixpanelMessageBatch expand the records it holds without a MixpanelAnalyticsMessage.
+///
+/// \param type Type of the analytic message
+/// \param compactContent Stored content of the analytic message
+/// \param enqueueTime Time the message was queued (ms since epoch)
+/// \param enqueueClock Monotonic clock when the message was queued, -1 if it was restored from a previous run
+///
+
+QByteArray MixpanelAnalyticsMessage::expandedContent(const MessageType type, const QByteArray& compactContent, const qint64 enqueueTime, const qint64 enqueueClock)
+{
+    QByteArray content = MixpanelStringPool::instance().expand(compactContent);
+    if (!MixpanelClock::hasServerTime())
+        return content;
+
+    const qint64 correction = enqueueClock >= 0 ? MixpanelClock::serverTime(enqueueClock) - enqueueTime
+                                                : MixpanelClock::serverTimeOffset();
+    if (qAbs(correction) < g_minClockCorrection)
+        return content;
+
+    if (type == Event)
+        shiftInteger(content, findValue(content, "time", 2), qRound64(correction / 1000.0));
+    else
+        shiftInteger(content, findValue(content, "$time", 1), correction);
+
+    return content;
+}
+
+/// Returns the size in bytes of the stored content.
+
+int MixpanelAnalyticsMessage::contentSize() const
+{
+    return d->content.size();
+}
+
+/// Returns the time the message was queued (ms since epoch).
+
+qint64 MixpanelAnalyticsMessage::enqueueTime() const
+{
+    return d->enqueueTime;
+}
+
+/// Returns the monotonic clock when the message was queued (see MixpanelClock::elapsed), -1 if it was
+/// restored from a previous run.
+
+qint64 MixpanelAnalyticsMessage::enqueueClock() const
+{
+    return d->enqueueClock;
+}
+
+/// Returns the id of the message in the persistent store, -1 if it has not been stored.
+
+qint64 MixpanelAnalyticsMessage::storageId() const
+{
+    return d->storageId;
+}
+
+/// Sets the id of the message in the persistent store.
+
+void MixpanelAnalyticsMessage::setStorageId(const qint64 storageId)
+{
+    d->storageId = storageId;
+}
@@ -0,0 +1,78 @@
+/*
+ * MixpanelArena.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelArena.hpp"
+
+/// Creates an empty arena.
+///
+/// \param capacity Initial size of the buffer in bytes
+///
+
+MixpanelArena::MixpanelArena(const int capacity)
+    : m_data(new char[qMax(capacity, 1)])
+    , m_size(0)
+    , m_capacity(qMax(capacity, 1))
+{
+}
+
+/// Destructor, frees the buffer.
+
+MixpanelArena::~MixpanelArena()
+{
+    delete[] m_data;
+}
+
+/// Rewinds the arena to encode a new message, keeping the buffer.
+
+void MixpanelArena::clear()
+{
+    m_size = 0;
+}
+
+/// Returns the bytes written since the last clear().
+
+const char* MixpanelArena::constData() const
+{
+    return m_data;
+}
+
+/// Returns the number of bytes written since the last clear().
+
+int MixpanelArena::size() const
+{
+    return m_size;
+}
+
+/// Returns the size of the buffer in bytes.
+
+int MixpanelArena::capacity() const
+{
+    return m_capacity;
+}
+
+/// Returns a copy of the bytes written since the last clear().
+
+QByteArray MixpanelArena::toByteArray() const
+{
+    return QByteArray(m_data, m_size);
+}
+
+/// Doubles the buffer until the given number of bytes can be appended.
+
+void MixpanelArena::grow(const int size)
+{
+    int capacity = m_capacity;
+    while (m_size + size > capacity)
+        capacity *= 2;
+
+    char* data = new char[capacity];
+    memcpy(data, m_data, m_size);
+    delete[] m_data;
+
+    m_data = data;
+    m_capacity = capacity;
+}
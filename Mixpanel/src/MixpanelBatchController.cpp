@@ -0,0 +1,155 @@
+/*
+ * MixpanelBatchController.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelBatchController.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+
+#include "qdebug.h"
+
+/// Creates a MixpanelBatchController object that starts with g_initialBatchSize messages and one batch in flight.
+
+MixpanelBatchController::MixpanelBatchController()
+    : m_minBatchSize(1)
+    , m_maxBatchSize(g_maxBatchSize)
+    , m_maxWindow(g_maxParallelRequests)
+    , m_batchSize(g_initialBatchSize)
+    , m_window(1)
+    , m_windowCredit(0)
+    , m_minRoundTripTime(-1)
+    , m_smoothedRoundTripTime(0)
+    , m_backOffs(0)
+{
+}
+
+/// Sets the bounds of the batch size and the window, the current values are clamped to them.
+///
+/// \param minBatchSize Minimum number of messages of a batch
+/// \param maxBatchSize Maximum number of messages of a batch
+/// \param maxWindow Maximum number of batches in flight
+///
+
+void MixpanelBatchController::setLimits(const int minBatchSize, const int maxBatchSize, const int maxWindow)
+{
+    m_minBatchSize = qMax(1, minBatchSize);
+    m_maxBatchSize = qMax(m_minBatchSize, maxBatchSize);
+    m_maxWindow = qMax(1, maxWindow);
+
+    m_batchSize = qBound(m_minBatchSize, m_batchSize, m_maxBatchSize);
+    m_window = qBound(1, m_window, m_maxWindow);
+}
+
+/// Returns the number of messages of the next batches.
+
+int MixpanelBatchController::batchSize() const
+{
+    return m_batchSize;
+}
+
+/// Returns the number of batches that can be in flight at once.
+
+int MixpanelBatchController::window() const
+{
+    return m_window;
+}
+
+/// Returns the moving average of the round trip time of the accepted batches, in miliseconds.
+
+qint64 MixpanelBatchController::smoothedRoundTripTime() const
+{
+    return m_smoothedRoundTripTime;
+}
+
+/// Returns the number of times the batch size or the window have been decreased.
+
+qint64 MixpanelBatchController::backOffs() const
+{
+    return m_backOffs;
+}
+
+/// Grows the batch size and the window if the round trip time of the batch holds.
+///
+/// \note The minimum round trip time is floored to half the moving average, so a single reply much
+///  faster than the others (e.g. served from a cache) does not stop the growth until the next back off.
+///
+/// \param roundTripTime Time in miliseconds since the batch was sent
+///
+
+void MixpanelBatchController::batchAccepted(const qint64 roundTripTime)
+{
+    recordRoundTripTime(roundTripTime);
+    if (roundTripTime > 2 * qMax(m_minRoundTripTime, m_smoothedRoundTripTime / 2))
+    {
+        m_windowCredit = 0;
+        return;
+    }
+
+    m_batchSize = qMin(m_maxBatchSize, m_batchSize + g_batchSizeIncrement);
+
+    if (++m_windowCredit >= m_window)
+    {
+        m_window = qMin(m_maxWindow, m_window + 1);
+        m_windowCredit = 0;
+    }
+}
+
+/// Stops the growth until the next accepted batch.
+
+void MixpanelBatchController::batchFailed()
+{
+    m_windowCredit = 0;
+}
+
+/// Halves the batch size and the window.
+
+void MixpanelBatchController::batchTimedOut()
+{
+    m_batchSize = qMax(m_minBatchSize, m_batchSize / 2);
+    m_window = qMax(1, m_window / 2);
+    m_windowCredit = 0;
+    m_minRoundTripTime = -1;
+    m_backOffs++;
+
+    qDebug() << "Batch timed out -> batch size" << m_batchSize << "window" << m_window;
+}
+
+/// Halves the batch size.
+
+void MixpanelBatchController::batchTooLarge()
+{
+    m_batchSize = qMax(m_minBatchSize, m_batchSize / 2);
+    m_windowCredit = 0;
+    m_minRoundTripTime = -1;
+    m_backOffs++;
+
+    qDebug() << "Batch too large -> batch size" << m_batchSize;
+}
+
+/// Halves the window.
+
+void MixpanelBatchController::batchThrottled()
+{
+    m_window = qMax(1, m_window / 2);
+    m_windowCredit = 0;
+    m_minRoundTripTime = -1;
+    m_backOffs++;
+
+    qDebug() << "Batch throttled -> window" << m_window;
+}
+
+/// Updates the minimum and the moving average (1/8 weight) of the round trip time.
+
+void MixpanelBatchController::recordRoundTripTime(const qint64 roundTripTime)
+{
+    if (m_minRoundTripTime < 0 || roundTripTime < m_minRoundTripTime)
+        m_minRoundTripTime = roundTripTime;
+
+    if (m_smoothedRoundTripTime == 0)
+        m_smoothedRoundTripTime = roundTripTime;
+    else
+        m_smoothedRoundTripTime += (roundTripTime - m_smoothedRoundTripTime) / 8;
+}
@@ -0,0 +1,161 @@
+/*
+ * MixpanelClock.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelClock.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+
+#include <QDateTime>
+#include <QMutexLocker>
+
+#include "qdebug.h"
+
+/// Returns the clock shared by the whole process.
+
+MixpanelClock& MixpanelClock::instance()
+{
+    static MixpanelClock clock;
+    return clock;
+}
+
+/// Creates a MixpanelClock object and reads the wall clock.
+
+MixpanelClock::MixpanelClock()
+    : m_synchronisation(0)
+    , m_serverClockOffset(0)
+    , m_serverTimeSamples(0)
+{
+    m_monotonicClock.start();
+    m_synchronisations[0].wallClockOffset = QDateTime::currentMSecsSinceEpoch() - m_monotonicClock.elapsed();
+    m_synchronisations[0].nextSynchronisation = g_clockSynchronisationInterval;
+    m_synchronisations[1] = m_synchronisations[0];
+}
+
+/// Returns the current UTC time in miliseconds since epoch.
+///
+/// \note The wall clock is only read when the synchronisation interval has elapsed.
+///
+
+qint64 MixpanelClock::currentMSecsSinceEpoch()
+{
+    MixpanelClock& clock = instance();
+
+    const qint64 now = clock.m_monotonicClock.elapsed();
+    const Synchronisation* synchronisation = &clock.m_synchronisations[int(clock.m_synchronisation)];
+    if (now < synchronisation->nextSynchronisation)
+        return synchronisation->wallClockOffset + now;
+
+    clock.synchronise(now);
+    return clock.m_synchronisations[int(clock.m_synchronisation)].wallClockOffset + now;
+}
+
+/// Returns the miliseconds elapsed on the monotonic clock, unaffected by the changes of the system time.
+
+qint64 MixpanelClock::elapsed()
+{
+    return instance().m_monotonicClock.elapsed();
+}
+
+/// Returns the nanoseconds elapsed on the monotonic clock, to order the events tracked by several threads.
+
+qint64 MixpanelClock::nsecsElapsed()
+{
+    return instance().m_monotonicClock.nsecsElapsed();
+}
+
+/// Reads the wall clock right away, to be called when the system time is known to have changed.
+
+void MixpanelClock::synchronise()
+{
+    MixpanelClock& clock = instance();
+    clock.synchronise(clock.m_monotonicClock.elapsed());
+}
+
+/// Adds a sample of the server time to the estimate.
+///
+/// \note The Date header is truncated to the second and generated when the reply is sent, so the
+///  sample is taken as the middle of that second plus half the round trip time. Samples close to
+///  the estimate are smoothed (weight 1/g_serverTimeSmoothing), the ones further than g_maxServerTimeJump
+///  replace it, as the monotonic clock may have stopped while the device was suspended.
+///
+/// \param serverTime Time of the Date header, in miliseconds since epoch
+/// \param roundTripTime Time elapsed between the request and the reply, in miliseconds
+///
+
+void MixpanelClock::addServerTimeSample(const qint64 serverTime, const qint64 roundTripTime)
+{
+    MixpanelClock& clock = instance();
+
+    const qint64 now = clock.m_monotonicClock.elapsed();
+    const qint64 sampleOffset = serverTime + 500 + qMax(roundTripTime, Q_INT64_C(0)) / 2 - now;
+
+    if (clock.m_serverTimeSamples == 0 || qAbs(sampleOffset - clock.m_serverClockOffset) > g_maxServerTimeJump)
+        clock.m_serverClockOffset = sampleOffset;
+    else
+        clock.m_serverClockOffset += (sampleOffset - clock.m_serverClockOffset) / g_serverTimeSmoothing;
+
+    clock.m_serverTimeSamples++;
+}
+
+/// Returns whether the server time has been sampled.
+
+bool MixpanelClock::hasServerTime()
+{
+    return instance().m_serverTimeSamples > 0;
+}
+
+/// Returns the server time at an instant of the monotonic clock, the device time if the server time
+/// has not been sampled.
+///
+/// \param monotonicTime Instant returned by elapsed()
+/// \return time in miliseconds since epoch
+///
+
+qint64 MixpanelClock::serverTime(const qint64 monotonicTime)
+{
+    MixpanelClock& clock = instance();
+
+    if (clock.m_serverTimeSamples == 0)
+        return currentMSecsSinceEpoch() - clock.m_monotonicClock.elapsed() + monotonicTime;
+
+    return clock.m_serverClockOffset + monotonicTime;
+}
+
+/// Returns the difference between the server time and the device time, in miliseconds.
+
+qint64 MixpanelClock::serverTimeOffset()
+{
+    if (!hasServerTime())
+        return 0;
+
+    const qint64 now = elapsed();
+    return serverTime(now) - currentMSecsSinceEpoch();
+}
+
+/// Discards the server time estimate.
+
+void MixpanelClock::resetServerTime()
+{
+    MixpanelClock& clock = instance();
+    clock.m_serverClockOffset = 0;
+    clock.m_serverTimeSamples = 0;
+}
+
+/// Reads the wall clock and schedules the next synchronisation.
+///
+/// \note The unused slot is written and then published, the readers of the other slot are not disturbed.
+///
+
+void MixpanelClock::synchronise(const qint64 now)
+{
+    QMutexLocker locker(&m_synchronisationMutex);
+
+    const int next = 1 - int(m_synchronisation);
+    m_synchronisations[next].wallClockOffset = QDateTime::currentMSecsSinceEpoch() - now;
+    m_synchronisations[next].nextSynchronisation = now + g_clockSynchronisationInterval;
+    m_synchronisation.fetchAndStoreRelease(next);
+}
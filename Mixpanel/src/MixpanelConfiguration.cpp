@@ -17,6 +17,33 @@ public:
     int flushInterval;
     bool thumbnailFlush;
     int messagesToFlush;
+    MixpanelConfiguration::StorageEngine storageEngine;
+    int shutdownDeadline;
+    int maxQueuedMessages;
+    int maxQueuedBytes;
+    MixpanelConfiguration::DropPolicy dropPolicy;
+    int highWatermark;
+    int lowWatermark;
+    int pressureSampleInterval;
+    int deduplicationWindow;
+    int deduplicationWindowSize;
+    int connectTimeout;
+    int requestTimeout;
+    MixpanelConfiguration::Transport transport;
+    QString transportFilePath;
+    int minBatchSize;
+    int maxBatchSize;
+    int maxInFlightBatches;
+    QString importUrl;
+    QString importApiSecret;
+    int importBatchSize;
+    int importParallelRequests;
+    int maxDeadLetters;
+    qint64 eventTtl;
+    qint64 profileTtl;
+    int maxPersistedMessages;
+    int maxCachedProfiles;
+    QString token;
 };
 
 MixpanelConfigurationPrivate::MixpanelConfigurationPrivate()
@@ -24,6 +51,33 @@ MixpanelConfigurationPrivate::MixpanelConfigurationPrivate()
     , flushInterval(g_defaultFlushInterval)
     , thumbnailFlush(true)
     , messagesToFlush(MAX_SIZE_QUEUE)
+    , storageEngine(MixpanelConfiguration::SettingsStorage)
+    , shutdownDeadline(g_defaultShutdownDeadline)
+    , maxQueuedMessages(0)
+    , maxQueuedBytes(0)
+    , dropPolicy(MixpanelConfiguration::DropNewest)
+    , highWatermark(80)
+    , lowWatermark(50)
+    , pressureSampleInterval(10)
+    , deduplicationWindow(0)
+    , deduplicationWindowSize(g_defaultDeduplicationWindowSize)
+    , connectTimeout(g_defaultConnectTimeout)
+    , requestTimeout(g_defaultRequestTimeout)
+    , transport(MixpanelConfiguration::HttpTransport)
+    , transportFilePath(QString())
+    , minBatchSize(1)
+    , maxBatchSize(g_maxBatchSize)
+    , maxInFlightBatches(g_maxParallelRequests)
+    , importUrl(g_urlImport)
+    , importApiSecret(QString())
+    , importBatchSize(g_maxImportBatchSize)
+    , importParallelRequests(g_maxParallelRequests)
+    , maxDeadLetters(g_maxDeadLetters)
+    , eventTtl(g_defaultEventTtl)
+    , profileTtl(0)
+    , maxPersistedMessages(0)
+    , maxCachedProfiles(0)
+    , token(QString())
 {
 
 }
@@ -106,6 +160,319 @@ void MixpanelConfiguration::setMessagesToFlush(const int numberOfMessages)
         d->messagesToFlush = MAX_SIZE_QUEUE;
 }
 
+/// Sets the storage engine of the pending analytics messages.
+///
+/// \param storageEngine Engine used to persist the analytics messages that have not been posted. The default
+/// value is SettingsStorage.
+///
+
+void MixpanelConfiguration::setStorageEngine(const StorageEngine storageEngine)
+{
+    d->storageEngine = storageEngine;
+}
+
+/// Sets the shutdown deadline.
+///
+/// \param deadline Time in miliseconds that the pending analytics messages are sent for when the application
+/// quits, the messages not sent are persisted. 0 only persists them. The default value is 2000 (2 seconds).
+///
+
+void MixpanelConfiguration::setShutdownDeadline(const int deadline)
+{
+    if (deadline >= 0)
+        d->shutdownDeadline = deadline;
+}
+
+/// Sets the maximum number of messages in the queue.
+///
+/// \param maxMessages Number of messages over which new messages are dropped following the drop policy.
+/// The default value is 0 (unbounded).
+///
+
+void MixpanelConfiguration::setMaxQueuedMessages(const int maxMessages)
+{
+    if (maxMessages >= 0)
+        d->maxQueuedMessages = maxMessages;
+}
+
+/// Sets the maximum size in bytes of the queued messages.
+///
+/// \param maxBytes Size over which new messages are dropped following the drop policy.
+/// The default value is 0 (unbounded).
+///
+
+void MixpanelConfiguration::setMaxQueuedBytes(const int maxBytes)
+{
+    if (maxBytes >= 0)
+        d->maxQueuedBytes = maxBytes;
+}
+
+/// Sets the drop policy used when the queue is over budget.
+///
+/// \param dropPolicy The drop policy. The default value is DropNewest.
+///
+
+void MixpanelConfiguration::setDropPolicy(const DropPolicy dropPolicy)
+{
+    d->dropPolicy = dropPolicy;
+}
+
+/// Sets the high watermark of the queue.
+///
+/// \param percent Percentage of the queue budget (messages or bytes) at which the queue is considered under
+/// pressure. The default value is 80.
+///
+
+void MixpanelConfiguration::setHighWatermark(const int percent)
+{
+    if (percent > 0 && percent <= 100)
+        d->highWatermark = percent;
+}
+
+/// Sets the low watermark of the queue.
+///
+/// \param percent Percentage of the queue budget (messages and bytes) under which the queue is no longer
+/// considered under pressure. The default value is 50.
+///
+
+void MixpanelConfiguration::setLowWatermark(const int percent)
+{
+    if (percent >= 0 && percent <= 100)
+        d->lowWatermark = percent;
+}
+
+/// Sets the sample interval used by the SampleByEventName drop policy.
+///
+/// \param interval Under pressure, only one of every interval events with the same name is accepted.
+/// The default value is 10.
+///
+
+void MixpanelConfiguration::setPressureSampleInterval(const int interval)
+{
+    if (interval > 0)
+        d->pressureSampleInterval = interval;
+}
+
+/// Sets the time span in which identical track calls are considered duplicates.
+///
+/// \param window Time in milliseconds, a track call with the same event name and properties as one done
+/// within this time is discarded. The default value is 0 (no deduplication).
+///
+
+void MixpanelConfiguration::setDeduplicationWindow(const int window)
+{
+    if (window >= 0)
+        d->deduplicationWindow = window;
+}
+
+/// Sets the number of recent track calls remembered to detect duplicates.
+///
+/// \param entries Maximum number of track calls remembered.
+/// The default value is g_defaultDeduplicationWindowSize.
+///
+
+void MixpanelConfiguration::setDeduplicationWindowSize(const int entries)
+{
+    if (entries > 0)
+        d->deduplicationWindowSize = entries;
+}
+
+/// Sets the time to wait for a request to start exchanging data with the Mixpanel server.
+///
+/// \param timeout Time in miliseconds after which a request without upload or download progress is aborted
+/// and its messages retried later, 0 disables it. The default value is g_defaultConnectTimeout.
+///
+
+void MixpanelConfiguration::setConnectTimeout(const int timeout)
+{
+    if (timeout >= 0)
+        d->connectTimeout = timeout;
+}
+
+/// Sets the maximum duration of a request to the Mixpanel server.
+///
+/// \param timeout Time in miliseconds after which a request is aborted and its messages retried later,
+/// 0 disables it. The default value is g_defaultRequestTimeout.
+///
+
+void MixpanelConfiguration::setRequestTimeout(const int timeout)
+{
+    if (timeout >= 0)
+        d->requestTimeout = timeout;
+}
+
+/// Sets the transport the batches of analytics messages are sent with.
+///
+/// \param transport Transport of the message queue (see MixpanelTransport). The default value is HttpTransport.
+///
+
+void MixpanelConfiguration::setTransport(const Transport transport)
+{
+    d->transport = transport;
+}
+
+/// Sets the file the FileTransport appends the messages to.
+///
+/// \param path Path of the NDJSON file. By default g_transportFileName in the application data folder.
+///
+
+void MixpanelConfiguration::setTransportFilePath(const QString& path)
+{
+    d->transportFilePath = path;
+}
+
+/// Sets the minimum number of messages of a batch.
+///
+/// \param size Lower bound of the adaptive batch size (see MixpanelBatchController). The default value is 1.
+///
+
+void MixpanelConfiguration::setMinBatchSize(const int size)
+{
+    if (size > 0)
+        d->minBatchSize = qMin(size, g_maxBatchSize);
+}
+
+/// Sets the maximum number of messages of a batch.
+///
+/// \param size Upper bound of the adaptive batch size, up to g_maxBatchSize (the limit of the Mixpanel API).
+/// The default value is g_maxBatchSize.
+///
+
+void MixpanelConfiguration::setMaxBatchSize(const int size)
+{
+    if (size > 0)
+        d->maxBatchSize = qMin(size, g_maxBatchSize);
+}
+
+/// Sets the maximum number of batches posted at once.
+///
+/// \param batches Upper bound of the adaptive in flight window (see MixpanelBatchController). The default
+/// value is g_maxParallelRequests.
+///
+
+void MixpanelConfiguration::setMaxInFlightBatches(const int batches)
+{
+    if (batches > 0)
+        d->maxInFlightBatches = batches;
+}
+
+/// Sets the endpoint the bulk imports are sent to (see MixpanelImporter).
+///
+/// \param url URL of the Mixpanel /import endpoint. The default value is g_urlImport.
+///
+
+void MixpanelConfiguration::setImportUrl(const QString& url)
+{
+    if (!url.isEmpty())
+        d->importUrl = url;
+}
+
+/// Sets the project secret used to authenticate the bulk imports.
+///
+/// \param secret The API secret of the Mixpanel project, sent with HTTP basic authentication.
+///
+
+void MixpanelConfiguration::setImportApiSecret(const QString& secret)
+{
+    d->importApiSecret = secret;
+}
+
+/// Sets the maximum number of events of a bulk import batch.
+///
+/// \param size Number of events, up to g_maxImportBatchSize (the limit of the Mixpanel /import API).
+/// The batches are also limited to g_maxImportBatchBytes before compression. The default value is
+/// g_maxImportBatchSize.
+///
+
+void MixpanelConfiguration::setImportBatchSize(const int size)
+{
+    if (size > 0)
+        d->importBatchSize = qMin(size, g_maxImportBatchSize);
+}
+
+/// Sets the number of bulk import batches posted at once.
+///
+/// \param requests Number of requests in flight. The default value is g_maxParallelRequests.
+///
+
+void MixpanelConfiguration::setImportParallelRequests(const int requests)
+{
+    if (requests > 0)
+        d->importParallelRequests = requests;
+}
+
+/// Sets the number of messages refused by the Mixpanel server that are kept (see MixpanelDeadLetterStore).
+///
+/// \param messages Number of quarantined messages, the oldest are removed first. The default value is g_maxDeadLetters.
+///
+
+void MixpanelConfiguration::setMaxDeadLetters(const int messages)
+{
+    if (messages > 0)
+        d->maxDeadLetters = messages;
+}
+
+/// Sets how long the event messages are kept waiting to be sent.
+///
+/// \param ttl Time in miliseconds since the event was queued after which it is pruned from the persisted
+/// queue, 0 keeps the events forever. The default value is g_defaultEventTtl (5 days, Mixpanel /track
+/// ignores older events).
+///
+
+void MixpanelConfiguration::setEventTtl(const qint64 ttl)
+{
+    if (ttl >= 0)
+        d->eventTtl = ttl;
+}
+
+/// Sets how long the profile messages are kept waiting to be sent.
+///
+/// \param ttl Time in miliseconds since the profile update was queued after which it is pruned from the
+/// persisted queue, 0 keeps the updates forever. The default value is 0.
+///
+
+void MixpanelConfiguration::setProfileTtl(const qint64 ttl)
+{
+    if (ttl >= 0)
+        d->profileTtl = ttl;
+}
+
+/// Sets the maximum number of messages restored from the persisted queue.
+///
+/// \param maxMessages Only the newest maxMessages messages are kept when the queue is loaded or compacted,
+/// 0 keeps all of them. The default value is 0.
+///
+
+void MixpanelConfiguration::setMaxPersistedMessages(const int maxMessages)
+{
+    if (maxMessages >= 0)
+        d->maxPersistedMessages = maxMessages;
+}
+
+/// Sets the number of profiles kept in the local profile cache (see MixpanelProfileCache).
+///
+/// \param maxProfiles With the cache, only the changed properties are sent in the profile updates and the
+/// known profile properties can be read locally. 0 disables the cache. The default value is 0.
+///
+
+void MixpanelConfiguration::setMaxCachedProfiles(const int maxProfiles)
+{
+    if (maxProfiles >= 0)
+        d->maxCachedProfiles = maxProfiles;
+}
+
+/// Sets the token of the Mixpanel project.
+///
+/// \param token The persisted state (message queue, super properties, distinct id, dead letters and profile
+/// cache) is kept apart for every token, so several Mixpanel instances can send to different projects.
+/// By default it is empty and the state is shared, as set with Mixpanel::setToken.
+///
+
+void MixpanelConfiguration::setToken(const QString& token)
+{
+    d->token = token;
+}
+
 /// Returns the flush mechanism.
 ///
 /// \return flush mechanism
@@ -145,3 +512,273 @@ int MixpanelConfiguration::messatesToFlush() const
 {
     return d->messagesToFlush;
 }
+
+/// Returns the storage engine of the pending analytics messages.
+///
+/// \return storage engine
+///
+
+MixpanelConfiguration::StorageEngine MixpanelConfiguration::storageEngine() const
+{
+    return d->storageEngine;
+}
+
+/// Returns the shutdown deadline.
+///
+/// \return shutdown deadline (ms)
+///
+
+int MixpanelConfiguration::shutdownDeadline() const
+{
+    return d->shutdownDeadline;
+}
+
+/// Returns the maximum number of messages in the queue.
+///
+/// \return maximum number of messages, 0 if unbounded
+///
+
+int MixpanelConfiguration::maxQueuedMessages() const
+{
+    return d->maxQueuedMessages;
+}
+
+/// Returns the maximum size in bytes of the queued messages.
+///
+/// \return maximum size, 0 if unbounded
+///
+
+int MixpanelConfiguration::maxQueuedBytes() const
+{
+    return d->maxQueuedBytes;
+}
+
+/// Returns the drop policy used when the queue is over budget.
+///
+/// \return drop policy
+///
+
+MixpanelConfiguration::DropPolicy MixpanelConfiguration::dropPolicy() const
+{
+    return d->dropPolicy;
+}
+
+/// Returns the high watermark of the queue.
+///
+/// \return percentage of the queue budget
+///
+
+int MixpanelConfiguration::highWatermark() const
+{
+    return d->highWatermark;
+}
+
+/// Returns the low watermark of the queue.
+///
+/// \return percentage of the queue budget
+///
+
+int MixpanelConfiguration::lowWatermark() const
+{
+    return d->lowWatermark;
+}
+
+/// Returns the sample interval used by the SampleByEventName drop policy.
+///
+/// \return sample interval
+///
+
+int MixpanelConfiguration::pressureSampleInterval() const
+{
+    return d->pressureSampleInterval;
+}
+
+/// Returns the time span in which identical track calls are considered duplicates.
+///
+/// \return time in milliseconds
+///
+
+int MixpanelConfiguration::deduplicationWindow() const
+{
+    return d->deduplicationWindow;
+}
+
+/// Returns the number of recent track calls remembered to detect duplicates.
+///
+/// \return number of track calls
+///
+
+int MixpanelConfiguration::deduplicationWindowSize() const
+{
+    return d->deduplicationWindowSize;
+}
+
+/// Returns the time to wait for a request to start exchanging data with the Mixpanel server.
+///
+/// \return time in miliseconds
+///
+
+int MixpanelConfiguration::connectTimeout() const
+{
+    return d->connectTimeout;
+}
+
+/// Returns the maximum duration of a request to the Mixpanel server.
+///
+/// \return time in miliseconds
+///
+
+int MixpanelConfiguration::requestTimeout() const
+{
+    return d->requestTimeout;
+}
+
+/// Returns the transport the batches of analytics messages are sent with.
+///
+/// \return transport
+///
+
+MixpanelConfiguration::Transport MixpanelConfiguration::transport() const
+{
+    return d->transport;
+}
+
+/// Returns the file the FileTransport appends the messages to.
+///
+/// \return path of the NDJSON file, empty for the default one
+///
+
+QString MixpanelConfiguration::transportFilePath() const
+{
+    return d->transportFilePath;
+}
+
+/// Returns the minimum number of messages of a batch.
+///
+/// \return minimum batch size
+///
+
+int MixpanelConfiguration::minBatchSize() const
+{
+    return d->minBatchSize;
+}
+
+/// Returns the maximum number of messages of a batch.
+///
+/// \return maximum batch size
+///
+
+int MixpanelConfiguration::maxBatchSize() const
+{
+    return d->maxBatchSize;
+}
+
+/// Returns the maximum number of batches posted at once.
+///
+/// \return maximum in flight batches
+///
+
+int MixpanelConfiguration::maxInFlightBatches() const
+{
+    return d->maxInFlightBatches;
+}
+
+/// Returns the endpoint the bulk imports are sent to.
+///
+/// \return import url
+///
+
+QString MixpanelConfiguration::importUrl() const
+{
+    return d->importUrl;
+}
+
+/// Returns the project secret used to authenticate the bulk imports.
+///
+/// \return API secret
+///
+
+QString MixpanelConfiguration::importApiSecret() const
+{
+    return d->importApiSecret;
+}
+
+/// Returns the maximum number of events of a bulk import batch.
+///
+/// \return import batch size
+///
+
+int MixpanelConfiguration::importBatchSize() const
+{
+    return d->importBatchSize;
+}
+
+/// Returns the number of bulk import batches posted at once.
+///
+/// \return import parallel requests
+///
+
+int MixpanelConfiguration::importParallelRequests() const
+{
+    return d->importParallelRequests;
+}
+
+/// Returns the number of messages refused by the Mixpanel server that are kept.
+///
+/// \return maximum dead letters
+///
+
+int MixpanelConfiguration::maxDeadLetters() const
+{
+    return d->maxDeadLetters;
+}
+
+/// Returns how long the event messages are kept waiting to be sent.
+///
+/// \return event ttl in miliseconds
+///
+
+qint64 MixpanelConfiguration::eventTtl() const
+{
+    return d->eventTtl;
+}
+
+/// Returns how long the profile messages are kept waiting to be sent.
+///
+/// \return profile ttl in miliseconds
+///
+
+qint64 MixpanelConfiguration::profileTtl() const
+{
+    return d->profileTtl;
+}
+
+/// Returns the maximum number of messages restored from the persisted queue.
+///
+/// \return maximum persisted messages
+///
+
+int MixpanelConfiguration::maxPersistedMessages() const
+{
+    return d->maxPersistedMessages;
+}
+
+/// Returns the number of profiles kept in the local profile cache, 0 if disabled.
+///
+/// \return maximum cached profiles
+///
+
+int MixpanelConfiguration::maxCachedProfiles() const
+{
+    return d->maxCachedProfiles;
+}
+
+/// Returns the token of the Mixpanel project.
+///
+/// \return token
+///
+
+QString MixpanelConfiguration::token() const
+{
+    return d->token;
+}
@@ -13,5 +13,40 @@ const char* g_organizationName = "Mixpanel BB10 Library";
 const char* g_superPropertiesKey = "Super properties";
 const char* g_peopleDistinctIdKey = "People distinctId";
 const char* g_analyticsMessagesKey = "Analytics messages";
+const char* g_stringPoolKey = "String pool";
+const char* g_sqliteQueueFileName = "mixpanel_queue.db";
+const char* g_sampleRateProperty = "sample_rate";
+const char* g_durationProperty = "$duration";
+const char* g_transportFileName = "mixpanel_capture.ndjson";
+const char* g_deadLettersKey = "Dead letters";
+const char* g_profileCacheKey = "Profile cache";
 const int MAX_SIZE_QUEUE = 20;
 const int g_defaultFlushInterval = 1800000;
+const int g_defaultShutdownDeadline = 2000;
+const int g_maxBatchSize = 50;
+const int g_maxParallelRequests = 4;
+const int g_maxSharedRequests = 6;
+const int g_initialBatchSize = 10;
+const int g_batchSizeIncrement = 5;
+const int g_defaultDeduplicationWindowSize = 1024;
+const int g_defaultConnectTimeout = 15000;
+const int g_defaultRequestTimeout = 60000;
+const char* g_urlImport = "https://api.mixpanel.com/import";
+const int g_maxImportBatchSize = 2000;
+const int g_maxImportBatchBytes = 10485760;
+const int g_maxImportAttempts = 3;
+const int g_importRetryDelay = 2000;
+const int g_maxDeadLetters = 200;
+const qint64 g_defaultEventTtl = Q_INT64_C(432000000);
+const int g_maxEventTimers = 4096;
+const int g_clockSynchronisationInterval = 60000;
+const int g_serverTimeSmoothing = 8;
+const int g_maxServerTimeJump = 60000;
+const int g_minClockCorrection = 1000;
+const int g_maxCachedProfileProperties = 256;
+const int g_profileCacheSyncDelay = 1000;
+const int g_stagingChunkSize = 65536;
+const int g_stagingLatency = 100;
+const int g_arenaSize = 4096;
+const int g_messageSlabSize = 65536;
+const int g_messageStoreSyncDelay = 50;
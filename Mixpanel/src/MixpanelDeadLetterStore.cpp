@@ -0,0 +1,128 @@
+/*
+ * MixpanelDeadLetterStore.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelDeadLetterStore.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelSettings.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+#include <QDateTime>
+
+#include "qdebug.h"
+
+/// Creates a MixpanelDeadLetterStore object.
+///
+/// \param maxMessages Number of messages kept, by default g_maxDeadLetters
+///
+
+MixpanelDeadLetterStore::MixpanelDeadLetterStore(const int maxMessages)
+    : m_maxMessages(maxMessages > 0 ? maxMessages : g_maxDeadLetters)
+    , m_loaded(false)
+{
+}
+
+/// Sets the number of messages kept, the oldest ones are removed first.
+
+void MixpanelDeadLetterStore::setMaxMessages(const int maxMessages)
+{
+    if (maxMessages > 0)
+        m_maxMessages = maxMessages;
+}
+
+/// Sets the namespace of the persisted messages (see MixpanelSettings), they are read again when needed.
+
+void MixpanelDeadLetterStore::setStorageNamespace(const QString& storageNamespace)
+{
+    if (storageNamespace == m_storageNamespace)
+        return;
+
+    m_storageNamespace = storageNamespace;
+    m_messages.clear();
+    m_loaded = false;
+}
+
+/// Quarantines some messages.
+///
+/// \param messages The messages refused
+/// \param errors The reason each message has been refused
+///
+
+void MixpanelDeadLetterStore::append(const QList<MixpanelAnalyticsMessage>& messages, const QStringList& errors)
+{
+    if (messages.isEmpty())
+        return;
+
+    load();
+
+    const MixpanelStringPool& stringPool = MixpanelStringPool::instance();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (int i = 0; i < messages.size(); ++i)
+    {
+        QVariantMap deadLetter;
+        deadLetter.insert("type", int(messages.at(i).type()));
+        deadLetter.insert("content", stringPool.expand(messages.at(i).content()));
+        deadLetter.insert("error", errors.value(i));
+        deadLetter.insert("time", now);
+        m_messages.append(deadLetter);
+    }
+
+    while (m_messages.size() > m_maxMessages)
+        m_messages.removeFirst();
+
+    qWarning() << "Analytic messages quarantined (" << messages.size() << "), dead letters:" << m_messages.size();
+
+    MixpanelSettings settings(m_storageNamespace);
+    settings.setValue(g_deadLettersKey, m_messages);
+}
+
+/// Returns the quarantined messages, the oldest first.
+///
+/// \return a QVariantList of QVariantMap containing:
+///     - type: the MixpanelAnalyticsMessage::MessageType of the message
+///     - content: the message as sent to Mixpanel
+///     - error: the reason why the message has been refused
+///     - time: when the message has been refused, in miliseconds since epoch
+///
+
+QVariantList MixpanelDeadLetterStore::messages() const
+{
+    load();
+    return m_messages;
+}
+
+/// Returns the number of quarantined messages.
+
+int MixpanelDeadLetterStore::size() const
+{
+    load();
+    return m_messages.size();
+}
+
+/// Removes all the quarantined messages.
+
+void MixpanelDeadLetterStore::clear()
+{
+    m_messages.clear();
+    m_loaded = true;
+
+    MixpanelSettings settings(m_storageNamespace);
+    settings.remove(g_deadLettersKey);
+}
+
+/// Reads the quarantined messages from QSettings the first time they are needed.
+
+void MixpanelDeadLetterStore::load() const
+{
+    if (m_loaded)
+        return;
+
+    MixpanelSettings settings(m_storageNamespace);
+    m_messages = settings.value(g_deadLettersKey).toList();
+    m_loaded = true;
+}
@@ -6,27 +6,259 @@
  */
 
 #include "../include/MixpanelEvent.hpp"
+#include "../include/MixpanelArena.hpp"
 #include "../include/MixpanelPersistentIdentity.hpp"
-
-#include <bb/data/JsonDataAccess>
+#include "../include/MixpanelEventBuilder.hpp"
+#include "../include/MixpanelJsonWriter.hpp"
+#include "../include/MixpanelEventSampler.hpp"
+#include "../include/MixpanelEventTimers.hpp"
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelConstants.hpp"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QVector>
 
-
-using namespace bb::data;
-
+#include "qdebug.h"
 
 class MixpanelEventPrivate {
 public:
+    MixpanelEventPrivate() : arena(g_arenaSize), sink(NULL) {}
+
+    MixpanelArena arena;
+    MixpanelEventSink* sink;
     MixpanelPersistentIdentity persistentIdentity;
+    MixpanelEventSampler sampler;
+    MixpanelEventTimers timers;
+
+    int deduplicationWindow;
+    QVector<QPair<quint64, qint64> > recentEvents;
+    int recentEventsHead;
+    QHash<quint64, qint64> recentEventTimes;
+    QElapsedTimer deduplicationClock;
+    qint64 duplicateEvents;
 
 };
 
+/// Digits of the base 36 numbers of the $insert_id values
+static const char g_base36Digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/// Returns the name of the $insert_id property.
+
+static const QString& insertIdKey()
+{
+    static const QString key(QLatin1String("$insert_id"));
+    return key;
+}
+
+/// Returns the name of the sample rate property.
+
+static const QString& sampleRateKey()
+{
+    static const QString key(QLatin1String(g_sampleRateProperty));
+    return key;
+}
+
+/// Returns the name of the duration property.
+
+static const QString& durationKey()
+{
+    static const QString key(QLatin1String(g_durationProperty));
+    return key;
+}
+
+/// Returns the 64 bit FNV-1a hash of an encoded message, to find duplicate track calls.
+///
+/// \note 32 bits are not enough: two different track calls among a few tens of thousands would be likely
+///  to share their hash, and the second one would be discarded as a duplicate.
+///
+
+static quint64 hashBytes(const char* data, const int size)
+{
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (int i = 0; i < size; ++i)
+    {
+        hash ^= uchar(data[i]);
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/// Starts a track message in the arena, up to the opening brace of its properties.
+///
+/// \return False if the name is not valid Unicode
+///
+
+static bool beginTrackEvent(MixpanelArena& out, const QString& name)
+{
+    out.clear();
+    out.append("{\"event\":", 9);
+    const bool valid = MixpanelJsonWriter::appendString(out, name);
+    out.append(",\"properties\":{", 15);
+    return valid;
+}
+
+/// Appends the properties passed to track, but the ones set by the library.
+///
+/// \return False if any key or string value is not valid Unicode
+///
+
+static bool appendProperties(MixpanelArena& out, const QVariantMap& properties, bool& first)
+{
+    bool valid = true;
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+    {
+        if (MixpanelEventBuilder::isReservedKey(it.key()))
+            continue;
+
+        if (!first)
+            out.append(',');
+        first = false;
+
+        valid &= MixpanelJsonWriter::appendKey(out, it.key());
+        valid &= MixpanelJsonWriter::appendVariant(out, it.value());
+    }
+
+    return valid;
+}
+
+/// Appends the properties of the map that have not been written yet.
+///
+/// \param written The properties passed to track, a QVariantMap or a MixpanelEventBuilder
+/// \param properties The super or referrer properties to append
+/// \param shadowing Properties already appended that take precedence, or NULL
+/// \return False if any key or string value is not valid Unicode
+///
+
+template <typename Properties>
+static bool appendMissingProperties(MixpanelArena& out, const Properties& written, const QVariantMap& properties, const QVariantMap* shadowing, bool& first)
+{
+    bool valid = true;
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+    {
+        if (written.contains(it.key()) || MixpanelEventBuilder::isReservedKey(it.key()) || (shadowing && shadowing->contains(it.key())))
+            continue;
+
+        if (!first)
+            out.append(',');
+        first = false;
+
+        valid &= MixpanelJsonWriter::appendKey(out, it.key());
+        valid &= MixpanelJsonWriter::appendVariant(out, it.value());
+    }
+
+    return valid;
+}
+
+/// Returns the random process prefix of the $insert_id values.
+
+static QByteArray insertIdPrefix(const void* address)
+{
+    const quint64 seed = (quint64(QDateTime::currentMSecsSinceEpoch()) << 16)
+                       ^ quint64(QCoreApplication::applicationPid())
+                       ^ (quint64(quintptr(address)) << 24);
+    return QByteArray::number(seed, 36) + '-';
+}
+
+/// Appends a new $insert_id, unique for every message recorded.
+///
+/// \note It is a random process prefix followed by a counter, both in base 36, so it is short and
+/// generated without locks, from any thread. Mixpanel discards the messages with an $insert_id already
+/// received, which makes the retries of a message whose reply was lost idempotent.
+///
+
+static void appendInsertId(MixpanelArena& out)
+{
+    static QAtomicInt counter(0);
+    static const QByteArray prefix = insertIdPrefix(&counter);
+
+    uint value = uint(counter.fetchAndAddRelaxed(1));
+    char buffer[8];
+    char* end = buffer + sizeof(buffer);
+    char* begin = end;
+    do
+    {
+        *--begin = g_base36Digits[value % 36];
+        value /= 36;
+    } while (value != 0);
+
+    out.append(prefix);
+    out.append(begin, int(end - begin));
+}
+
+/// Appends the properties set by the library and closes a track message.
+///
+/// \note The properties passed to track take precedence over the super properties, and those over the
+///  referrer properties. Token, distinct id and time are always set by the library.
+///
+/// \param written The properties passed to track, a QVariantMap or a MixpanelEventBuilder
+/// \param sampleRate Sample rate of the event, added when it is below 1
+/// \param duration Miliseconds since timeEvent() was called, added as seconds when it is not negative
+/// \param first Whether no property has been written yet
+/// \return False if any string set by the library is not valid Unicode
+///
+
+template <typename Properties>
+static bool finishTrackEvent(MixpanelArena& out, const MixpanelPersistentIdentity& identity, const Properties& written, const double sampleRate, const qint64 duration, bool first)
+{
+    const QVariantMap superProperties = identity.eventSuperProperties();
+    bool valid = appendMissingProperties(out, written, superProperties, NULL, first);
+    valid &= appendMissingProperties(out, written, identity.referrerProperties(), &superProperties, first);
+
+    if (!first)
+        out.append(',');
+
+    if (sampleRate < 1.0 && !written.contains(sampleRateKey()))
+    {
+        MixpanelJsonWriter::appendKey(out, sampleRateKey());
+        MixpanelJsonWriter::appendNumber(out, sampleRate);
+        out.append(',');
+    }
+
+    if (duration >= 0 && !written.contains(durationKey()))
+    {
+        MixpanelJsonWriter::appendKey(out, durationKey());
+        MixpanelJsonWriter::appendNumber(out, duration / 1000.0);
+        out.append(',');
+    }
+
+    out.append("\"token\":", 8);
+    valid &= MixpanelJsonWriter::appendString(out, identity.token());
+
+    const QString distinctId = identity.eventDistinctId();
+    if (!distinctId.isEmpty())
+    {
+        out.append(",\"distinct_id\":", 15);
+        valid &= MixpanelJsonWriter::appendString(out, distinctId);
+    }
+
+    out.append(",\"time\":", 8);
+    MixpanelJsonWriter::appendNumber(out, MixpanelClock::currentMSecsSinceEpoch() / 1000);
+
+    if (!written.contains(insertIdKey()))
+    {
+        out.append(",\"$insert_id\":\"", 15);
+        appendInsertId(out);
+        out.append('"');
+    }
+
+    out.append("}}", 2);
+    return valid;
+}
+
 /// Creates a MixpanelEvent object.
 
 MixpanelEvent::MixpanelEvent(QObject* parent)
     : QObject(parent)
     , d(new MixpanelEventPrivate)
 {
+    d->deduplicationWindow = 0;
+    d->recentEventsHead = 0;
+    d->duplicateEvents = 0;
+    d->deduplicationClock.start();
 
 }
 
@@ -48,6 +280,16 @@ void MixpanelEvent::setDistinctId(const QString& distinctId)
     d->persistentIdentity.setEventDistinctId(distinctId);
 }
 
+/// Sets the sink the messages are written to instead of emitting recordEventMessage().
+///
+/// \param sink The sink, NULL to emit the signal again
+///
+
+void MixpanelEvent::setSink(MixpanelEventSink* sink)
+{
+    d->sink = sink;
+}
+
 /// Returns the distinct id used for the events.
 ///
 /// \return event distinct id
@@ -68,6 +310,67 @@ MixpanelPersistentIdentity& MixpanelEvent::persistentIdentity()
     return d->persistentIdentity;
 }
 
+/// Returns the sampler that decides which events are tracked.
+///
+/// \return event sampler
+///
+
+MixpanelEventSampler& MixpanelEvent::sampler()
+{
+    return d->sampler;
+}
+
+/// Starts timing an event. The next time the event is tracked, the time elapsed since this call is
+/// added to it as the $duration property, in seconds.
+///
+/// \note Calling it again for the same event starts the timer again. Only the last g_maxEventTimers
+/// timers are kept.
+///
+/// \param name The name of the event to time
+///
+
+void MixpanelEvent::timeEvent(const QString& name)
+{
+    d->timers.start(name);
+}
+
+/// Returns the timers of the events being timed.
+///
+/// \return event timers
+///
+
+MixpanelEventTimers& MixpanelEvent::timers()
+{
+    return d->timers;
+}
+
+/// Sets the time span in which identical track calls are discarded as duplicates.
+///
+/// \param window Time in milliseconds, 0 disables the deduplication
+/// \param maxEntries Maximum number of recent track calls remembered, 0 also disables the deduplication
+///
+
+void MixpanelEvent::setDeduplicationWindow(const int window, const int maxEntries)
+{
+    d->deduplicationWindow = maxEntries > 0 ? window : 0;
+    d->recentEvents.clear();
+    d->recentEventTimes.clear();
+    d->recentEventsHead = 0;
+
+    if (d->deduplicationWindow > 0)
+        d->recentEvents.resize(maxEntries);
+}
+
+/// Returns the number of track calls discarded as duplicates.
+///
+/// \return duplicate events
+///
+
+qint64 MixpanelEvent::duplicateEvents() const
+{
+    return d->duplicateEvents;
+}
+
 ///
 /// Track an event.
 ///
@@ -79,26 +382,38 @@ MixpanelPersistentIdentity& MixpanelEvent::persistentIdentity()
 /// \param eventName The name of the event to send
 /// \param properties A QVariantMap containing the key value pairs of the properties to include in this event.
 ///                   Pass an empty QVariantMap if no extra properties exist.
+/// \param priority High priority events are sent right away instead of waiting for the next flush
 ////
 
-void MixpanelEvent::track(const QString& name, const QVariantMap& properties)
+void MixpanelEvent::track(const QString& name, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
+    double sampleRate;
+    if (!d->sampler.accept(name, d->persistentIdentity.eventDistinctId(), sampleRate))
+        return;
+
     if (eventHasErrors(name, properties))
     {
         qWarning() << "Event invalid -> Analytic message not recorded";
         return;
     }
 
-    QVariantMap updatedProperties(properties);
-    updatedProperties.unite(d->persistentIdentity.referrerProperties());
-    updatedProperties.unite(d->persistentIdentity.eventSuperProperties());
+    bool first = true;
+    bool valid = beginTrackEvent(d->arena, name);
+    valid &= appendProperties(d->arena, properties, first);
 
-    QByteArray eventData = stdTrackEvent(name, updatedProperties);
+    if (valid && d->deduplicationWindow > 0 && isDuplicate(hashBytes(d->arena.constData(), d->arena.size())))
+        return;
 
-    if (!eventData.isEmpty())
-        emit recordEventMessage(eventData);
-    else
+    const qint64 duration = valid ? d->timers.take(name) : -1;
+    valid &= finishTrackEvent(d->arena, d->persistentIdentity, properties, sampleRate, duration, first);
+    if (!valid)
+    {
+        qWarning() << "Event text is not valid Unicode -> Analytic message not recorded";
         emit trackError(InvalidJson, name, properties);
+        return;
+    }
+
+    recordMessage(priority);
 }
 
 /// Returns whether the event has errors
@@ -129,18 +444,91 @@ bool MixpanelEvent::eventHasErrors(const QString& eventName, const QVariantMap&
     return false;
 }
 
+/// Returns whether an identical event has been tracked within the deduplication window, and records it otherwise.
+///
+/// \note The recent events are kept in a ring, so only the last maxEntries track calls are remembered.
+///
+/// \param eventHash Hash of the event name and the properties passed to track
+///
+
+bool MixpanelEvent::isDuplicate(const quint64 eventHash)
+{
+    const qint64 now = d->deduplicationClock.elapsed();
+
+    QHash<quint64, qint64>::const_iterator it = d->recentEventTimes.constFind(eventHash);
+    if (it != d->recentEventTimes.constEnd() && now - it.value() < d->deduplicationWindow)
+    {
+        qDebug() << "Duplicate event -> Analytic message not recorded";
+        d->duplicateEvents++;
+        return true;
+    }
+
+    QPair<quint64, qint64>& oldest = d->recentEvents[d->recentEventsHead];
+    if (oldest.second > 0 && d->recentEventTimes.value(oldest.first) == oldest.second)
+        d->recentEventTimes.remove(oldest.first);
+
+    oldest = qMakePair(eventHash, qMax(now, Q_INT64_C(1)));
+    d->recentEventTimes.insert(eventHash, oldest.second);
+    d->recentEventsHead = (d->recentEventsHead + 1) % d->recentEvents.size();
+
+    return false;
+}
+
+/// Returns a new $insert_id, unique for every message recorded.
+///
+/// \note See appendInsertId().
+///
+
+QByteArray MixpanelEvent::nextInsertId()
+{
+    MixpanelArena insertId(32);
+    appendInsertId(insertId);
+    return insertId.toByteArray();
+}
+
 ///
 /// Creates a standar raw event message.
 ///
 /// \param name The name of the event to send
 /// \param properties A QVariantMap containing the key value pairs of the properties to include in this event.
+/// \return the message, empty if any text of the event is not valid Unicode
 ////
 
 QByteArray MixpanelEvent::stdTrackEvent(const QString& name, const QVariantMap& properties) const
+{
+    bool first = true;
+    bool valid = beginTrackEvent(d->arena, name);
+    valid &= appendProperties(d->arena, properties, first);
+    valid &= finishTrackEvent(d->arena, d->persistentIdentity, properties, 1.0, -1, first);
+
+    return valid ? d->arena.toByteArray() : QByteArray();
+}
+
+///
+/// Creates a raw event message to be sent with MixpanelImporter.
+///
+/// \note Unlike stdTrackEvent, the event keeps the time it was recorded at, in miliseconds. If the
+/// properties already contain a "time" property it is used instead of the given time.
+///
+/// \param name The name of the event
+/// \param properties A QVariantMap containing the key value pairs of the properties to include in this event.
+/// \param time The time the event was recorded at
+/// \return the message, empty if any text of the event is not valid Unicode
+///
+
+QByteArray MixpanelEvent::stdImportEvent(const QString& name, const QVariantMap& properties, const QDateTime& time) const
+{
+    return stdEvent(name, properties, properties.contains("time") ? properties.value("time") : QVariant(time.toMSecsSinceEpoch()));
+}
+
+///
+/// Encodes an event message with its token, distinct id, time and $insert_id.
+///
+
+QByteArray MixpanelEvent::stdEvent(const QString& name, const QVariantMap& properties, const QVariant& time) const
 {
     QVariantMap eventProperties(properties);
     QVariantMap eventData;
-    JsonDataAccess dataAccess;
     QByteArray eventMessageData;
 
     eventProperties.insert("token", d->persistentIdentity.token());
@@ -148,22 +536,87 @@ QByteArray MixpanelEvent::stdTrackEvent(const QString& name, const QVariantMap&
     if(!d->persistentIdentity.eventDistinctId().isEmpty())
         eventProperties.insert("distinct_id", d->persistentIdentity.eventDistinctId());
 
-    eventProperties.insert("time", QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() / 1000);
+    eventProperties.insert("time", time);
+
+    if (!eventProperties.contains("$insert_id"))
+        eventProperties.insert("$insert_id", QString::fromLatin1(nextInsertId()));
 
     eventData.insert("event", name);
     eventData.insert("properties", eventProperties);
 
-    dataAccess.saveToBuffer(eventData, &eventMessageData);
+    if (!MixpanelJsonWriter::appendVariantMap(eventMessageData, eventData))
+        return QByteArray();
 
-    if (dataAccess.hasError())
+    return eventMessageData;
+}
+
+///
+/// Track an event built with a MixpanelEventBuilder.
+///
+/// \note It behaves as track(QString, QVariantMap) but the properties are already encoded,
+/// so no QVariantMap is built for the event.
+///
+/// \param builder The event to send
+/// \param priority High priority events are sent right away instead of waiting for the next flush
+///
+
+void MixpanelEvent::track(const MixpanelEventBuilder& builder, const MixpanelAnalyticsMessage::Priority priority)
+{
+    double sampleRate;
+    if (!d->sampler.accept(builder.name(), d->persistentIdentity.eventDistinctId(), sampleRate))
+        return;
+
+    if (eventHasErrors(builder.name(), QVariantMap()))
     {
-        qWarning() << "JsonDataAccess has errors";
-        return QByteArray();
+        qWarning() << "Event invalid -> Analytic message not recorded";
+        return;
     }
 
-    return eventMessageData;
+    bool valid = builder.isValid();
+    valid &= beginTrackEvent(d->arena, builder.name());
+    d->arena.append(builder.encodedProperties());
+
+    if (valid && d->deduplicationWindow > 0 && isDuplicate(hashBytes(d->arena.constData(), d->arena.size())))
+        return;
+
+    const qint64 duration = valid ? d->timers.take(builder.name()) : -1;
+    valid &= finishTrackEvent(d->arena, d->persistentIdentity, builder, sampleRate, duration, builder.isEmpty());
+    if (!valid)
+    {
+        qWarning() << "Event text is not valid Unicode -> Analytic message not recorded";
+        emit trackError(InvalidJson, builder.name(), QVariantMap());
+        return;
+    }
+
+    recordMessage(priority);
 }
 
+///
+/// Creates a standar raw event message from an event builder.
+///
+/// \note The properties added to the builder take precedence over the super properties, and those
+/// over the referrer properties. Token, distinct id and time are always set by the library.
+///
+/// \param builder The event to encode
+/// \return the message, empty if any text of the event is not valid Unicode
+///
+
+QByteArray MixpanelEvent::stdTrackEvent(const MixpanelEventBuilder& builder) const
+{
+    bool valid = builder.isValid();
+    valid &= beginTrackEvent(d->arena, builder.name());
+    d->arena.append(builder.encodedProperties());
+    valid &= finishTrackEvent(d->arena, d->persistentIdentity, builder, 1.0, -1, builder.isEmpty());
 
+    return valid ? d->arena.toByteArray() : QByteArray();
+}
 
+/// Hands the message encoded in the arena to the sink, or emits it with recordEventMessage().
 
+void MixpanelEvent::recordMessage(const MixpanelAnalyticsMessage::Priority priority)
+{
+    if (d->sink)
+        d->sink->recordEventMessage(d->arena.constData(), d->arena.size(), priority);
+    else
+        emit recordEventMessage(d->arena.toByteArray(), priority);
+}
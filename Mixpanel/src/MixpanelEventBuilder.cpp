@@ -0,0 +1,189 @@
+/*
+ * MixpanelEventBuilder.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelEventBuilder.hpp"
+
+#include "../include/MixpanelJsonWriter.hpp"
+
+#include "qdebug.h"
+
+/// Initial capacity of the encoding buffer, enough for most events without reallocation
+static const int g_builderBufferReserve = 256;
+
+/// Creates a MixpanelEventBuilder object.
+///
+/// \param eventName The name of the event to track
+///
+
+MixpanelEventBuilder::MixpanelEventBuilder(const QString& eventName)
+    : m_name(eventName)
+    , m_valid(true)
+{
+    m_properties.reserve(g_builderBufferReserve);
+}
+
+/// Adds an integer property.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, int value)
+{
+    if (beginProperty(key))
+        MixpanelJsonWriter::appendNumber(m_properties, value);
+    return *this;
+}
+
+/// Adds a 64 bits integer property.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, qint64 value)
+{
+    if (beginProperty(key))
+        MixpanelJsonWriter::appendNumber(m_properties, value);
+    return *this;
+}
+
+/// Adds a floating point property.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, double value)
+{
+    if (beginProperty(key))
+        MixpanelJsonWriter::appendNumber(m_properties, value);
+    return *this;
+}
+
+/// Adds a boolean property.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, bool value)
+{
+    if (beginProperty(key))
+        MixpanelJsonWriter::appendBool(m_properties, value);
+    return *this;
+}
+
+/// Adds a string property.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, const QString& value)
+{
+    if (beginProperty(key))
+        m_valid &= MixpanelJsonWriter::appendString(m_properties, value);
+    return *this;
+}
+
+/// Adds a string property already encoded in UTF-8.
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, const QByteArray& value)
+{
+    if (beginProperty(key))
+        m_valid &= MixpanelJsonWriter::appendUtf8String(m_properties, value);
+    return *this;
+}
+
+/// Adds a string property from an UTF-8 C string.
+///
+/// \note This overload avoids string literals being silently converted to bool.
+///
+
+MixpanelEventBuilder& MixpanelEventBuilder::add(const QString& key, const char* value)
+{
+    if (beginProperty(key))
+        m_valid &= MixpanelJsonWriter::appendUtf8String(m_properties, QByteArray(value));
+    return *this;
+}
+
+/// Returns the name of the event.
+
+QString MixpanelEventBuilder::name() const
+{
+    return m_name;
+}
+
+/// Returns whether a property with the given key has been added.
+
+bool MixpanelEventBuilder::contains(const QString& key) const
+{
+    for (int i = 0; i < m_keys.size(); ++i)
+    {
+        if (m_keys.at(i) == key)
+            return true;
+    }
+    return false;
+}
+
+/// Returns whether no property has been added.
+
+bool MixpanelEventBuilder::isEmpty() const
+{
+    return m_keys.isEmpty();
+}
+
+/// Returns whether every key and string value added is valid Unicode.
+
+bool MixpanelEventBuilder::isValid() const
+{
+    return m_valid;
+}
+
+/// Returns the encoded properties, a comma separated list of JSON "key":value pairs.
+
+const QByteArray& MixpanelEventBuilder::encodedProperties() const
+{
+    return m_properties;
+}
+
+/// Returns whether the key is set by the library on every event.
+
+bool MixpanelEventBuilder::isReservedKey(const QString& key)
+{
+    return key == QLatin1String("token") || key == QLatin1String("distinct_id") || key == QLatin1String("time");
+}
+
+/// Writes the separator and an already escaped key of a new property.
+///
+/// \note It is used by MixpanelEventSchema, whose keys are validated and escaped once per schema,
+///  so no check is done here. The value must be appended right after to the returned buffer.
+///
+/// \param key Name of the key
+/// \param encodedKey The escaped key followed by the name separator, e.g. "key":
+/// \param size Size in bytes of encodedKey
+/// \return the encoding buffer
+///
+
+QByteArray& MixpanelEventBuilder::beginEncodedProperty(const QString& key, const char* encodedKey, int size)
+{
+    if (!m_keys.isEmpty())
+        m_properties.append(',');
+
+    m_properties.append(encodedKey, size);
+    m_keys.append(key);
+    return m_properties;
+}
+
+/// Records whether the value written after beginEncodedProperty() is valid Unicode.
+
+void MixpanelEventBuilder::endEncodedProperty(bool valid)
+{
+    m_valid &= valid;
+}
+
+/// Writes the separator and the key of a new property.
+///
+/// \return False if the property must be skipped (invalid, reserved or duplicated key)
+///
+
+bool MixpanelEventBuilder::beginProperty(const QString& key)
+{
+    if (key.isEmpty() || isReservedKey(key) || contains(key))
+    {
+        qWarning() << "Event builder property skipped:" << key;
+        return false;
+    }
+
+    if (!m_keys.isEmpty())
+        m_properties.append(',');
+
+    m_valid &= MixpanelJsonWriter::appendKey(m_properties, key);
+    m_keys.append(key);
+    return true;
+}
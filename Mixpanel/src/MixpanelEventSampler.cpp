@@ -0,0 +1,183 @@
+/*
+ * MixpanelEventSampler.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelEventSampler.hpp"
+#include "../include/MixpanelClock.hpp"
+
+#include <QMutexLocker>
+
+#include "qdebug.h"
+
+/// Mixes the bits of a hash so close inputs give uniformly distributed outputs (murmur3 finalizer).
+
+static quint32 mixHash(quint32 hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/// Creates a rule that accepts every event.
+
+MixpanelEventSampler::Rule::Rule()
+    : sampleRate(1.0)
+    , sampleThreshold(0)
+    , nameHash(0)
+{
+}
+
+/// Creates a MixpanelEventSampler object without rules.
+
+MixpanelEventSampler::MixpanelEventSampler()
+    : m_distinctIdHash(mixHash(qHash(QString())))
+    , m_sampledEvents(0)
+    , m_rateLimitedEvents(0)
+{
+}
+
+/// Sets the fraction of users that track an event.
+///
+/// \param eventName The name of the event
+/// \param sampleRate Value between 0 (nobody tracks the event) and 1 (everybody tracks the event)
+///
+
+void MixpanelEventSampler::setSampleRate(const QString& eventName, const double sampleRate)
+{
+    Rule& eventRule = rule(eventName);
+    eventRule.sampleRate = qBound(0.0, sampleRate, 1.0);
+    eventRule.sampleThreshold = quint32(eventRule.sampleRate * 4294967295.0);
+}
+
+/// Limits how often an event is tracked.
+///
+/// \param eventName The name of the event
+/// \param eventsPerSecond Sustained rate allowed, 0 removes the limit
+/// \param burstSize Number of events that can be tracked at once before the rate applies
+///
+/// \note The copies made before keep the previous bucket, the copies made after share the new one.
+///
+
+void MixpanelEventSampler::setRateLimit(const QString& eventName, const double eventsPerSecond, const int burstSize)
+{
+    Rule& eventRule = rule(eventName);
+    if (eventsPerSecond <= 0.0)
+    {
+        eventRule.rateLimit.clear();
+        return;
+    }
+
+    eventRule.rateLimit = QSharedPointer<RateLimit>(new RateLimit);
+    eventRule.rateLimit->eventsPerSecond = eventsPerSecond;
+    eventRule.rateLimit->burstSize = qMax(1, burstSize);
+    eventRule.rateLimit->tokens = eventRule.rateLimit->burstSize;
+    eventRule.rateLimit->lastRefill = MixpanelClock::elapsed();
+}
+
+/// Removes the sample rate and the rate limit of an event.
+
+void MixpanelEventSampler::removeRules(const QString& eventName)
+{
+    m_rules.remove(eventName);
+}
+
+/// Removes the rules of all the events.
+
+void MixpanelEventSampler::clear()
+{
+    m_rules.clear();
+}
+
+/// Returns whether an event has to be tracked.
+///
+/// \param eventName The name of the event
+/// \param distinctId The distinct id of the user tracking the event
+/// \param sampleRate Set to the sample rate applied to the event (1 when it is not sampled)
+/// \return False if the event has been sampled out or rate limited
+///
+
+bool MixpanelEventSampler::accept(const QString& eventName, const QString& distinctId, double& sampleRate)
+{
+    sampleRate = 1.0;
+    if (m_rules.isEmpty())
+        return true;
+
+    QHash<QString, Rule>::iterator it = m_rules.find(eventName);
+    if (it == m_rules.end())
+        return true;
+
+    Rule& eventRule = it.value();
+    if (eventRule.sampleRate < 1.0)
+    {
+        if (mixHash(eventRule.nameHash ^ distinctIdHash(distinctId)) >= eventRule.sampleThreshold)
+        {
+            m_sampledEvents++;
+            return false;
+        }
+        sampleRate = eventRule.sampleRate;
+    }
+
+    if (eventRule.rateLimit)
+    {
+        RateLimit& rateLimit = *eventRule.rateLimit;
+        QMutexLocker locker(&rateLimit.mutex);
+
+        const qint64 now = MixpanelClock::elapsed();
+        rateLimit.tokens = qMin(rateLimit.burstSize, rateLimit.tokens + qMax(Q_INT64_C(0), now - rateLimit.lastRefill) * rateLimit.eventsPerSecond / 1000.0);
+        rateLimit.lastRefill = qMax(now, rateLimit.lastRefill);
+
+        if (rateLimit.tokens < 1.0)
+        {
+            m_rateLimitedEvents++;
+            return false;
+        }
+        rateLimit.tokens -= 1.0;
+    }
+
+    return true;
+}
+
+/// Returns the number of events rejected by their sample rate.
+
+qint64 MixpanelEventSampler::sampledEvents() const
+{
+    return m_sampledEvents;
+}
+
+/// Returns the number of events rejected by their rate limit.
+
+qint64 MixpanelEventSampler::rateLimitedEvents() const
+{
+    return m_rateLimitedEvents;
+}
+
+/// Returns the rule of an event, creating it if needed.
+
+MixpanelEventSampler::Rule& MixpanelEventSampler::rule(const QString& eventName)
+{
+    QHash<QString, Rule>::iterator it = m_rules.find(eventName);
+    if (it == m_rules.end())
+    {
+        it = m_rules.insert(eventName, Rule());
+        it.value().nameHash = mixHash(qHash(eventName));
+    }
+    return it.value();
+}
+
+/// Returns the hash of a distinct id, cached since it rarely changes.
+
+quint32 MixpanelEventSampler::distinctIdHash(const QString& distinctId)
+{
+    if (distinctId != m_distinctId)
+    {
+        m_distinctId = distinctId;
+        m_distinctIdHash = mixHash(qHash(distinctId) * 0x9e3779b1U);
+    }
+    return m_distinctIdHash;
+}
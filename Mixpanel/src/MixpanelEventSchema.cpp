@@ -0,0 +1,86 @@
+/*
+ * MixpanelEventSchema.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelEventSchema.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+#include "qdebug.h"
+
+/// Creates a MixpanelSchemaKeys object.
+///
+/// \note Reserved (see MixpanelEventBuilder::isReservedKey) and duplicated keys are reported and their
+///  properties will not be written. The event name and keys are interned in the MixpanelStringPool.
+///
+/// \param eventName Name of the event
+/// \param keys Property keys of the schema
+/// \param count Number of property keys
+///
+
+MixpanelSchemaKeys::MixpanelSchemaKeys(const char* eventName, const char* const* keys, int count)
+    : m_name(QString::fromUtf8(eventName))
+    , m_keys(count)
+    , m_offsets(count + 1)
+{
+    MixpanelStringPool::instance().intern(m_name);
+
+    for (int i = 0; i < count; ++i)
+    {
+        m_keys[i] = QString::fromUtf8(keys[i]);
+        m_offsets[i] = m_encodedKeys.size();
+
+        if (MixpanelEventBuilder::isReservedKey(m_keys.at(i)) || m_keys.indexOf(m_keys.at(i)) < i)
+        {
+            qWarning() << "Event schema" << m_name << "has an invalid property key:" << m_keys.at(i);
+            Q_ASSERT_X(false, "MixpanelSchemaKeys", "reserved or duplicated schema key");
+            m_offsets[i] = -1;
+            continue;
+        }
+
+        MixpanelJsonWriter::appendKey(m_encodedKeys, m_keys.at(i));
+        MixpanelStringPool::instance().intern(m_keys.at(i));
+    }
+    m_offsets[count] = m_encodedKeys.size();
+}
+
+/// Returns the name of the event.
+
+const QString& MixpanelSchemaKeys::name() const
+{
+    return m_name;
+}
+
+/// Returns whether the property key can be written.
+
+bool MixpanelSchemaKeys::isValid(int index) const
+{
+    return m_offsets.at(index) >= 0;
+}
+
+/// Returns the property key.
+
+const QString& MixpanelSchemaKeys::key(int index) const
+{
+    return m_keys.at(index);
+}
+
+/// Returns the escaped property key followed by the name separator.
+
+const char* MixpanelSchemaKeys::encodedKey(int index) const
+{
+    return m_encodedKeys.constData() + m_offsets.at(index);
+}
+
+/// Returns the size of the escaped property key.
+
+int MixpanelSchemaKeys::encodedKeySize(int index) const
+{
+    int next = index + 1;
+    while (m_offsets.at(next) < 0)
+        ++next;
+
+    return m_offsets.at(next) - m_offsets.at(index);
+}
@@ -0,0 +1,104 @@
+/*
+ * MixpanelEventTimers.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelEventTimers.hpp"
+
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelConstants.hpp"
+
+#include "qdebug.h"
+
+/// Creates a MixpanelEventTimers object.
+///
+/// \param maxTimers Number of timers kept, by default g_maxEventTimers
+///
+
+MixpanelEventTimers::MixpanelEventTimers(const int maxTimers)
+    : m_head(0)
+    , m_discardedTimers(0)
+{
+    m_timers.resize(maxTimers > 0 ? maxTimers : g_maxEventTimers);
+}
+
+/// Sets the number of timers kept and discards the running ones.
+
+void MixpanelEventTimers::setMaxTimers(const int maxTimers)
+{
+    if (maxTimers <= 0)
+        return;
+
+    clear();
+    m_timers.resize(maxTimers);
+}
+
+/// Starts the timer of an event, or starts it again if it was already running.
+
+void MixpanelEventTimers::start(const QString& eventName)
+{
+    const qint64 now = qMax(MixpanelClock::elapsed(), Q_INT64_C(1));
+
+    QPair<QString, qint64>& oldest = m_timers[m_head];
+    if (oldest.second > 0 && m_startTimes.value(oldest.first) == oldest.second)
+    {
+        m_startTimes.remove(oldest.first);
+        m_discardedTimers++;
+    }
+
+    oldest = qMakePair(eventName, now);
+    m_startTimes.insert(eventName, now);
+    m_head = (m_head + 1) % m_timers.size();
+}
+
+/// Stops the timer of an event.
+///
+/// \return the miliseconds elapsed since the timer was started, -1 if the event was not timed
+///
+
+qint64 MixpanelEventTimers::take(const QString& eventName)
+{
+    if (m_startTimes.isEmpty())
+        return -1;
+
+    QHash<QString, qint64>::iterator it = m_startTimes.find(eventName);
+    if (it == m_startTimes.end())
+        return -1;
+
+    const qint64 elapsed = MixpanelClock::elapsed() - it.value();
+    m_startTimes.erase(it);
+
+    return qMax(elapsed, Q_INT64_C(0));
+}
+
+/// Stops the timer of an event without measuring it.
+
+void MixpanelEventTimers::cancel(const QString& eventName)
+{
+    m_startTimes.remove(eventName);
+}
+
+/// Stops all the timers.
+
+void MixpanelEventTimers::clear()
+{
+    m_startTimes.clear();
+    m_timers.fill(QPair<QString, qint64>(QString(), 0));
+    m_head = 0;
+}
+
+/// Returns the number of running timers.
+
+int MixpanelEventTimers::size() const
+{
+    return m_startTimes.size();
+}
+
+/// Returns the number of timers discarded because maxTimers newer ones were started.
+
+qint64 MixpanelEventTimers::discardedTimers() const
+{
+    return m_discardedTimers;
+}
@@ -0,0 +1,96 @@
+/*
+ * MixpanelFileTransport.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelFileTransport.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+
+#include <QDir>
+
+#include "qdebug.h"
+
+/// Creates a MixpanelFileTransport object and opens its file for appending.
+///
+/// \param filePath Path of the NDJSON file. By default g_transportFileName in the application data folder
+///
+
+MixpanelFileTransport::MixpanelFileTransport(const QString& filePath, QObject* parent)
+    : MixpanelTransport(parent)
+{
+    open(filePath);
+}
+
+/// Destructor, closes the file.
+
+MixpanelFileTransport::~MixpanelFileTransport()
+{
+    m_file.close();
+}
+
+/// Returns FileTransport.
+
+MixpanelConfiguration::Transport MixpanelFileTransport::type() const
+{
+    return MixpanelConfiguration::FileTransport;
+}
+
+/// Reopens the file if MixpanelConfiguration::transportFilePath has changed.
+
+void MixpanelFileTransport::setConfiguration(const MixpanelConfiguration& config)
+{
+    open(config.transportFilePath());
+}
+
+/// Opens a file for appending, closing the previous one.
+
+void MixpanelFileTransport::open(const QString& filePath)
+{
+    const QString fileName = filePath.isEmpty() ? QDir::homePath() + "/" + g_transportFileName : filePath;
+    if (m_file.isOpen() && m_file.fileName() == fileName)
+        return;
+
+    m_file.close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+        qWarning() << "Transport file could not be opened:" << m_file.fileName() << m_file.errorString();
+}
+
+/// Appends the messages of a batch to the file, one per line.
+///
+/// \param batchId Identifier of the batch, reported by batchFinished()
+/// \param batch The analytic messages to write
+///
+
+void MixpanelFileTransport::send(const int batchId, const MixpanelMessageBatch& batch)
+{
+    QByteArray lines;
+    for (int i = 0; i < batch.size(); ++i)
+    {
+        lines.append(batch.expandedContent(i));
+        lines.append('\n');
+    }
+
+    const bool written = m_file.isOpen() && m_file.write(lines) == lines.size() && m_file.flush();
+    if (!written)
+        qWarning() << "Analytic messages could not be written to" << m_file.fileName() << m_file.errorString();
+
+    emit batchFinished(batchId, written ? Accepted : Failed, QVariantList());
+}
+
+/// Does nothing, the batches are finished when they are sent.
+
+void MixpanelFileTransport::abort(const int batchId)
+{
+    Q_UNUSED(batchId);
+}
+
+/// Returns the path of the NDJSON file.
+
+QString MixpanelFileTransport::fileName() const
+{
+    return m_file.fileName();
+}
@@ -0,0 +1,361 @@
+/*
+ * MixpanelHttpTransport.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelHttpTransport.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelUploadScheduler.hpp"
+
+#include <QDateTime>
+#include <QLocale>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrl>
+#include <bb/data/JsonDataAccess>
+
+#include "qdebug.h"
+
+/// Mixpanel reply of an accepted request, when the reply is not verbose
+static const char* g_mixpanelAcceptedReply = "1";
+
+/// Mixpanel reply of a rejected request, when the reply is not verbose
+static const char* g_mixpanelRejectedReply = "0";
+
+/// First HTTP status of the client errors
+static const int g_httpClientError = 400;
+
+/// First HTTP status of the server errors
+static const int g_httpServerError = 500;
+
+/// HTTP status of a request whose payload is too large
+static const int g_httpPayloadTooLarge = 413;
+
+/// HTTP status of a request refused because too many requests were sent
+static const int g_httpTooManyRequests = 429;
+
+/// Creates a MixpanelHttpTransport object.
+
+MixpanelHttpTransport::MixpanelHttpTransport(QObject* parent)
+    : MixpanelTransport(parent)
+    , m_connectTimeout(g_defaultConnectTimeout)
+    , m_requestTimeout(g_defaultRequestTimeout)
+{
+    m_clock.start();
+}
+
+/// Destructor, removes the waiting requests from the scheduler and aborts the requests in flight.
+///
+/// \note Once the scheduler has been destroyed at exit its requests are gone, there is nothing left to do.
+///
+
+MixpanelHttpTransport::~MixpanelHttpTransport()
+{
+    if (!MixpanelUploadScheduler::exists())
+        return;
+
+    MixpanelUploadScheduler::instance().removeTransport(this);
+
+    QList<QNetworkReply*> replies = m_batchIds.keys();
+    m_batchIds.clear();
+    Q_FOREACH(QNetworkReply* reply, replies)
+    {
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+/// Returns HttpTransport.
+
+MixpanelConfiguration::Transport MixpanelHttpTransport::type() const
+{
+    return MixpanelConfiguration::HttpTransport;
+}
+
+/// Applies the connect and request timeouts of the configuration to the next requests.
+
+void MixpanelHttpTransport::setConfiguration(const MixpanelConfiguration& config)
+{
+    m_connectTimeout = config.connectTimeout();
+    m_requestTimeout = config.requestTimeout();
+}
+
+/// Posts a batch of analytic messages through the MixpanelUploadScheduler.
+///
+/// \param batchId Identifier of the batch, reported by batchFinished()
+/// \param batch The analytic messages to be posted
+///
+
+void MixpanelHttpTransport::send(const int batchId, const MixpanelMessageBatch& batch)
+{
+    QByteArray postData;
+    QNetworkRequest request = batch.toNetworkRequest(postData);
+
+    QUrl url = request.url();
+    url.addQueryItem("verbose", "1");
+    request.setUrl(url);
+
+    MixpanelUploadScheduler::instance().post(this, batchId, request, postData);
+}
+
+/// Aborts the request of a batch without reporting its result.
+
+void MixpanelHttpTransport::abort(const int batchId)
+{
+    if (MixpanelUploadScheduler::instance().cancel(this, batchId))
+        return;
+
+    QNetworkReply* reply = m_batchIds.key(batchId);
+    if (!reply)
+        return;
+
+    m_batchIds.remove(reply);
+    m_sendTimes.remove(reply);
+    m_connectedRequests.remove(reply);
+    m_timedOutRequests.remove(reply);
+
+    reply->abort();
+    reply->deleteLater();
+}
+
+/// Parses the reply of the Mixpanel API.
+///
+/// \note The verbose reply is a JSON object with a "status" (1 or "OK" when the batch is accepted) and an
+///  "error" message. The records refused by the server are listed in "failed_records", each with the "index"
+///  of the record in the batch and a "message". If "num_records_imported" is positive the other records
+///  have been accepted. The plain replies "1" and "0" are also understood.
+///
+///  An empty or unparseable reply does not say whether the batch was accepted (e.g. a proxy page or a
+///  truncated body), so it is reported as Failed and the batch is sent again.
+///
+/// \param response Body of the reply
+/// \param recordErrors Returns the records refused, see MixpanelTransport::batchFinished
+/// \return Accepted, PartiallyAccepted, Rejected or Failed
+///
+
+MixpanelTransport::BatchResult MixpanelHttpTransport::parseResponse(const QByteArray& response, QVariantList& recordErrors)
+{
+    const QByteArray reply = response.trimmed();
+    if (reply == g_mixpanelAcceptedReply)
+        return Accepted;
+    if (reply == g_mixpanelRejectedReply)
+        return Rejected;
+    if (reply.isEmpty())
+    {
+        qWarning() << "Mixpanel reply is empty";
+        return Failed;
+    }
+
+    bb::data::JsonDataAccess dataAccess;
+    const QVariantMap replyMap = dataAccess.loadFromBuffer(reply).toMap();
+    if (dataAccess.hasError() || replyMap.isEmpty())
+    {
+        qWarning() << "Mixpanel reply could not be parsed:" << reply;
+        return Failed;
+    }
+
+    Q_FOREACH(QVariant failedRecord, replyMap.value("failed_records").toList())
+    {
+        const QVariantMap failedRecordMap = failedRecord.toMap();
+
+        bool validIndex = false;
+        const int index = failedRecordMap.value("index").toInt(&validIndex);
+        if (!validIndex || index < 0)
+            continue;
+
+        QVariantMap recordError;
+        recordError.insert("index", index);
+        recordError.insert("message", failedRecordMap.value("message", failedRecordMap.value("field")).toString());
+        recordErrors.append(recordError);
+    }
+
+    if (!recordErrors.isEmpty())
+        return replyMap.value("num_records_imported").toInt() > 0 ? PartiallyAccepted : Rejected;
+
+    const QString status = replyMap.value("status").toString();
+    if (status == g_mixpanelAcceptedReply || status == "OK")
+        return Accepted;
+
+    qWarning() << "Mixpanel rejected the batch:" << replyMap.value("error").toString();
+    return Rejected;
+}
+
+/// Called by the MixpanelUploadScheduler when the request of a batch is posted.
+///
+/// \note The timeouts count from this moment, not while the request waits in the scheduler.
+///
+
+void MixpanelHttpTransport::requestStarted(const int batchId, QNetworkReply* reply)
+{
+    m_batchIds.insert(reply, batchId);
+    m_sendTimes.insert(reply, m_clock.elapsed());
+
+    startRequestTimer(reply);
+}
+
+/// Starts the timer that aborts a request when it exceeds the connect or request timeouts.
+///
+/// \note The request is considered connected once it has uploaded data or received the reply headers.
+///  The timer is owned by the reply, so it is destroyed with it.
+///
+
+void MixpanelHttpTransport::startRequestTimer(QNetworkReply* reply)
+{
+    if (m_connectTimeout <= 0 && m_requestTimeout <= 0)
+        return;
+
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    if (m_connectTimeout > 0)
+    {
+        connectResult = connect(reply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(requestUploadProgress(qint64,qint64)));
+        Q_ASSERT(connectResult);
+
+        connectResult = connect(reply, SIGNAL(metaDataChanged()), this, SLOT(requestMetaDataChanged()));
+        Q_ASSERT(connectResult);
+    }
+
+    QTimer* timer = new QTimer(reply);
+    timer->setSingleShot(true);
+
+    connectResult = connect(timer, SIGNAL(timeout()), this, SLOT(requestTimerTimeout()));
+    Q_ASSERT(connectResult);
+
+    if (m_connectTimeout > 0 && m_requestTimeout > 0)
+        timer->start(qMin(m_connectTimeout, m_requestTimeout));
+    else
+        timer->start(qMax(m_connectTimeout, m_requestTimeout));
+}
+
+/// Called by the MixpanelUploadScheduler when a network request to Mixpanel server finishes
+///
+/// \note If the request fails due a network or server error the batch is reported as Failed (or TimedOut
+///  if it has been aborted by its timer, TooLarge or Throttled on HTTP 413 and 429 replies), so it can be
+///  sent again. Otherwise the reply, including the ones of the other client errors, is parsed by
+///  parseResponse() to know which records have been accepted. A client error whose reply is not understood
+///  is reported as Rejected, since sending the batch again would fail the same way.
+///
+
+void MixpanelHttpTransport::requestFinished(QNetworkReply* reply)
+{
+    reply->deleteLater();
+
+    if (!m_batchIds.contains(reply))
+        return;
+
+    const int batchId = m_batchIds.take(reply);
+    const bool timedOut = m_timedOutRequests.remove(reply);
+    const qint64 roundTripTime = m_clock.elapsed() - m_sendTimes.take(reply);
+    m_connectedRequests.remove(reply);
+
+    const qint64 serverTime = parseDate(reply->rawHeader("Date"));
+    if (serverTime > 0)
+        emit serverTimeReceived(serverTime, roundTripTime);
+
+    const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    QVariantList recordErrors;
+    BatchResult result = Failed;
+    if (timedOut)
+    {
+        qWarning() << "Network request timed out -> messages will be sent again";
+        result = TimedOut;
+    } else if (httpStatus == g_httpPayloadTooLarge) {
+        qWarning() << "Network request too large -> messages will be sent again in smaller batches";
+        result = TooLarge;
+    } else if (httpStatus == g_httpTooManyRequests) {
+        qWarning() << "Network request throttled -> messages will be sent again later";
+        result = Throttled;
+    } else if (reply->error() == QNetworkReply::NoError || (httpStatus >= g_httpClientError && httpStatus < g_httpServerError)) {
+        result = parseResponse(reply->readAll(), recordErrors);
+        if (result == Failed && httpStatus >= g_httpClientError)
+            result = Rejected;
+
+        if (result == Accepted)
+            qDebug() << "Analytic Messages sent successfully to Mixpanel server";
+        else if (result == Failed)
+            qWarning() << "Mixpanel reply not understood -> messages will be sent again";
+        else
+            qDebug() << "Error due to incorrect Analytic Message sent to Mixpanel server (" << recordErrors.size() << "records )";
+    } else {
+        qWarning() << "Network request error (" << reply->error() << "): " << reply->errorString();
+    }
+
+    emit batchFinished(batchId, result, recordErrors);
+}
+
+/// Parses the Date header of a HTTP reply (RFC 1123 format, "Sun, 06 Nov 1994 08:49:37 GMT").
+///
+/// \param date The value of the header
+/// \return the time in miliseconds since epoch, 0 if the date is not valid
+///
+
+qint64 MixpanelHttpTransport::parseDate(const QByteArray& date)
+{
+    const int comma = date.indexOf(',');
+    if (comma < 0 || !date.trimmed().endsWith("GMT"))
+        return 0;
+
+    const QString dateTime = QString::fromLatin1(date.mid(comma + 1).trimmed().left(20));
+    QDateTime serverTime = QLocale::c().toDateTime(dateTime, "dd MMM yyyy hh:mm:ss");
+    if (!serverTime.isValid())
+        return 0;
+
+    serverTime.setTimeSpec(Qt::UTC);
+    return serverTime.toMSecsSinceEpoch();
+}
+
+/// Slot called when a request uploads data, it marks the request as connected.
+
+void MixpanelHttpTransport::requestUploadProgress(qint64 bytesSent, qint64 bytesTotal)
+{
+    Q_UNUSED(bytesTotal);
+
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply && bytesSent > 0 && m_batchIds.contains(reply))
+        m_connectedRequests.insert(reply);
+}
+
+/// Slot called when the headers of a reply are received, it marks the request as connected.
+
+void MixpanelHttpTransport::requestMetaDataChanged()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply && m_batchIds.contains(reply))
+        m_connectedRequests.insert(reply);
+}
+
+/// Slot called when the timer of a request expires
+///
+/// \note The request is aborted if it is not connected after the connect timeout or it has not
+///  finished after the request timeout, otherwise the timer is started again until the request timeout.
+///
+
+void MixpanelHttpTransport::requestTimerTimeout()
+{
+    QTimer* timer = qobject_cast<QTimer*>(sender());
+    QNetworkReply* reply = timer ? qobject_cast<QNetworkReply*>(timer->parent()) : NULL;
+    if (!reply || !m_sendTimes.contains(reply))
+        return;
+
+    const qint64 elapsed = m_clock.elapsed() - m_sendTimes.value(reply);
+
+    const bool connectTimedOut = m_connectTimeout > 0 && elapsed >= m_connectTimeout && !m_connectedRequests.contains(reply);
+    const bool requestTimedOut = m_requestTimeout > 0 && elapsed >= m_requestTimeout;
+
+    if (connectTimedOut || requestTimedOut)
+    {
+        qDebug() << (connectTimedOut ? "Connect timeout" : "Request timeout") << "-> aborting network request after" << elapsed << "ms";
+        m_timedOutRequests.insert(reply);
+        reply->abort();
+        return;
+    }
+
+    if (m_requestTimeout > 0)
+        timer->start(int(m_requestTimeout - elapsed));
+}
@@ -0,0 +1,95 @@
+/*
+ * MixpanelImportSource.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelImportSource.hpp"
+
+#include "qdebug.h"
+
+/// Destructor, destroys the MixpanelImportSource object.
+
+MixpanelImportSource::~MixpanelImportSource()
+{
+}
+
+/// Creates an empty MixpanelListImportSource object.
+
+MixpanelListImportSource::MixpanelListImportSource()
+    : m_position(0)
+{
+}
+
+/// Creates a MixpanelListImportSource object with a list of events.
+
+MixpanelListImportSource::MixpanelListImportSource(const QList<QByteArray>& events)
+    : m_events(events)
+    , m_position(0)
+{
+}
+
+/// Adds an event at the end of the list.
+
+void MixpanelListImportSource::append(const QByteArray& event)
+{
+    m_events.append(event);
+}
+
+/// Returns the number of events of the list.
+
+int MixpanelListImportSource::size() const
+{
+    return m_events.size();
+}
+
+/// Reads the next event of the list.
+
+bool MixpanelListImportSource::next(QByteArray& event)
+{
+    if (m_position >= m_events.size())
+        return false;
+
+    event = m_events.at(m_position++);
+    return true;
+}
+
+/// Creates a MixpanelFileImportSource object and opens its file for reading.
+///
+/// \param filePath Path of the NDJSON file
+///
+
+MixpanelFileImportSource::MixpanelFileImportSource(const QString& filePath)
+    : m_file(filePath)
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        qWarning() << "Import file could not be opened:" << filePath << m_file.errorString();
+}
+
+/// Destructor, closes the file.
+
+MixpanelFileImportSource::~MixpanelFileImportSource()
+{
+    m_file.close();
+}
+
+/// Returns whether the file could be opened.
+
+bool MixpanelFileImportSource::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+/// Reads the next non empty line of the file.
+
+bool MixpanelFileImportSource::next(QByteArray& event)
+{
+    while (m_file.isOpen() && !m_file.atEnd())
+    {
+        event = m_file.readLine().trimmed();
+        if (!event.isEmpty())
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,410 @@
+/*
+ * MixpanelImporter.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelImporter.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelImportSource.hpp"
+#include "../include/MixpanelUploadScheduler.hpp"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTimer>
+#include <QUrl>
+
+#include "qdebug.h"
+
+/// HTTP status of a request refused because too many requests were sent
+static const int g_httpTooManyRequests = 429;
+
+/// First HTTP status of the server errors
+static const int g_httpServerError = 500;
+
+/// Returns the CRC-32 (ISO 3309) of some data, as required by the gzip trailer.
+
+static quint32 crc32(const QByteArray& data)
+{
+    static quint32 table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (quint32 i = 0; i < 256; ++i)
+        {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) ? 0xedb88320U ^ (crc >> 1) : crc >> 1;
+            table[i] = crc;
+        }
+        tableReady = true;
+    }
+
+    quint32 crc = 0xffffffffU;
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    for (int i = 0; i < data.size(); ++i)
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffU;
+}
+
+/// Appends a 32 bits value in little endian order.
+
+static void appendLittleEndian(QByteArray& data, const quint32 value)
+{
+    data.append(char(value & 0xff));
+    data.append(char((value >> 8) & 0xff));
+    data.append(char((value >> 16) & 0xff));
+    data.append(char((value >> 24) & 0xff));
+}
+
+/// Creates an empty batch.
+
+MixpanelImporter::Batch::Batch()
+    : events(0)
+    , attempts(0)
+    , notBefore(0)
+{
+}
+
+/// Creates a MixpanelImporter object.
+///
+/// \note The importer reuses the connections of the MixpanelUploadScheduler network access manager, its
+///  parallel requests are bounded by MixpanelConfiguration::importParallelRequests only.
+///
+/// \param config Configuration of the import endpoint, batches and parallel requests
+///
+
+MixpanelImporter::MixpanelImporter(QObject* parent, const MixpanelConfiguration& config)
+    : QObject(parent)
+    , m_networkAccessManager(MixpanelUploadScheduler::instance().networkAccessManager())
+    , m_configuration(config)
+    , m_source(NULL)
+    , m_duration(0)
+    , m_importedEvents(0)
+    , m_failedEvents(0)
+    , m_sentBytes(0)
+    , m_retries(0)
+{
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = connect(m_networkAccessManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkRequestFinished(QNetworkReply*)));
+    Q_ASSERT(connectResult);
+}
+
+/// Destructor, cancels the ongoing import.
+
+MixpanelImporter::~MixpanelImporter()
+{
+    if (isRunning())
+        cancel();
+}
+
+/// Sets the configuration of the next batches.
+
+void MixpanelImporter::setConfiguration(const MixpanelConfiguration& config)
+{
+    m_configuration = config;
+}
+
+/// Starts importing the events of a source.
+///
+/// \note The importer takes ownership of the source, it is deleted when the import finishes.
+///
+/// \param source The events to import
+/// \return False if another import is running
+///
+
+bool MixpanelImporter::start(MixpanelImportSource* source)
+{
+    if (!source)
+        return false;
+
+    if (isRunning())
+    {
+        qWarning() << "Import already running -> events not imported";
+        delete source;
+        return false;
+    }
+
+    m_source = source;
+    m_duration = -1;
+    m_importedEvents = 0;
+    m_failedEvents = 0;
+    m_sentBytes = 0;
+    m_retries = 0;
+    m_clock.start();
+
+    postBatches();
+    return true;
+}
+
+/// Aborts the batches in flight and stops reading the source.
+
+void MixpanelImporter::cancel()
+{
+    if (!isRunning())
+        return;
+
+    QList<QNetworkReply*> replies = m_inFlightBatches.keys();
+    m_inFlightBatches.clear();
+    Q_FOREACH(QNetworkReply* reply, replies)
+    {
+        reply->abort();
+        reply->deleteLater();
+    }
+
+    finish();
+}
+
+/// Returns whether an import is running.
+
+bool MixpanelImporter::isRunning() const
+{
+    return m_source != NULL;
+}
+
+/// Returns the number of events accepted by the Mixpanel server in the last import.
+
+qint64 MixpanelImporter::importedEvents() const
+{
+    return m_importedEvents;
+}
+
+/// Returns the number of events that could not be imported in the last import.
+
+qint64 MixpanelImporter::failedEvents() const
+{
+    return m_failedEvents;
+}
+
+/// Returns the number of events imported per second since the last import started.
+
+double MixpanelImporter::eventsPerSecond() const
+{
+    const qint64 elapsed = m_duration >= 0 ? m_duration : m_clock.elapsed();
+    if (elapsed <= 0)
+        return 0.0;
+
+    return m_importedEvents * 1000.0 / elapsed;
+}
+
+/// Returns the import metrics.
+///
+/// \return a QVariantMap containing:
+///     - running: whether an import is running
+///     - importedEvents: events accepted by the Mixpanel server
+///     - failedEvents: events that could not be imported
+///     - eventsPerSecond: import throughput
+///     - inFlightBatches: batches waiting for the server response
+///     - retriedBatches: batches sent again after a network or server error
+///     - sentBytes: compressed bytes posted
+///
+
+QVariantMap MixpanelImporter::statistics() const
+{
+    QVariantMap stats;
+
+    stats.insert("running", isRunning());
+    stats.insert("importedEvents", m_importedEvents);
+    stats.insert("failedEvents", m_failedEvents);
+    stats.insert("eventsPerSecond", eventsPerSecond());
+    stats.insert("inFlightBatches", m_inFlightBatches.size());
+    stats.insert("retriedBatches", m_retries);
+    stats.insert("sentBytes", m_sentBytes);
+
+    return stats;
+}
+
+/// Compresses some data in gzip format.
+///
+/// \note qCompress produces a zlib stream (2 bytes header, deflate data and adler-32) prefixed by the
+///  size of the data. The deflate data is wrapped with the gzip header and trailer instead.
+///
+/// \param data The data to compress
+/// \return gzip compressed data
+///
+
+QByteArray MixpanelImporter::gzipCompress(const QByteArray& data)
+{
+    static const char gzipHeader[] = { 0x1f, char(0x8b), 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, char(0xff) };
+
+    const QByteArray zlibData = qCompress(data);
+    if (zlibData.size() < 10)
+        return QByteArray();
+
+    QByteArray gzipData;
+    gzipData.reserve(zlibData.size() + 12);
+    gzipData.append(gzipHeader, sizeof(gzipHeader));
+    gzipData.append(zlibData.constData() + 6, zlibData.size() - 10);
+    appendLittleEndian(gzipData, crc32(data));
+    appendLittleEndian(gzipData, quint32(data.size()));
+
+    return gzipData;
+}
+
+/// Posts the batches due to be sent again and reads new batches until the parallel requests are in flight.
+///
+/// \note The import finishes when the source has no more events and every batch has finished.
+///
+
+void MixpanelImporter::postBatches()
+{
+    if (!isRunning())
+        return;
+
+    const int maxRequests = m_configuration.importParallelRequests();
+    const qint64 now = m_clock.elapsed();
+
+    for (int i = 0; i < m_retryBatches.size() && m_inFlightBatches.size() < maxRequests;)
+    {
+        if (m_retryBatches.at(i).notBefore <= now)
+        {
+            Batch batch = m_retryBatches.takeAt(i);
+            postBatch(batch);
+        } else {
+            ++i;
+        }
+    }
+
+    while (m_inFlightBatches.size() < maxRequests)
+    {
+        Batch batch;
+        if (!readBatch(batch))
+            break;
+        postBatch(batch);
+    }
+
+    if (m_inFlightBatches.isEmpty() && m_retryBatches.isEmpty())
+        finish();
+}
+
+/// Reads from the source the events of the next batch and compresses them.
+///
+/// \note An event that does not fit in the batch is kept for the next one.
+///
+/// \param batch Returns the batch
+/// \return False if the source has no more events
+///
+
+bool MixpanelImporter::readBatch(Batch& batch)
+{
+    const int maxEvents = m_configuration.importBatchSize();
+
+    QByteArray content;
+    content.append('[');
+
+    QByteArray event;
+    while (batch.events < maxEvents)
+    {
+        if (!m_nextEvent.isEmpty())
+        {
+            event = m_nextEvent;
+            m_nextEvent.clear();
+        } else if (!m_source->next(event)) {
+            break;
+        }
+
+        if (batch.events > 0 && content.size() + event.size() + 2 > g_maxImportBatchBytes)
+        {
+            m_nextEvent = event;
+            break;
+        }
+
+        if (batch.events > 0)
+            content.append(',');
+        content.append(event);
+        batch.events++;
+    }
+
+    if (batch.events == 0)
+        return false;
+
+    content.append(']');
+    batch.content = gzipCompress(content);
+
+    return true;
+}
+
+/// Posts a batch to the import endpoint.
+
+void MixpanelImporter::postBatch(Batch& batch)
+{
+    QNetworkRequest request;
+    request.setUrl(QUrl(m_configuration.importUrl()));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Content-Encoding", "gzip");
+
+    if (!m_configuration.importApiSecret().isEmpty())
+        request.setRawHeader("Authorization", "Basic " + (m_configuration.importApiSecret() + ":").toUtf8().toBase64());
+
+    batch.attempts++;
+    m_sentBytes += batch.content.size();
+
+    qDebug() << "Posting import batch (" << batch.events << "events," << batch.content.size() << "bytes )";
+
+    QNetworkReply* reply = m_networkAccessManager->post(request, batch.content);
+    m_inFlightBatches.insert(reply, batch);
+}
+
+/// Finishes the import and deletes the source.
+
+void MixpanelImporter::finish()
+{
+    m_duration = m_clock.elapsed();
+
+    delete m_source;
+    m_source = NULL;
+    m_nextEvent.clear();
+    m_retryBatches.clear();
+
+    qDebug() << "Import finished (" << m_importedEvents << "events," << eventsPerSecond() << "events/s )";
+
+    emit importFinished(m_importedEvents, m_failedEvents);
+}
+
+/// Slot called when a network request to the import endpoint finishes
+///
+/// \note Batches failing due network errors, throttling or server errors are sent again later, up to
+///  g_maxImportAttempts times. Otherwise the events of the batch are counted as failed.
+///
+
+void MixpanelImporter::networkRequestFinished(QNetworkReply* reply)
+{
+    if (!m_inFlightBatches.contains(reply))
+        return;
+
+    reply->deleteLater();
+
+    Batch batch = m_inFlightBatches.take(reply);
+
+    if (reply->error() == QNetworkReply::NoError)
+    {
+        m_importedEvents += batch.events;
+    } else {
+        const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const bool retryable = httpStatus == 0 || httpStatus == g_httpTooManyRequests || httpStatus >= g_httpServerError;
+
+        if (retryable && batch.attempts < g_maxImportAttempts)
+        {
+            qWarning() << "Import batch error (" << reply->error() << ") -> events will be sent again";
+
+            const int delay = g_importRetryDelay * batch.attempts;
+            batch.notBefore = m_clock.elapsed() + delay;
+            m_retryBatches.append(batch);
+            m_retries++;
+
+            QTimer::singleShot(delay, this, SLOT(postBatches()));
+        } else {
+            qWarning() << "Import batch rejected (" << httpStatus << "):" << reply->readAll();
+            m_failedEvents += batch.events;
+        }
+    }
+
+    emit importProgress(m_importedEvents, eventsPerSecond());
+
+    postBatches();
+}
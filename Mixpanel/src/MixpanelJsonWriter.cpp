@@ -0,0 +1,875 @@
+/*
+ * MixpanelJsonWriter.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelJsonWriter.hpp"
+
+#include "../include/MixpanelArena.hpp"
+
+#include <QDateTime>
+#include <QStringList>
+#include <qnumeric.h>
+
+#include <string.h>
+
+static const char g_hexDigits[] = "0123456789abcdef";
+
+/// Size of the stack buffer where strings are transcoded before being appended
+static const int g_stringBufferSize = 256;
+
+/// Largest number of bytes written for one character, a \u00XX escape sequence
+static const int g_maxEncodedCharacterSize = 6;
+
+/// Writes the JSON escape sequence of an ASCII character that cannot be written as is.
+///
+/// \return the number of bytes written, at most 6
+///
+
+static int escapeCharacter(char* out, const unsigned char c)
+{
+    out[0] = '\\';
+    switch (c)
+    {
+        case '"':  out[1] = '"'; return 2;
+        case '\\': out[1] = '\\'; return 2;
+        case '\b': out[1] = 'b'; return 2;
+        case '\f': out[1] = 'f'; return 2;
+        case '\n': out[1] = 'n'; return 2;
+        case '\r': out[1] = 'r'; return 2;
+        case '\t': out[1] = 't'; return 2;
+        default:
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            out[4] = g_hexDigits[c >> 4];
+            out[5] = g_hexDigits[c & 0x0f];
+            return 6;
+    }
+}
+
+/// Decimal digits of the numbers from 00 to 99, two by two
+static const char g_digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/// Writes the decimal digits of an unsigned number backwards, ending at end.
+///
+/// \note The digits are written two at a time, which halves the number of 64 bits divisions.
+///
+/// \return the first digit written
+///
+
+static char* formatUnsigned(char* end, quint64 value)
+{
+    while (value >= 100)
+    {
+        const int pair = int(value % 100) * 2;
+        value /= 100;
+        *--end = g_digitPairs[pair + 1];
+        *--end = g_digitPairs[pair];
+    }
+
+    if (value >= 10)
+    {
+        const int pair = int(value) * 2;
+        *--end = g_digitPairs[pair + 1];
+        *--end = g_digitPairs[pair];
+    } else {
+        *--end = char('0' + value);
+    }
+
+    return end;
+}
+
+/// A floating point number as a 64 bits significand and a binary exponent, value = f * 2^e
+struct MixpanelDiyFp
+{
+    quint64 f;
+    int e;
+};
+
+/// A cached power of ten, c = f * 2^e ~= 10^k
+struct MixpanelCachedPower
+{
+    quint64 f;
+    int e;
+    int k;
+};
+
+/// Normalised powers of ten from 10^-300 to 10^340, every 8 decimal exponents
+static const MixpanelCachedPower g_cachedPowers[] =
+{
+    { Q_UINT64_C(0xAB70FE17C79AC6CA), -1060, -300 },
+    { Q_UINT64_C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+    { Q_UINT64_C(0xBE5691EF416BD60C), -1007, -284 },
+    { Q_UINT64_C(0x8DD01FAD907FFC3C), -980, -276 },
+    { Q_UINT64_C(0xD3515C2831559A83), -954, -268 },
+    { Q_UINT64_C(0x9D71AC8FADA6C9B5), -927, -260 },
+    { Q_UINT64_C(0xEA9C227723EE8BCB), -901, -252 },
+    { Q_UINT64_C(0xAECC49914078536D), -874, -244 },
+    { Q_UINT64_C(0x823C12795DB6CE57), -847, -236 },
+    { Q_UINT64_C(0xC21094364DFB5637), -821, -228 },
+    { Q_UINT64_C(0x9096EA6F3848984F), -794, -220 },
+    { Q_UINT64_C(0xD77485CB25823AC7), -768, -212 },
+    { Q_UINT64_C(0xA086CFCD97BF97F4), -741, -204 },
+    { Q_UINT64_C(0xEF340A98172AACE5), -715, -196 },
+    { Q_UINT64_C(0xB23867FB2A35B28E), -688, -188 },
+    { Q_UINT64_C(0x84C8D4DFD2C63F3B), -661, -180 },
+    { Q_UINT64_C(0xC5DD44271AD3CDBA), -635, -172 },
+    { Q_UINT64_C(0x936B9FCEBB25C996), -608, -164 },
+    { Q_UINT64_C(0xDBAC6C247D62A584), -582, -156 },
+    { Q_UINT64_C(0xA3AB66580D5FDAF6), -555, -148 },
+    { Q_UINT64_C(0xF3E2F893DEC3F126), -529, -140 },
+    { Q_UINT64_C(0xB5B5ADA8AAFF80B8), -502, -132 },
+    { Q_UINT64_C(0x87625F056C7C4A8B), -475, -124 },
+    { Q_UINT64_C(0xC9BCFF6034C13053), -449, -116 },
+    { Q_UINT64_C(0x964E858C91BA2655), -422, -108 },
+    { Q_UINT64_C(0xDFF9772470297EBD), -396, -100 },
+    { Q_UINT64_C(0xA6DFBD9FB8E5B88F), -369, -92 },
+    { Q_UINT64_C(0xF8A95FCF88747D94), -343, -84 },
+    { Q_UINT64_C(0xB94470938FA89BCF), -316, -76 },
+    { Q_UINT64_C(0x8A08F0F8BF0F156B), -289, -68 },
+    { Q_UINT64_C(0xCDB02555653131B6), -263, -60 },
+    { Q_UINT64_C(0x993FE2C6D07B7FAC), -236, -52 },
+    { Q_UINT64_C(0xE45C10C42A2B3B06), -210, -44 },
+    { Q_UINT64_C(0xAA242499697392D3), -183, -36 },
+    { Q_UINT64_C(0xFD87B5F28300CA0E), -157, -28 },
+    { Q_UINT64_C(0xBCE5086492111AEB), -130, -20 },
+    { Q_UINT64_C(0x8CBCCC096F5088CC), -103, -12 },
+    { Q_UINT64_C(0xD1B71758E219652C), -77, -4 },
+    { Q_UINT64_C(0x9C40000000000000), -50, 4 },
+    { Q_UINT64_C(0xE8D4A51000000000), -24, 12 },
+    { Q_UINT64_C(0xAD78EBC5AC620000), 3, 20 },
+    { Q_UINT64_C(0x813F3978F8940984), 30, 28 },
+    { Q_UINT64_C(0xC097CE7BC90715B3), 56, 36 },
+    { Q_UINT64_C(0x8F7E32CE7BEA5C70), 83, 44 },
+    { Q_UINT64_C(0xD5D238A4ABE98068), 109, 52 },
+    { Q_UINT64_C(0x9F4F2726179A2245), 136, 60 },
+    { Q_UINT64_C(0xED63A231D4C4FB27), 162, 68 },
+    { Q_UINT64_C(0xB0DE65388CC8ADA8), 189, 76 },
+    { Q_UINT64_C(0x83C7088E1AAB65DB), 216, 84 },
+    { Q_UINT64_C(0xC45D1DF942711D9A), 242, 92 },
+    { Q_UINT64_C(0x924D692CA61BE758), 269, 100 },
+    { Q_UINT64_C(0xDA01EE641A708DEA), 295, 108 },
+    { Q_UINT64_C(0xA26DA3999AEF774A), 322, 116 },
+    { Q_UINT64_C(0xF209787BB47D6B85), 348, 124 },
+    { Q_UINT64_C(0xB454E4A179DD1877), 375, 132 },
+    { Q_UINT64_C(0x865B86925B9BC5C2), 402, 140 },
+    { Q_UINT64_C(0xC83553C5C8965D3D), 428, 148 },
+    { Q_UINT64_C(0x952AB45CFA97A0B3), 455, 156 },
+    { Q_UINT64_C(0xDE469FBD99A05FE3), 481, 164 },
+    { Q_UINT64_C(0xA59BC234DB398C25), 508, 172 },
+    { Q_UINT64_C(0xF6C69A72A3989F5C), 534, 180 },
+    { Q_UINT64_C(0xB7DCBF5354E9BECE), 561, 188 },
+    { Q_UINT64_C(0x88FCF317F22241E2), 588, 196 },
+    { Q_UINT64_C(0xCC20CE9BD35C78A5), 614, 204 },
+    { Q_UINT64_C(0x98165AF37B2153DF), 641, 212 },
+    { Q_UINT64_C(0xE2A0B5DC971F303A), 667, 220 },
+    { Q_UINT64_C(0xA8D9D1535CE3B396), 694, 228 },
+    { Q_UINT64_C(0xFB9B7CD9A4A7443C), 720, 236 },
+    { Q_UINT64_C(0xBB764C4CA7A44410), 747, 244 },
+    { Q_UINT64_C(0x8BAB8EEFB6409C1A), 774, 252 },
+    { Q_UINT64_C(0xD01FEF10A657842C), 800, 260 },
+    { Q_UINT64_C(0x9B10A4E5E9913129), 827, 268 },
+    { Q_UINT64_C(0xE7109BFBA19C0C9D), 853, 276 },
+    { Q_UINT64_C(0xAC2820D9623BF429), 880, 284 },
+    { Q_UINT64_C(0x80444B5E7AA7CF85), 907, 292 },
+    { Q_UINT64_C(0xBF21E44003ACDD2D), 933, 300 },
+    { Q_UINT64_C(0x8E679C2F5E44FF8F), 960, 308 },
+    { Q_UINT64_C(0xD433179D9C8CB841), 986, 316 },
+    { Q_UINT64_C(0x9E19DB92B4E31BA9), 1013, 324 },
+    { Q_UINT64_C(0xEB96BF6EBADF77D9), 1039, 332 },
+    { Q_UINT64_C(0xAF87023B9BF0EE6B), 1066, 340 },
+};
+
+static const int g_cachedPowersMinDecimalExponent = -300;
+static const int g_cachedPowersDecimalStep = 8;
+
+/// Range of the binary exponent of the scaled numbers, so that the digits are generated with 32 and 64 bits integers
+static const int g_grisuAlpha = -60;
+static const int g_grisuGamma = -32;
+
+static MixpanelDiyFp makeDiyFp(const quint64 f, const int e)
+{
+    MixpanelDiyFp x;
+    x.f = f;
+    x.e = e;
+    return x;
+}
+
+/// Returns x * y rounded, the significand keeps the 64 most significant bits of the product.
+
+static MixpanelDiyFp multiply(const MixpanelDiyFp& x, const MixpanelDiyFp& y)
+{
+    const quint64 xLow = x.f & 0xffffffffu;
+    const quint64 xHigh = x.f >> 32;
+    const quint64 yLow = y.f & 0xffffffffu;
+    const quint64 yHigh = y.f >> 32;
+
+    const quint64 p0 = xLow * yLow;
+    const quint64 p1 = xLow * yHigh;
+    const quint64 p2 = xHigh * yLow;
+    const quint64 p3 = xHigh * yHigh;
+
+    quint64 middle = (p0 >> 32) + (p1 & 0xffffffffu) + (p2 & 0xffffffffu);
+    middle += quint64(1) << 31;
+
+    return makeDiyFp(p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32), x.e + y.e + 64);
+}
+
+/// Shifts the significand until its most significant bit is set.
+
+static MixpanelDiyFp normalize(MixpanelDiyFp x)
+{
+    while ((x.f >> 63) == 0)
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+/// Returns the number of decimal digits of n and the largest power of ten not above it.
+
+static int largestPowerOfTen(const quint32 n, quint32& powerOfTen)
+{
+    static const quint32 powers[] = { 1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u };
+
+    int digits = 10;
+    while (digits > 1 && n < powers[digits - 1])
+        digits--;
+
+    powerOfTen = powers[digits - 1];
+    return digits;
+}
+
+/// Moves the last digit towards the value while it stays within the rounding interval.
+
+static void roundLastDigit(char* digits, const int length, const quint64 distance, const quint64 delta, quint64 rest, const quint64 tenK)
+{
+    while (rest < distance && delta - rest >= tenK
+           && (rest + tenK < distance || distance - rest > rest + tenK - distance))
+    {
+        digits[length - 1]--;
+        rest += tenK;
+    }
+}
+
+/// Generates the shortest digits of w within the interval (low, high), scaled by a cached power of ten.
+
+static void generateDigits(char* digits, int& length, int& decimalExponent, const MixpanelDiyFp& low, const MixpanelDiyFp& w, const MixpanelDiyFp& high)
+{
+    quint64 delta = high.f - low.f;
+    quint64 distance = high.f - w.f;
+
+    const int shift = -high.e;
+    const quint64 one = quint64(1) << shift;
+
+    quint32 integral = quint32(high.f >> shift);
+    quint64 fractional = high.f & (one - 1);
+
+    quint32 powerOfTen;
+    int n = largestPowerOfTen(integral, powerOfTen);
+
+    while (n > 0)
+    {
+        digits[length++] = char('0' + integral / powerOfTen);
+        integral %= powerOfTen;
+        n--;
+
+        const quint64 rest = (quint64(integral) << shift) + fractional;
+        if (rest <= delta)
+        {
+            decimalExponent += n;
+            roundLastDigit(digits, length, distance, delta, rest, quint64(powerOfTen) << shift);
+            return;
+        }
+
+        powerOfTen /= 10;
+    }
+
+    int m = 0;
+    for (;;)
+    {
+        fractional *= 10;
+        digits[length++] = char('0' + (fractional >> shift));
+        fractional &= one - 1;
+        m++;
+
+        delta *= 10;
+        distance *= 10;
+        if (fractional <= delta)
+            break;
+    }
+
+    decimalExponent -= m;
+    roundLastDigit(digits, length, distance, delta, fractional, one);
+}
+
+/// Writes the shortest decimal digits that read back as the given positive finite value (Grisu2).
+///
+/// \return the number of digits, the value is digits * 10^decimalExponent
+///
+
+static int shortestDigits(char* digits, int& decimalExponent, const double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const quint64 hiddenBit = quint64(1) << 52;
+    const int exponentBias = 1075;
+    const quint64 significand = bits & (hiddenBit - 1);
+    const int exponent = int(bits >> 52);
+
+    const MixpanelDiyFp v = exponent == 0 ? makeDiyFp(significand, 1 - exponentBias)
+                                          : makeDiyFp(significand + hiddenBit, exponent - exponentBias);
+
+    const bool lowerBoundaryIsCloser = significand == 0 && exponent > 1;
+    const MixpanelDiyFp high = normalize(makeDiyFp(2 * v.f + 1, v.e - 1));
+    MixpanelDiyFp low = lowerBoundaryIsCloser ? makeDiyFp(4 * v.f - 1, v.e - 2) : makeDiyFp(2 * v.f - 1, v.e - 1);
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+
+    const int f = g_grisuAlpha - high.e - 1;
+    const int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+    const int index = (-g_cachedPowersMinDecimalExponent + k + (g_cachedPowersDecimalStep - 1)) / g_cachedPowersDecimalStep;
+    const MixpanelCachedPower& cached = g_cachedPowers[index];
+    const MixpanelDiyFp power = makeDiyFp(cached.f, cached.e);
+
+    const MixpanelDiyFp w = multiply(normalize(v), power);
+    MixpanelDiyFp scaledLow = multiply(low, power);
+    MixpanelDiyFp scaledHigh = multiply(high, power);
+    scaledLow.f++;
+    scaledHigh.f--;
+
+    int length = 0;
+    decimalExponent = -cached.k;
+    generateDigits(digits, length, decimalExponent, scaledLow, w, scaledHigh);
+    return length;
+}
+
+/// Writes a finite double, e.g. 59.5, 0.001 or 1e+21, in at most 25 bytes.
+///
+/// \return the number of bytes written
+///
+
+static int formatDouble(char* out, double value)
+{
+    char* begin = out;
+    if (value == 0.0)
+    {
+        *out = '0';
+        return 1;
+    }
+
+    if (value < 0.0)
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    int decimalExponent;
+    const int length = shortestDigits(out, decimalExponent, value);
+    const int point = length + decimalExponent;
+
+    if (length <= point && point <= 17)
+    {
+        memset(out + length, '0', point - length);
+        return int(out - begin) + point;
+    }
+
+    if (0 < point && point <= 17)
+    {
+        memmove(out + point + 1, out + point, length - point);
+        out[point] = '.';
+        return int(out - begin) + length + 1;
+    }
+
+    if (-4 < point && point <= 0)
+    {
+        memmove(out + 2 - point, out, length);
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', -point);
+        return int(out - begin) + 2 - point + length;
+    }
+
+    if (length > 1)
+    {
+        memmove(out + 2, out + 1, length - 1);
+        out[1] = '.';
+        out += length + 1;
+    } else {
+        out += 1;
+    }
+
+    int exponent = point - 1;
+    *out++ = 'e';
+    *out++ = exponent < 0 ? '-' : '+';
+    exponent = exponent < 0 ? -exponent : exponent;
+    if (exponent >= 100)
+    {
+        *out++ = char('0' + exponent / 100);
+        exponent %= 100;
+    }
+    *out++ = char('0' + exponent / 10);
+    *out++ = char('0' + exponent % 10);
+
+    return int(out - begin);
+}
+
+/// Bit masks of the SWAR checks, for 16 bits lanes (4 UTF-16 code units per word) and 8 bits lanes
+static const quint64 g_utf16LaneOnes = Q_UINT64_C(0x0001000100010001);
+static const quint64 g_utf16LaneHighBits = Q_UINT64_C(0x8000800080008000);
+static const quint64 g_utf16NonAsciiBits = Q_UINT64_C(0xff80ff80ff80ff80);
+static const quint64 g_utf8LaneOnes = Q_UINT64_C(0x0101010101010101);
+static const quint64 g_utf8LaneHighBits = Q_UINT64_C(0x8080808080808080);
+
+/// Returns whether the word holds no ASCII control character, quote nor backslash.
+///
+/// \note Every lane must be below 0x80. A lane below 0x20 borrows from the next one when subtracted,
+///  which may flag the next lane too, but then the word has to be escaped anyway.
+///
+
+static inline bool hasNoAsciiEscape(const quint64 word, const quint64 ones, const quint64 highBits)
+{
+    const quint64 quotes = word ^ (ones * '"');
+    const quint64 backslashes = word ^ (ones * '\\');
+
+    const quint64 controls = (word - ones * 0x20) & ~word;
+    const quint64 quoteLanes = (quotes - ones) & ~quotes;
+    const quint64 backslashLanes = (backslashes - ones) & ~backslashes;
+
+    return ((controls | quoteLanes | backslashLanes) & highBits) == 0;
+}
+
+/// Returns whether 4 UTF-16 code units are ASCII characters written as is in a JSON string.
+
+static inline bool isPlainAscii(const ushort* units)
+{
+    quint64 word;
+    memcpy(&word, units, sizeof(word));
+    return (word & g_utf16NonAsciiBits) == 0 && hasNoAsciiEscape(word, g_utf16LaneOnes, g_utf16LaneHighBits);
+}
+
+/// Returns whether 8 UTF-8 bytes are ASCII characters written as is in a JSON string.
+
+static inline bool isPlainAscii(const char* bytes)
+{
+    quint64 word;
+    memcpy(&word, bytes, sizeof(word));
+    return (word & g_utf8LaneHighBits) == 0 && hasNoAsciiEscape(word, g_utf8LaneOnes, g_utf8LaneHighBits);
+}
+
+/// Returns the length of the UTF-8 sequence starting at data, 0 if it is not well formed.
+///
+/// \note Overlong forms, encoded surrogates and code points above U+10FFFF are not well formed (RFC 3629).
+///
+
+static int utf8SequenceLength(const uchar* data, const int available)
+{
+    const uchar lead = data[0];
+    uchar low = 0x80;
+    uchar high = 0xbf;
+    int length;
+
+    if (lead >= 0xc2 && lead <= 0xdf)
+    {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0)
+            low = 0xa0;
+        else if (lead == 0xed)
+            high = 0x9f;
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0)
+            low = 0x90;
+        else if (lead == 0xf4)
+            high = 0x8f;
+    } else {
+        return 0;
+    }
+
+    if (available < length || data[1] < low || data[1] > high)
+        return 0;
+
+    for (int i = 2; i < length; ++i)
+    {
+        if ((data[i] & 0xc0) != 0x80)
+            return 0;
+    }
+
+    return length;
+}
+
+/// Appends a QString as an escaped JSON string.
+///
+/// \note The string is transcoded from UTF-16 to UTF-8 and escaped in a single pass through a stack
+///  buffer. Runs of ASCII characters that need no escaping are checked 4 code units at a time.
+///  The buffer is flushed as soon as it could not hold one more character and the closing quote.
+///
+/// \param out Buffer the JSON token is appended to
+/// \param value String to append
+/// \return False if the string has a lone surrogate. It is written as U+FFFD, so the buffer is still
+///  valid JSON, but the string is not the one given and the message should be rejected.
+///
+
+template <typename Output>
+bool MixpanelJsonWriter::appendString(Output& out, const QString& value)
+{
+    const ushort* data = reinterpret_cast<const ushort*>(value.constData());
+    const int size = value.size();
+    bool valid = true;
+
+    char buffer[g_stringBufferSize];
+    int used = 0;
+    buffer[used++] = '"';
+
+    int i = 0;
+    while (i < size)
+    {
+        if (used + g_maxEncodedCharacterSize + 1 > g_stringBufferSize)
+        {
+            out.append(buffer, used);
+            used = 0;
+        }
+
+        if (i + 4 <= size && isPlainAscii(data + i))
+        {
+            buffer[used++] = char(data[i++]);
+            buffer[used++] = char(data[i++]);
+            buffer[used++] = char(data[i++]);
+            buffer[used++] = char(data[i++]);
+            continue;
+        }
+
+        uint c = data[i++];
+        if (c < 0x80)
+        {
+            if (c >= 0x20 && c != '"' && c != '\\')
+                buffer[used++] = char(c);
+            else
+                used += escapeCharacter(buffer + used, c);
+            continue;
+        }
+
+        if (c < 0x800)
+        {
+            buffer[used++] = char(0xc0 | (c >> 6));
+            buffer[used++] = char(0x80 | (c & 0x3f));
+            continue;
+        }
+
+        if (QChar::isHighSurrogate(c) && i < size && QChar::isLowSurrogate(data[i]))
+        {
+            c = QChar::surrogateToUcs4(ushort(c), data[i++]);
+            buffer[used++] = char(0xf0 | (c >> 18));
+            buffer[used++] = char(0x80 | ((c >> 12) & 0x3f));
+            buffer[used++] = char(0x80 | ((c >> 6) & 0x3f));
+            buffer[used++] = char(0x80 | (c & 0x3f));
+            continue;
+        }
+
+        if ((c & 0xf800) == 0xd800)
+        {
+            c = QChar::ReplacementCharacter;
+            valid = false;
+        }
+
+        buffer[used++] = char(0xe0 | (c >> 12));
+        buffer[used++] = char(0x80 | ((c >> 6) & 0x3f));
+        buffer[used++] = char(0x80 | (c & 0x3f));
+    }
+
+    buffer[used++] = '"';
+    out.append(buffer, used);
+    return valid;
+}
+
+/// Appends an UTF-8 encoded string as an escaped JSON string.
+///
+/// \note The string is validated and escaped in a single pass, the runs that need no escaping are
+///  appended as is. Runs of ASCII characters are checked 8 bytes at a time.
+///
+/// \param out Buffer the JSON token is appended to
+/// \param value UTF-8 string to append
+/// \return False if the string is not well formed UTF-8. Every invalid byte is written as U+FFFD, so the
+///  buffer is still valid JSON, but the message should be rejected.
+///
+
+template <typename Output>
+bool MixpanelJsonWriter::appendUtf8String(Output& out, const QByteArray& value)
+{
+    out.append('"');
+
+    const char* data = value.constData();
+    const int size = value.size();
+    bool valid = true;
+    int runStart = 0;
+
+    int i = 0;
+    while (i < size)
+    {
+        if (i + 8 <= size && isPlainAscii(data + i))
+        {
+            i += 8;
+            continue;
+        }
+
+        const uchar c = data[i];
+        if (c >= 0x80)
+        {
+            const int length = utf8SequenceLength(reinterpret_cast<const uchar*>(data + i), size - i);
+            if (length > 0)
+            {
+                i += length;
+                continue;
+            }
+
+            out.append(data + runStart, i - runStart);
+            out.append("\xef\xbf\xbd", 3);
+            runStart = ++i;
+            valid = false;
+            continue;
+        }
+
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            ++i;
+            continue;
+        }
+
+        out.append(data + runStart, i - runStart);
+        runStart = ++i;
+
+        char escaped[6];
+        out.append(escaped, escapeCharacter(escaped, c));
+    }
+
+    out.append(data + runStart, size - runStart);
+    out.append('"');
+    return valid;
+}
+
+/// Appends an object key followed by the name separator.
+///
+/// \param out Buffer the JSON token is appended to
+/// \param key Name of the key
+/// \return False if the key is not valid Unicode, see appendString
+///
+
+template <typename Output>
+bool MixpanelJsonWriter::appendKey(Output& out, const QString& key)
+{
+    const bool valid = appendString(out, key);
+    out.append(':');
+    return valid;
+}
+
+/// Appends an integer number.
+
+template <typename Output>
+void MixpanelJsonWriter::appendNumber(Output& out, int value)
+{
+    appendNumber(out, qint64(value));
+}
+
+/// Appends a 64 bits integer number.
+
+template <typename Output>
+void MixpanelJsonWriter::appendNumber(Output& out, qint64 value)
+{
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* begin = formatUnsigned(end, value < 0 ? 0 - quint64(value) : quint64(value));
+    if (value < 0)
+        *--begin = '-';
+
+    out.append(begin, int(end - begin));
+}
+
+/// Appends a 64 bits unsigned integer number.
+
+template <typename Output>
+void MixpanelJsonWriter::appendNumber(Output& out, quint64 value)
+{
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* begin = formatUnsigned(end, value);
+
+    out.append(begin, int(end - begin));
+}
+
+/// Appends a floating point number.
+///
+/// \note The number is written with the shortest digits that read back as the same double (see
+///  formatDouble), with a dot whatever the locale is. JSON has no representation for NaN or infinity,
+///  those values are written as null.
+///
+
+template <typename Output>
+void MixpanelJsonWriter::appendNumber(Output& out, double value)
+{
+    if (qIsNaN(value) || qIsInf(value))
+    {
+        appendNull(out);
+        return;
+    }
+
+    char buffer[32];
+    out.append(buffer, formatDouble(buffer, value));
+}
+
+/// Appends a boolean literal.
+
+template <typename Output>
+void MixpanelJsonWriter::appendBool(Output& out, bool value)
+{
+    if (value)
+        out.append("true", 4);
+    else
+        out.append("false", 5);
+}
+
+/// Appends the null literal.
+
+template <typename Output>
+void MixpanelJsonWriter::appendNull(Output& out)
+{
+    out.append("null", 4);
+}
+
+/// Appends any QVariant value as JSON.
+///
+/// \note Maps, hashes and lists are written recursively, every numeric type (float, short, char, long...)
+///  as a number, dates use the Mixpanel date format and any other type as its string representation.
+///
+/// \return False if any string of the value is not valid Unicode, see appendString
+///
+
+template <typename Output>
+bool MixpanelJsonWriter::appendVariant(Output& out, const QVariant& value)
+{
+    bool valid = true;
+    switch (value.userType())
+    {
+        case QVariant::Invalid:
+            appendNull(out);
+            break;
+        case QVariant::Bool:
+            appendBool(out, value.toBool());
+            break;
+        case QVariant::Int:
+        case QVariant::UInt:
+        case QVariant::LongLong:
+        case QMetaType::Char:
+        case QMetaType::UChar:
+        case QMetaType::Short:
+        case QMetaType::UShort:
+        case QMetaType::Long:
+            appendNumber(out, value.toLongLong());
+            break;
+        case QVariant::ULongLong:
+        case QMetaType::ULong:
+            appendNumber(out, value.toULongLong());
+            break;
+        case QVariant::Double:
+        case QMetaType::Float:
+            appendNumber(out, value.toDouble());
+            break;
+        case QVariant::ByteArray:
+            valid = appendUtf8String(out, value.toByteArray());
+            break;
+        case QVariant::DateTime:
+            valid = appendString(out, value.toDateTime().toString("yyyy-MM-ddThh:mm:ss"));
+            break;
+        case QVariant::Map:
+            valid = appendVariantMap(out, value.toMap());
+            break;
+        case QVariant::Hash:
+        {
+            const QVariantHash hash = value.toHash();
+            out.append('{');
+            for (QVariantHash::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it)
+            {
+                if (it != hash.constBegin())
+                    out.append(',');
+                valid &= appendKey(out, it.key());
+                valid &= appendVariant(out, it.value());
+            }
+            out.append('}');
+            break;
+        }
+        case QVariant::List:
+        case QVariant::StringList:
+        {
+            const QVariantList list = value.toList();
+            out.append('[');
+            for (int i = 0; i < list.size(); ++i)
+            {
+                if (i > 0)
+                    out.append(',');
+                valid &= appendVariant(out, list.at(i));
+            }
+            out.append(']');
+            break;
+        }
+        default:
+            valid = appendString(out, value.toString());
+            break;
+    }
+
+    return valid;
+}
+
+/// Appends a QVariantMap as a JSON object.
+///
+/// \return False if any key or string value is not valid Unicode, see appendString
+///
+
+template <typename Output>
+bool MixpanelJsonWriter::appendVariantMap(Output& out, const QVariantMap& map)
+{
+    bool valid = true;
+    out.append('{');
+    for (QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it)
+    {
+        if (it != map.constBegin())
+            out.append(',');
+        valid &= appendKey(out, it.key());
+        valid &= appendVariant(out, it.value());
+    }
+    out.append('}');
+    return valid;
+}
+
+/// Instantiates the writer for the buffers it is used with.
+
+#define MIXPANEL_JSON_WRITER_INSTANTIATE(Output) \
+    template bool MixpanelJsonWriter::appendString<Output>(Output&, const QString&); \
+    template bool MixpanelJsonWriter::appendUtf8String<Output>(Output&, const QByteArray&); \
+    template bool MixpanelJsonWriter::appendKey<Output>(Output&, const QString&); \
+    template void MixpanelJsonWriter::appendNumber<Output>(Output&, int); \
+    template void MixpanelJsonWriter::appendNumber<Output>(Output&, qint64); \
+    template void MixpanelJsonWriter::appendNumber<Output>(Output&, quint64); \
+    template void MixpanelJsonWriter::appendNumber<Output>(Output&, double); \
+    template void MixpanelJsonWriter::appendBool<Output>(Output&, bool); \
+    template void MixpanelJsonWriter::appendNull<Output>(Output&); \
+    template bool MixpanelJsonWriter::appendVariant<Output>(Output&, const QVariant&); \
+    template bool MixpanelJsonWriter::appendVariantMap<Output>(Output&, const QVariantMap&);
+
+MIXPANEL_JSON_WRITER_INSTANTIATE(QByteArray)
+MIXPANEL_JSON_WRITER_INSTANTIATE(MixpanelArena)
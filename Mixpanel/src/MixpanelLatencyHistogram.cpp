@@ -0,0 +1,132 @@
+/*
+ * MixpanelLatencyHistogram.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelLatencyHistogram.hpp"
+
+/// Returns the bucket of a latency.
+
+static int bucketIndex(qint64 latencyMs)
+{
+    int index = 0;
+    while (latencyMs > 0 && index < MixpanelLatencyHistogram::BucketCount - 1)
+    {
+        latencyMs >>= 1;
+        index++;
+    }
+    return index;
+}
+
+/// Creates an empty MixpanelLatencyHistogram object.
+
+MixpanelLatencyHistogram::MixpanelLatencyHistogram()
+{
+    clear();
+}
+
+/// Records a latency.
+///
+/// \param latencyMs Latency in miliseconds, negative values are recorded as 0
+///
+
+void MixpanelLatencyHistogram::record(const qint64 latencyMs)
+{
+    const qint64 latency = qMax(Q_INT64_C(0), latencyMs);
+
+    m_buckets[bucketIndex(latency)]++;
+    m_min = m_count == 0 ? latency : qMin(m_min, latency);
+    m_max = qMax(m_max, latency);
+    m_sum += latency;
+    m_count++;
+}
+
+/// Removes all the recorded latencies.
+
+void MixpanelLatencyHistogram::clear()
+{
+    for (int i = 0; i < BucketCount; ++i)
+        m_buckets[i] = 0;
+
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+/// Returns the number of latencies recorded.
+
+qint64 MixpanelLatencyHistogram::count() const
+{
+    return m_count;
+}
+
+/// Returns the lowest latency recorded.
+
+qint64 MixpanelLatencyHistogram::min() const
+{
+    return m_min;
+}
+
+/// Returns the highest latency recorded.
+
+qint64 MixpanelLatencyHistogram::max() const
+{
+    return m_max;
+}
+
+/// Returns the average latency recorded.
+
+double MixpanelLatencyHistogram::mean() const
+{
+    return m_count > 0 ? double(m_sum) / m_count : 0.0;
+}
+
+/// Returns an estimation of a percentile of the recorded latencies.
+///
+/// \param fraction Percentile between 0 and 1, e.g. 0.99
+/// \return upper bound of the bucket containing the percentile, never higher than max()
+///
+
+qint64 MixpanelLatencyHistogram::percentile(const double fraction) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const qint64 rank = qMax(Q_INT64_C(1), qint64(fraction * m_count + 0.5));
+    qint64 accumulated = 0;
+    for (int i = 0; i < BucketCount; ++i)
+    {
+        accumulated += m_buckets[i];
+        if (accumulated >= rank)
+            return qBound(m_min, i < BucketCount - 1 ? (Q_INT64_C(1) << i) - 1 : m_max, m_max);
+    }
+    return m_max;
+}
+
+/// Returns the histogram in a QVariantMap.
+///
+/// \return a QVariantMap containing count, min, max, mean, p50, p90, p99 and buckets (the
+///  count of every bucket)
+///
+
+QVariantMap MixpanelLatencyHistogram::toVariantMap() const
+{
+    QVariantMap histogram;
+    histogram.insert("count", m_count);
+    histogram.insert("min", m_min);
+    histogram.insert("max", m_max);
+    histogram.insert("mean", mean());
+    histogram.insert("p50", percentile(0.5));
+    histogram.insert("p90", percentile(0.9));
+    histogram.insert("p99", percentile(0.99));
+
+    QVariantList buckets;
+    for (int i = 0; i < BucketCount; ++i)
+        buckets.append(m_buckets[i]);
+    histogram.insert("buckets", buckets);
+
+    return histogram;
+}
@@ -0,0 +1,155 @@
+/*
+ * MixpanelMemoryTransport.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelMemoryTransport.hpp"
+
+#include <QSet>
+
+/// Creates a MixpanelMemoryTransport object that accepts every batch.
+
+MixpanelMemoryTransport::MixpanelMemoryTransport(QObject* parent)
+    : MixpanelTransport(parent)
+    , m_result(Accepted)
+    , m_keepMessages(false)
+    , m_batchCount(0)
+    , m_messageCount(0)
+    , m_byteCount(0)
+{
+}
+
+/// Destructor, destroys the MixpanelMemoryTransport object.
+
+MixpanelMemoryTransport::~MixpanelMemoryTransport()
+{
+}
+
+/// Returns MemoryTransport.
+
+MixpanelConfiguration::Transport MixpanelMemoryTransport::type() const
+{
+    return MixpanelConfiguration::MemoryTransport;
+}
+
+/// Counts a batch and finishes it right away with the configured result and record errors.
+///
+/// \note A batch with a message containing the rejected content is Rejected without record errors,
+///  as the /track and /engage endpoints do (see setRejectedContent).
+///
+/// \param batchId Identifier of the batch, reported by batchFinished()
+/// \param batch The analytic messages delivered
+///
+
+void MixpanelMemoryTransport::send(const int batchId, const MixpanelMessageBatch& batch)
+{
+    if (!m_rejectedContent.isEmpty())
+    {
+        for (int i = 0; i < batch.size(); ++i)
+        {
+            if (batch.expandedContent(i).contains(m_rejectedContent))
+            {
+                emit batchFinished(batchId, Rejected, QVariantList());
+                return;
+            }
+        }
+    }
+
+    if (m_result == Accepted || m_result == PartiallyAccepted)
+    {
+        QSet<int> rejectedRecords;
+        Q_FOREACH(QVariant recordError, m_recordErrors)
+            rejectedRecords.insert(recordError.toMap().value("index").toInt());
+
+        m_batchCount++;
+        for (int i = 0; i < batch.size(); ++i)
+        {
+            if (m_result == PartiallyAccepted && rejectedRecords.contains(i))
+                continue;
+
+            m_messageCount++;
+            m_byteCount += batch.contentSize(i);
+            if (m_keepMessages)
+                m_messages.append(batch.at(i));
+        }
+    }
+
+    emit batchFinished(batchId, m_result, m_recordErrors);
+}
+
+/// Does nothing, the batches are finished when they are sent.
+
+void MixpanelMemoryTransport::abort(const int batchId)
+{
+    Q_UNUSED(batchId);
+}
+
+/// Sets the result reported for the next batches, to simulate server or network errors.
+
+void MixpanelMemoryTransport::setResult(const BatchResult result)
+{
+    m_result = result;
+}
+
+/// Sets the record errors reported for the next batches, to simulate records refused by the server
+/// (see MixpanelTransport::batchFinished).
+
+void MixpanelMemoryTransport::setRecordErrors(const QVariantList& recordErrors)
+{
+    m_recordErrors = recordErrors;
+}
+
+/// Sets a text that makes the batches containing it Rejected, to simulate an invalid message refused
+/// by an endpoint that does not report the records refused. An empty text disables it.
+
+void MixpanelMemoryTransport::setRejectedContent(const QByteArray& rejectedContent)
+{
+    m_rejectedContent = rejectedContent;
+}
+
+/// Sets whether the messages of the accepted batches are kept (see messages()).
+
+void MixpanelMemoryTransport::setKeepMessages(const bool keepMessages)
+{
+    m_keepMessages = keepMessages;
+}
+
+/// Returns the messages of the accepted batches, if setKeepMessages has been enabled.
+
+QList<MixpanelAnalyticsMessage> MixpanelMemoryTransport::messages() const
+{
+    return m_messages;
+}
+
+/// Returns the number of accepted batches.
+
+qint64 MixpanelMemoryTransport::batchCount() const
+{
+    return m_batchCount;
+}
+
+/// Returns the number of messages in the accepted batches.
+
+qint64 MixpanelMemoryTransport::messageCount() const
+{
+    return m_messageCount;
+}
+
+/// Returns the size of the compacted content of the messages in the accepted batches.
+
+qint64 MixpanelMemoryTransport::byteCount() const
+{
+    return m_byteCount;
+}
+
+/// Resets the counters and removes the messages kept.
+
+void MixpanelMemoryTransport::clear()
+{
+    m_messages.clear();
+    m_batchCount = 0;
+    m_messageCount = 0;
+    m_byteCount = 0;
+}
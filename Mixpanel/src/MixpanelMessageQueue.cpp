@@ -7,10 +7,10 @@
 
 #include "../include/MixpanelMessageQueue.hpp"
 
-#include <QNetworkAccessManager>
-#include <QNetworkRequest>
-#include <QUrl>
-#include <QSettings>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
 #include <QTimer>
 #include <bb/Application>
 
@@ -18,28 +18,103 @@
 #include "../include/MixpanelConfiguration.hpp"
 #include "../include/MixpanelConstants.hpp"
 #include "../include/MixpanelAnalyticsMessage.hpp"
+#include "../include/MixpanelStringPool.hpp"
+#include "../include/MixpanelMessageStore.hpp"
+#include "../include/MixpanelLatencyHistogram.hpp"
+#include "../include/MixpanelBatchController.hpp"
+#include "../include/MixpanelDeadLetterStore.hpp"
+#include "../include/MixpanelTransport.hpp"
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelMessageRing.hpp"
 
 
 class MixpanelMessageQueuePrivate
 {
 public:
-    QList<MixpanelAnalyticsMessage> messageQueue;
-    QNetworkAccessManager* networkAccessManager;
+    MixpanelMessageRing messageQueue;
+    MixpanelMessageRing priorityQueue;
+    MixpanelMessageStore* messageStore;
+    QString storageNamespace;
+    MixpanelTransport* transport;
+    bool transportInjected;
     MixpanelConfiguration configuartion;
     QTimer* flushTimer;
-    bool requestOngoing;
+    QTimer* messageStoreSyncTimer;
+    QHash<int, MixpanelMessageBatch> inFlightBatches;
+    int nextBatchId;
+    QList<int> batchesToSend;
+    bool sendingBatches;
+    bool pendingMessagesSaved;
+    QEventLoop* drainLoop;
+    bool drainFailed;
+    int drainSentMessages;
+    qint64 internedBytesSaved;
+    qint64 internedMessages;
+    int pendingCount;
+    qint64 pendingBytes;
+    bool underPressure;
+    MixpanelMessageQueue::AdmissionStatus admission;
+    QHash<QString, int> pressureSampleCounters;
+    qint64 droppedMessages;
+    qint64 sampledMessages;
+    qint64 rejectedEvents;
+    QElapsedTimer requestClock;
+    QHash<int, qint64> requestSendTimes;
+    qint64 timedOutRequestCount;
+    MixpanelLatencyHistogram enqueueToSendLatency;
+    MixpanelLatencyHistogram sendToReplyLatency;
+    MixpanelBatchController batchController;
+    MixpanelDeadLetterStore deadLetterStore;
 };
 
+/// Returns the size in bytes of the content of the messages.
+
+static qint64 messagesBytes(const QList<MixpanelAnalyticsMessage>& messages)
+{
+    qint64 bytes = 0;
+    Q_FOREACH(MixpanelAnalyticsMessage analyticsMessage, messages)
+        bytes += analyticsMessage.contentSize();
+    return bytes;
+}
+
 /// Creates a MixpanelMessageQueue object.
 
 MixpanelMessageQueue::MixpanelMessageQueue(QObject* parent, MixpanelConfiguration config)
     : QObject(parent)
     , d(new MixpanelMessageQueuePrivate)
 {
-    d->networkAccessManager = new QNetworkAccessManager(this);
+    d->transport = NULL;
+    d->transportInjected = false;
+    d->nextBatchId = 0;
+    d->sendingBatches = false;
     d->flushTimer = NULL;
+    d->messageStore = NULL;
     d->configuartion = config;
-    d->requestOngoing = false;
+    d->pendingMessagesSaved = false;
+    d->drainLoop = NULL;
+    d->drainFailed = false;
+    d->drainSentMessages = 0;
+    d->internedBytesSaved = 0;
+    d->internedMessages = 0;
+    d->pendingCount = 0;
+    d->pendingBytes = 0;
+    d->underPressure = false;
+    d->admission = Accepted;
+    d->droppedMessages = 0;
+    d->sampledMessages = 0;
+    d->rejectedEvents = 0;
+    d->timedOutRequestCount = 0;
+    d->requestClock.start();
+
+    d->messageStoreSyncTimer = new QTimer(this);
+    d->messageStoreSyncTimer->setSingleShot(true);
+    d->messageStoreSyncTimer->setInterval(g_messageStoreSyncDelay);
+
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = connect(d->messageStoreSyncTimer, SIGNAL(timeout()), this, SLOT(syncMessageStore()));
+    Q_ASSERT(connectResult);
 
     initialise();
 }
@@ -48,8 +123,10 @@ MixpanelMessageQueue::MixpanelMessageQueue(QObject* parent, MixpanelConfiguratio
 
 MixpanelMessageQueue::~MixpanelMessageQueue()
 {
-    if (!d->messageQueue.isEmpty())
+    if (!d->pendingMessagesSaved && (queuedMessages() > 0 || !d->inFlightBatches.isEmpty()))
         saveMessageQueue();
+    delete d->transport;
+    delete d->messageStore;
     delete d;
 }
 
@@ -67,53 +144,262 @@ void MixpanelMessageQueue::setConfiguration(const MixpanelConfiguration& config)
 /// Records a people analytics message into the message queue.
 ///
 /// \param peopleMessage A raw analytic people message
+/// \param priority The priority of the message
 ///
 
-void MixpanelMessageQueue::recordPeopleMessage(const QByteArray& peopleMessage)
+void MixpanelMessageQueue::recordPeopleMessage(const QByteArray& peopleMessage, const MixpanelAnalyticsMessage::Priority priority)
 {
     qDebug() << "Engage profile analytic message to record";
-    recordAnalyticMessageAndProcessQueue(MixpanelAnalyticsMessage::Profile, peopleMessage);
+    recordAnalyticMessageAndProcessQueue(MixpanelAnalyticsMessage::Profile, peopleMessage, priority);
 }
 
 /// Records a event analytics message into the message queue.
 ///
 /// \param peopleMessage A raw analytic event message
+/// \param priority The priority of the message
 ///
 
-void MixpanelMessageQueue::recordEventMessage(const QByteArray& eventMessage)
+void MixpanelMessageQueue::recordEventMessage(const QByteArray& eventMessage, const MixpanelAnalyticsMessage::Priority priority)
 {
     qDebug() << "Event analytic message to record";
-    recordAnalyticMessageAndProcessQueue(MixpanelAnalyticsMessage::Event, eventMessage);
+    recordAnalyticMessageAndProcessQueue(MixpanelAnalyticsMessage::Event, eventMessage, priority);
 }
 
 /// Records a anaylic message in the queue and processs the queue to know whether or not
 /// the messages need to be posted to the Mixpanel server.
 ///
+/// \note High priority messages go to their own lane. With the Auto flush mechanism they are
+///  posted right away in a batch of their own, in parallel with the ongoing requests (up to
+///  MixpanelConfiguration::maxInFlightBatches), otherwise they go in the next batch posted.
+///
 /// \param type The analytic message type
 /// \param content A raw analytic message
+/// \param priority The priority of the message
 ///
 
-void MixpanelMessageQueue::recordAnalyticMessageAndProcessQueue(const MixpanelAnalyticsMessage::MessageType type, const QByteArray& content)
+void MixpanelMessageQueue::recordAnalyticMessageAndProcessQueue(const MixpanelAnalyticsMessage::MessageType type, const QByteArray& content, const MixpanelAnalyticsMessage::Priority priority)
 {
-    MixpanelAnalyticsMessage analyticsMessage(type, content);
-    d->messageQueue.push_back(analyticsMessage);
+    QByteArray compactContent = MixpanelStringPool::instance().compact(content);
+    d->internedBytesSaved += content.size() - compactContent.size();
+    d->internedMessages++;
+
+    if (!makeRoom(compactContent.size()))
+    {
+        qWarning() << "Message queue over budget -> Analytic message dropped";
+        d->droppedMessages++;
+        emit messagesDropped(1);
+        return;
+    }
+
+    const qint64 enqueueTime = MixpanelClock::currentMSecsSinceEpoch();
+    const qint64 storageId = d->messageStore->append(type, priority, enqueueTime, compactContent);
+    scheduleMessageStoreSync();
+    lane(priority).append(type, priority, compactContent, enqueueTime, MixpanelClock::elapsed(), storageId);
+    d->pendingMessagesSaved = false;
+    d->pendingCount++;
+    d->pendingBytes += compactContent.size();
+    checkWatermarks();
 
     qDebug() << "Analytic message queued";
 
+    if (priority == MixpanelAnalyticsMessage::HighPriority && d->configuartion.flushMechanism() == MixpanelConfiguration::Auto
+        && !d->drainLoop && d->inFlightBatches.size() < d->configuartion.maxInFlightBatches())
+    {
+        qDebug() << "High priority analytic message -> post it to Mixpanel server";
+        postAnalyticsBatch(takeBatch());
+    }
+
     processMessageQueue();
 }
 
-/// Process the message queue and posts the first message to the Mixpanel servers.
+/// Process the message queue and posts batches of messages to the Mixpanel servers, as many as the
+/// in flight window allows (see MixpanelBatchController).
+///
+/// \note The messages appended to the message store are written first (see MixpanelMessageStore::sync).
 ///
 
 void MixpanelMessageQueue::postToServer()
 {
-    qDebug() << "Posting pending anaylitics messages to Mixpanel server(" << d->messageQueue.size() << ")";
-    if (d->messageQueue.isEmpty())
-        return;
+    syncMessageStore();
+
+    qDebug() << "Posting pending anaylitics messages to Mixpanel server(" << queuedMessages() << ")";
+
+    const int batches = d->batchController.window() - d->inFlightBatches.size();
+    for (int i = 0; i < batches && queuedMessages() > 0; ++i)
+        postAnalyticsBatch(takeBatch());
+}
+
+/// Returns the messages refused by the Mixpanel server, see MixpanelDeadLetterStore::messages.
+
+QVariantList MixpanelMessageQueue::deadLetters() const
+{
+    return d->deadLetterStore.messages();
+}
+
+/// Removes the messages refused by the Mixpanel server.
+
+void MixpanelMessageQueue::clearDeadLetters()
+{
+    d->deadLetterStore.clear();
+}
+
+/// Returns whether an event should be tracked according to the queue budget.
+///
+/// \note It lets producers shed telemetry before encoding it when the queue falls behind:
+///     - Rejected: the queue is over budget and the drop policy is not DropOldest
+///     - Sampled: the queue is over the high watermark, the drop policy is SampleByEventName and
+///       this event is not one of the pressureSampleInterval events of its name that are kept
+///     - Accepted: otherwise
+///
+/// \param eventName The name of the event to track
+/// \return admission status
+///
+
+MixpanelMessageQueue::AdmissionStatus MixpanelMessageQueue::admit(const QString& eventName)
+{
+    if (d->underPressure && d->configuartion.dropPolicy() == MixpanelConfiguration::SampleByEventName)
+    {
+        int& counter = d->pressureSampleCounters[eventName];
+        if (counter++ % d->configuartion.pressureSampleInterval() != 0)
+        {
+            d->sampledMessages++;
+            return Sampled;
+        }
+    }
+
+    const qint64 estimatedBytes = d->pendingCount > 0 ? d->pendingBytes / d->pendingCount : 0;
+    if (d->configuartion.dropPolicy() != MixpanelConfiguration::DropOldest && isOverBudget(1, estimatedBytes))
+    {
+        d->rejectedEvents++;
+        return Rejected;
+    }
 
-    if (!d->requestOngoing)
-        postAnalyticsMessage(d->messageQueue.first());
+    return Accepted;
+}
+
+/// Returns the admission of new events by the queue, without counting an event as admit() does.
+///
+/// \return Rejected if the queue is over budget and the drop policy is not DropOldest, Sampled if it is
+///  over the high watermark and the drop policy is SampleByEventName, Accepted otherwise
+///
+
+MixpanelMessageQueue::AdmissionStatus MixpanelMessageQueue::admission() const
+{
+    const qint64 estimatedBytes = d->pendingCount > 0 ? d->pendingBytes / d->pendingCount : 0;
+    if (d->configuartion.dropPolicy() != MixpanelConfiguration::DropOldest && isOverBudget(1, estimatedBytes))
+        return Rejected;
+
+    if (d->underPressure && d->configuartion.dropPolicy() == MixpanelConfiguration::SampleByEventName)
+        return Sampled;
+
+    return Accepted;
+}
+
+/// Sends the pending messages during at most deadlineMs and persists the ones left.
+///
+/// \note The pending batches are posted in parallel (up to the in flight window of the batch controller).
+///  When all of them have been answered, a network error happens or the deadline expires, the requests
+///  still ongoing are aborted and the messages not sent are saved into the message store. The shutdownCompleted() signal
+///  reports the result.
+///
+/// \param deadlineMs Maximum time in miliseconds to send the pending messages. If it is 0 the messages
+///  are only persisted.
+///
+
+void MixpanelMessageQueue::shutdown(const int deadlineMs)
+{
+    syncMessageStore();
+    d->drainSentMessages = 0;
+
+    if (deadlineMs > 0 && (queuedMessages() > 0 || !d->inFlightBatches.isEmpty()))
+    {
+        qDebug() << "Shutdown -> draining pending messages (" << queuedMessages() << ") during" << deadlineMs << "ms";
+
+        QEventLoop drainLoop;
+        QTimer deadline;
+        deadline.setSingleShot(true);
+        connect(&deadline, SIGNAL(timeout()), &drainLoop, SLOT(quit()));
+
+        d->drainLoop = &drainLoop;
+        d->drainFailed = false;
+        postDrainBatches();
+
+        if (!d->inFlightBatches.isEmpty())
+        {
+            deadline.start(deadlineMs);
+            drainLoop.exec();
+        }
+
+        d->drainLoop = NULL;
+        abortInFlightBatches();
+    }
+
+    const int sentMessages = d->drainSentMessages;
+    const int persistedMessages = queuedMessages();
+
+    saveMessageQueue();
+
+    qDebug() << "Shutdown -> messages sent:" << sentMessages << "persisted:" << persistedMessages;
+    emit shutdownCompleted(sentMessages, persistedMessages);
+}
+
+/// Returns the message queue metrics.
+///
+/// \return a QVariantMap containing:
+///     - queuedMessages: number of messages waiting to be posted
+///     - queuedHighPriorityMessages: number of high priority messages waiting to be posted
+///     - inFlightMessages: number of messages posted and waiting for the server response
+///     - queuedBytes: memory used by the content of the queued and in flight messages
+///     - queueSlabs: number of slabs holding the queued messages (see MixpanelMessageRing)
+///     - underPressure: whether the queue is over the high watermark
+///     - droppedMessages: messages recorded but dropped because the queue was over budget
+///     - rejectedEvents: events refused by admit() because the queue was over budget, before being encoded
+///     - sampledMessages: events rejected by the SampleByEventName policy
+///     - timedOutRequests: requests aborted by the connect or request timeouts
+///     - enqueueToSendLatency: histogram of the time the messages wait in the queue (see MixpanelLatencyHistogram::toVariantMap)
+///     - sendToReplyLatency: histogram of the time the requests wait for the server reply
+///     - batchSize: current number of messages per batch (see MixpanelBatchController)
+///     - inFlightWindow: current number of batches that can be in flight at once
+///     - roundTripTime: moving average of the round trip time of the accepted batches
+///     - batchBackOffs: times the batch size or the window have been decreased
+///     - deadLetters: messages refused by the server and quarantined (see deadLetters())
+///     - expiredMessages: persisted messages pruned because they exceeded their ttl
+///     - trimmedMessages: persisted messages pruned because the backlog exceeded maxPersistedMessages
+///     - clockOffset: difference in miliseconds between the server time and the device time (see MixpanelClock)
+///     - internedStrings: number of strings in the MixpanelStringPool
+///     - internedBytesSaved: bytes saved by the string pool since the queue was created
+///     - internedBytesSavedPerMessage: average bytes saved per recorded message
+///
+
+QVariantMap MixpanelMessageQueue::statistics() const
+{
+    QVariantMap stats;
+
+    stats.insert("queuedMessages", queuedMessages());
+    stats.insert("queuedHighPriorityMessages", d->priorityQueue.size());
+    stats.insert("inFlightMessages", d->pendingCount - queuedMessages());
+    stats.insert("queuedBytes", d->pendingBytes);
+    stats.insert("queueSlabs", d->priorityQueue.slabs() + d->messageQueue.slabs());
+    stats.insert("underPressure", d->underPressure);
+    stats.insert("droppedMessages", d->droppedMessages);
+    stats.insert("rejectedEvents", d->rejectedEvents);
+    stats.insert("sampledMessages", d->sampledMessages);
+    stats.insert("timedOutRequests", d->timedOutRequestCount);
+    stats.insert("enqueueToSendLatency", d->enqueueToSendLatency.toVariantMap());
+    stats.insert("sendToReplyLatency", d->sendToReplyLatency.toVariantMap());
+    stats.insert("batchSize", d->batchController.batchSize());
+    stats.insert("inFlightWindow", d->batchController.window());
+    stats.insert("roundTripTime", d->batchController.smoothedRoundTripTime());
+    stats.insert("batchBackOffs", d->batchController.backOffs());
+    stats.insert("deadLetters", d->deadLetterStore.size());
+    stats.insert("expiredMessages", d->messageStore->expiredMessages());
+    stats.insert("trimmedMessages", d->messageStore->trimmedMessages());
+    stats.insert("clockOffset", MixpanelClock::serverTimeOffset());
+    stats.insert("internedStrings", MixpanelStringPool::instance().size());
+    stats.insert("internedBytesSaved", d->internedBytesSaved);
+    stats.insert("internedBytesSavedPerMessage", d->internedMessages > 0 ? double(d->internedBytesSaved) / d->internedMessages : 0.0);
+
+    return stats;
 }
 
 /// Initialises the MixpanelMessageQueue
@@ -126,11 +412,19 @@ void MixpanelMessageQueue::initialise()
 
     Q_UNUSED(connectResult);
 
-    d->networkAccessManager->disconnect();
     this->disconnect();
 
-    connectResult = connect(d->networkAccessManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkRequestFinished(QNetworkReply*)));
-    Q_ASSERT(connectResult);
+    initialiseTransport();
+
+    d->deadLetterStore.setMaxMessages(d->configuartion.maxDeadLetters());
+    d->deadLetterStore.setStorageNamespace(d->configuartion.token());
+    d->batchController.setLimits(d->configuartion.minBatchSize(), d->configuartion.maxBatchSize(), d->configuartion.maxInFlightBatches());
+
+    if (QCoreApplication::instance())
+    {
+        connectResult = connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), this, SLOT(appAboutToQuit()), Qt::UniqueConnection);
+        Q_ASSERT(connectResult);
+    }
 
     if (d->configuartion.flushMechanism() == MixpanelConfiguration::Auto)
     {
@@ -138,10 +432,208 @@ void MixpanelMessageQueue::initialise()
         setThumbnailFlush(d->configuartion.thumbnailFlush());
     }
 
-    restoreMessageQueue();
+    initialiseMessageStore();
     processMessageQueue();
 }
 
+/// Creates the transport of the configuration, unless one has been set with setTransport.
+///
+/// \note If the transport changes, the ongoing batches are aborted and queued again.
+///
+
+void MixpanelMessageQueue::initialiseTransport()
+{
+    if (d->transport && (d->transportInjected || d->transport->type() == d->configuartion.transport()))
+    {
+        d->transport->setConfiguration(d->configuartion);
+        return;
+    }
+
+    setTransport(MixpanelTransport::create(d->configuartion, this));
+    d->transportInjected = false;
+}
+
+/// Sets the transport the batches are sent with, instead of the one of the configuration.
+///
+/// \note The queue takes ownership of the transport. The ongoing batches of the previous transport
+///  are aborted and queued again.
+///
+/// \param transport The new transport
+///
+
+void MixpanelMessageQueue::setTransport(MixpanelTransport* transport)
+{
+    if (!transport || transport == d->transport)
+        return;
+
+    if (d->transport)
+    {
+        abortInFlightBatches();
+        delete d->transport;
+    }
+
+    d->transport = transport;
+    d->transport->setParent(this);
+    d->transport->setConfiguration(d->configuartion);
+    d->transportInjected = true;
+
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = connect(d->transport, SIGNAL(batchFinished(int,MixpanelTransport::BatchResult,QVariantList)), this, SLOT(batchFinished(int,MixpanelTransport::BatchResult,QVariantList)));
+    Q_ASSERT(connectResult);
+
+    connectResult = connect(d->transport, SIGNAL(serverTimeReceived(qint64,qint64)), this, SLOT(serverTimeReceived(qint64,qint64)));
+    Q_ASSERT(connectResult);
+}
+
+/// Returns the transport the batches are sent with.
+
+MixpanelTransport& MixpanelMessageQueue::transport() const
+{
+    return *d->transport;
+}
+
+/// Creates the message store of the configured storage engine.
+///
+/// \note The messages left by the previous session are restored the first time, except the ones
+///  pruned by the retention of the configuration (see MixpanelConfiguration::setEventTtl). If the storage
+///  engine or the token (which namespaces the persisted messages, see MixpanelSettings) changes, the
+///  pending messages are moved from the previous store to the new one.
+///
+
+void MixpanelMessageQueue::initialiseMessageStore()
+{
+    if (d->messageStore && d->messageStore->engine() == d->configuartion.storageEngine()
+        && d->storageNamespace == d->configuartion.token())
+    {
+        d->messageStore->setRetention(d->configuartion.eventTtl(), d->configuartion.profileTtl(), d->configuartion.maxPersistedMessages());
+        return;
+    }
+
+    QList<MixpanelAnalyticsMessage> storedMessages = d->priorityQueue.messages() + d->messageQueue.messages();
+    d->priorityQueue.clear();
+    d->messageQueue.clear();
+
+    if (d->messageStore)
+    {
+        d->messageStore->remove(storedMessages);
+        delete d->messageStore;
+    }
+
+    d->storageNamespace = d->configuartion.token();
+    d->messageStore = MixpanelMessageStore::create(d->configuartion.storageEngine(), d->storageNamespace);
+    d->messageStore->setRetention(d->configuartion.eventTtl(), d->configuartion.profileTtl(), d->configuartion.maxPersistedMessages());
+    restoreMessageQueue();
+
+    for (int i = 0; i < storedMessages.size(); ++i)
+    {
+        MixpanelAnalyticsMessage analyticsMessage = storedMessages.at(i);
+        analyticsMessage.setStorageId(-1);
+        d->messageStore->append(analyticsMessage);
+        lane(analyticsMessage.priority()).append(analyticsMessage);
+    }
+    scheduleMessageStoreSync();
+
+    QList<MixpanelAnalyticsMessage> messages = pendingMessages();
+    d->pendingCount = messages.size();
+    d->pendingBytes = messagesBytes(messages);
+    checkWatermarks();
+}
+
+/// Returns whether the pending messages plus the given ones are over the queue budget.
+
+bool MixpanelMessageQueue::isOverBudget(const int extraMessages, const qint64 extraBytes) const
+{
+    const int maxMessages = d->configuartion.maxQueuedMessages();
+    const int maxBytes = d->configuartion.maxQueuedBytes();
+
+    return (maxMessages > 0 && d->pendingCount + extraMessages > maxMessages)
+        || (maxBytes > 0 && d->pendingBytes + extraBytes > maxBytes);
+}
+
+/// Makes room in the queue budget for a new message of the given size.
+///
+/// \note With the DropOldest policy the oldest queued messages (not the ones in flight) are dropped.
+///
+/// \return False if the new message must be dropped
+///
+
+bool MixpanelMessageQueue::makeRoom(const qint64 bytes)
+{
+    if (!isOverBudget(1, bytes))
+        return true;
+
+    if (d->configuartion.dropPolicy() != MixpanelConfiguration::DropOldest)
+        return false;
+
+    MixpanelMessageBatch droppedMessages;
+    while (!d->messageQueue.isEmpty() && isOverBudget(1, bytes))
+    {
+        d->messageQueue.takeFirst(droppedMessages);
+        d->pendingCount--;
+        d->pendingBytes -= droppedMessages.contentSize(droppedMessages.size() - 1);
+    }
+
+    if (!droppedMessages.isEmpty())
+    {
+        qWarning() << "Message queue over budget -> oldest analytic messages dropped (" << droppedMessages.size() << ")";
+        d->messageStore->remove(droppedMessages.storageIds());
+        d->droppedMessages += droppedMessages.size();
+        emit messagesDropped(droppedMessages.size());
+    }
+
+    return !isOverBudget(1, bytes);
+}
+
+/// Checks the queue against the watermarks and emits the pressure signals when crossed.
+
+void MixpanelMessageQueue::checkWatermarks()
+{
+    const qint64 maxMessages = d->configuartion.maxQueuedMessages();
+    const qint64 maxBytes = d->configuartion.maxQueuedBytes();
+    if (maxMessages <= 0 && maxBytes <= 0)
+    {
+        updateAdmission();
+        return;
+    }
+
+    const int high = d->configuartion.highWatermark();
+    const int low = d->configuartion.lowWatermark();
+
+    if (!d->underPressure)
+    {
+        if ((maxMessages > 0 && d->pendingCount * 100 >= maxMessages * high)
+            || (maxBytes > 0 && d->pendingBytes * 100 >= maxBytes * high))
+        {
+            d->underPressure = true;
+            emit highWatermarkReached(d->pendingCount, d->pendingBytes);
+        }
+    } else {
+        if ((maxMessages <= 0 || d->pendingCount * 100 <= maxMessages * low)
+            && (maxBytes <= 0 || d->pendingBytes * 100 <= maxBytes * low))
+        {
+            d->underPressure = false;
+            d->pressureSampleCounters.clear();
+            emit lowWatermarkReached(d->pendingCount, d->pendingBytes);
+        }
+    }
+
+    updateAdmission();
+}
+
+/// Emits admissionChanged() when the admission of new events changes.
+
+void MixpanelMessageQueue::updateAdmission()
+{
+    const AdmissionStatus currentAdmission = admission();
+    if (currentAdmission == d->admission)
+        return;
+
+    d->admission = currentAdmission;
+    emit admissionChanged(currentAdmission);
+}
+
 /// Sets the flush interval to flush the message queue
 ///
 /// \param flushInterval Flush interval in miliseconds
@@ -170,6 +662,23 @@ void MixpanelMessageQueue::setFlushTimerInterval(const int flushInterval)
     }
 }
 
+/// Starts the timer writing the messages appended to the message store, unless it is already running.
+
+void MixpanelMessageQueue::scheduleMessageStoreSync()
+{
+    if (d->messageStore->isDirty() && !d->messageStoreSyncTimer->isActive())
+        d->messageStoreSyncTimer->start();
+}
+
+/// Writes the messages appended to the message store (see MixpanelMessageStore::sync).
+
+void MixpanelMessageQueue::syncMessageStore()
+{
+    d->messageStoreSyncTimer->stop();
+    if (d->messageStore)
+        d->messageStore->sync();
+}
+
 /// Sets the thumbnail flush capacity.
 ///
 /// \param thumbnailFlushActive thubmnail flush active
@@ -189,16 +698,134 @@ void MixpanelMessageQueue::setThumbnailFlush(const bool thumbnailFlushActive)
     }
 }
 
-/// Posts a web request containing an analytic message
+/// Removes from the head of the queue the next batch of messages to post.
 ///
-/// \param analyticsMessage The anaylict message to be posted
+/// \note A batch contains up to MixpanelBatchController::batchSize consecutive messages of the same type and priority.
+///  The high priority lane is always emptied first.
 ///
 
-void MixpanelMessageQueue::postAnalyticsMessage(const MixpanelAnalyticsMessage& analyticsMessage)
+MixpanelMessageBatch MixpanelMessageQueue::takeBatch()
+{
+    MixpanelMessageRing& queue = d->priorityQueue.isEmpty() ? d->messageQueue : d->priorityQueue;
+    return queue.take(d->batchController.batchSize());
+}
+
+/// Puts back at the head of its lane a batch of messages that could not be sent.
+
+void MixpanelMessageQueue::requeueBatch(const MixpanelMessageBatch& batch)
 {
-    qDebug() << "Posting analytics message";
-    d->networkAccessManager->get(analyticsMessage.toNetworkRequest());
-    d->requestOngoing = true;
+    if (batch.isEmpty())
+        return;
+
+    lane(batch.priority()).prepend(batch);
+}
+
+/// Returns the lane of the queue for the messages of the given priority.
+
+MixpanelMessageRing& MixpanelMessageQueue::lane(const MixpanelAnalyticsMessage::Priority priority)
+{
+    return priority == MixpanelAnalyticsMessage::HighPriority ? d->priorityQueue : d->messageQueue;
+}
+
+/// Returns the number of messages waiting to be posted, in all the lanes.
+
+int MixpanelMessageQueue::queuedMessages() const
+{
+    return d->priorityQueue.size() + d->messageQueue.size();
+}
+
+/// Returns the messages not acknowledged by the server, the ones in flight first.
+
+QList<MixpanelAnalyticsMessage> MixpanelMessageQueue::pendingMessages() const
+{
+    QList<MixpanelAnalyticsMessage> messages;
+    Q_FOREACH(MixpanelMessageBatch batch, d->inFlightBatches)
+        messages.append(batch.messages());
+    messages.append(d->priorityQueue.messages());
+    messages.append(d->messageQueue.messages());
+    return messages;
+}
+
+/// Sends a batch of analytic messages with the transport
+///
+/// \note Transports may finish a batch while it is being sent. The batches posted meanwhile are
+///  sent afterwards by the outermost call, so the stack does not grow with the number of batches.
+///
+/// \param batch The anaylict messages to be posted
+///
+
+void MixpanelMessageQueue::postAnalyticsBatch(const MixpanelMessageBatch& batch)
+{
+    if (batch.isEmpty())
+        return;
+
+    qDebug() << "Posting analytics messages batch (" << batch.size() << ")";
+
+    const int batchId = d->nextBatchId++;
+    d->inFlightBatches.insert(batchId, batch);
+    d->batchesToSend.append(batchId);
+
+    if (d->sendingBatches)
+        return;
+
+    d->sendingBatches = true;
+    while (!d->batchesToSend.isEmpty())
+    {
+        const int nextBatchId = d->batchesToSend.takeFirst();
+        if (!d->inFlightBatches.contains(nextBatchId))
+            continue;
+
+        const MixpanelMessageBatch nextBatch = d->inFlightBatches.value(nextBatchId);
+
+        const qint64 now = MixpanelClock::currentMSecsSinceEpoch();
+        for (int i = 0; i < nextBatch.size(); ++i)
+            d->enqueueToSendLatency.record(now - nextBatch.enqueueTime(i));
+
+        d->requestSendTimes.insert(nextBatchId, d->requestClock.elapsed());
+        d->transport->send(nextBatchId, nextBatch);
+    }
+    d->sendingBatches = false;
+}
+
+/// Slot called when a reply carries the server time, it is added to the server time estimate used
+/// to correct the time of the messages when they are sent (see MixpanelAnalyticsMessage::expandedContent).
+
+void MixpanelMessageQueue::serverTimeReceived(qint64 serverTime, qint64 roundTripTime)
+{
+    MixpanelClock::addServerTimeSample(serverTime, roundTripTime);
+}
+
+/// Removes a batch from the in flight batches and returns its messages.
+
+MixpanelMessageBatch MixpanelMessageQueue::takeInFlightBatch(const int batchId)
+{
+    if (d->requestSendTimes.contains(batchId))
+        d->sendToReplyLatency.record(d->requestClock.elapsed() - d->requestSendTimes.take(batchId));
+
+    d->batchesToSend.removeAll(batchId);
+
+    return d->inFlightBatches.take(batchId);
+}
+
+/// Posts pending batches in parallel while draining the queue.
+
+void MixpanelMessageQueue::postDrainBatches()
+{
+    while (!d->drainFailed && queuedMessages() > 0 && d->inFlightBatches.size() < d->batchController.window())
+        postAnalyticsBatch(takeBatch());
+}
+
+/// Aborts the ongoing requests and puts their messages back in the queue.
+
+void MixpanelMessageQueue::abortInFlightBatches()
+{
+    QList<int> batchIds = d->inFlightBatches.keys();
+    qSort(batchIds);
+    for (int i = batchIds.size() - 1; i >= 0; --i)
+    {
+        requeueBatch(takeInFlightBatch(batchIds.at(i)));
+        d->transport->abort(batchIds.at(i));
+    }
 }
 
 /// Processes the message queue to check whether messsges need to be posted to the Mixpanel servers
@@ -209,15 +836,15 @@ void MixpanelMessageQueue::postAnalyticsMessage(const MixpanelAnalyticsMessage&
 
 void MixpanelMessageQueue::processMessageQueue()
 {
-    qDebug() << "Processing message queue(" << d->messageQueue.size() << ")";
-    if ((d->configuartion.flushMechanism() == MixpanelConfiguration::Auto) && (d->messageQueue.size() >= d->configuartion.messatesToFlush()))
+    qDebug() << "Processing message queue(" << queuedMessages() << ")";
+    if ((d->configuartion.flushMechanism() == MixpanelConfiguration::Auto) && (queuedMessages() >= d->configuartion.messatesToFlush()))
     {
-        qDebug() << "Message queue size(" << d->messageQueue.size() << ") -> post pending messages to Mixpanel server";
+        qDebug() << "Message queue size(" << queuedMessages() << ") -> post pending messages to Mixpanel server";
         postToServer();
     } else {
-        if (d->messageQueue.size() >= MAX_SIZE_QUEUE)
+        if (queuedMessages() >= MAX_SIZE_QUEUE)
         {
-            qDebug() << "Message queue size(" << d->messageQueue.size() << ") limit reached -> post pending messages to Mixpanel server";
+            qDebug() << "Message queue size(" << queuedMessages() << ") limit reached -> post pending messages to Mixpanel server";
             postToServer();
         }
     }
@@ -233,6 +860,18 @@ void MixpanelMessageQueue::flushIntervalTimeout()
     postToServer();
 }
 
+/// Slot called when the application is about to quit
+///
+/// \note It drains the message queue during MixpanelConfiguration::shutdownDeadline. The queue of a Mixpanel
+///  object is not connected to the application, it is shut down by Mixpanel::shutdown.
+///
+
+void MixpanelMessageQueue::appAboutToQuit()
+{
+    qDebug() << "App about to quit -> shutdown message queue";
+    shutdown(d->configuartion.shutdownDeadline());
+}
+
 /// Slot called when the app thumbanail
 ///
 /// \note It posts the pending messages to the Mixpanel server
@@ -244,76 +883,210 @@ void MixpanelMessageQueue::appThumbnail()
     postToServer();
 }
 
-/// Saves the current message queue into QSettings
+/// Saves the current message queue into the message store
+///
+/// \note See MixpanelConfiguration::StorageEngine. The messages pruned by the store are reported with
+///  messagesDropped().
 ///
 
 void MixpanelMessageQueue::saveMessageQueue()
 {
-    qDebug() << "Saving pending analytics messages (" << d->messageQueue.size() << ")";
-    QSettings settings(g_organizationName);
+    QList<MixpanelAnalyticsMessage> messages = pendingMessages();
+    const int prunedBefore = prunedMessages();
 
-    QVariantList analyticsMessages;
-    Q_FOREACH(MixpanelAnalyticsMessage analyticsMessage, d->messageQueue)
-    {
-        analyticsMessages.push_back(analyticsMessage.toVariantMap());
-    }
-    settings.setValue(g_analyticsMessagesKey, analyticsMessages);
+    qDebug() << "Saving pending analytics messages (" << messages.size() << ")";
+    d->messageStore->save(messages);
+    d->pendingMessagesSaved = true;
+
+    if (prunedMessages() > prunedBefore)
+        emit messagesDropped(prunedMessages() - prunedBefore);
 }
 
-/// Restores the latest message queue
+/// Restores the latest message queue from the message store
+///
+/// \note The messages pruned by the store are reported with messagesDropped() once the event loop
+///  runs, as the queue is restored while it is created, before anything is connected to it.
 ///
 
 void MixpanelMessageQueue::restoreMessageQueue()
 {
+    const int prunedBefore = prunedMessages();
 
-    QSettings settings(g_organizationName);
+    Q_FOREACH(MixpanelAnalyticsMessage analyticsMessage, d->messageStore->restore())
+        lane(analyticsMessage.priority()).append(analyticsMessage);
 
-    QVariantList analyticsMessages = settings.value(g_analyticsMessagesKey).toList();
+    qDebug() << "Pending Analytics Messages restored from last session (" << queuedMessages() << "), expired:"
+             << d->messageStore->expiredMessages() << "trimmed:" << d->messageStore->trimmedMessages();
 
-    Q_FOREACH(QVariant analytics, analyticsMessages)
-    {
-        MixpanelAnalyticsMessage analyticsMessage(analytics.toMap());
-        d->messageQueue.push_back(analyticsMessage);
-    }
-
-    settings.remove(g_analyticsMessagesKey);
+    if (prunedMessages() > prunedBefore)
+        QMetaObject::invokeMethod(this, "messagesDropped", Qt::QueuedConnection, Q_ARG(int, prunedMessages() - prunedBefore));
+}
 
-    qDebug() << "Pending Analytics Messages restored from last session (" << d->messageQueue.size() << ")";
+/// Returns the number of persisted messages pruned by the message store, expired or trimmed.
 
+int MixpanelMessageQueue::prunedMessages() const
+{
+    return d->messageStore->expiredMessages() + d->messageStore->trimmedMessages();
 }
 
-/// Slot called when a network request to Mixpanel server finishes
+/// Slot called when the transport finishes a batch
+///
+/// \note If the batch fails due a network error or a timeout the analytic messages will be
+///  sent next time that the message queue is processed. Timeouts, too large and throttled
+///  batches make the batch controller back off
 ///
-/// \note If the request fails due a network error the analytic message will be
-///  sent next time that the message queue is processed
+///  If Mixpanel server does not accept some messages they are quarantined in the
+///  MixpanelDeadLetterStore. The other messages of a rejected batch are sent again, those of
+///  a partially accepted batch are deleted. If the server does not report which messages
+///  are invalid (only /import does), the batch is split in halves sent again until the invalid
+///  messages are alone in their batch, only those are quarantined
 ///
-///  If Mixpanel server does not accept the message the message will be
-///  deleted adn the next message in the queue will be processed
+///  A batch too large that cannot be made smaller (the batch controller is at its minimum batch
+///  size) would be refused forever, so its largest message is quarantined and the others sent again
 ///
-///  If Mixpanel server accepts the message the next message the next
-///  message in the queue will be processed
+///  If Mixpanel server accepts the messages the next batches in the queue
+///  will be processed, as many as the in flight window allows
 ///
 
-void MixpanelMessageQueue::networkRequestFinished(QNetworkReply* reply)
+void MixpanelMessageQueue::batchFinished(int batchId, MixpanelTransport::BatchResult result, const QVariantList& recordErrors)
 {
-    d->requestOngoing = false;
+    if (!d->inFlightBatches.contains(batchId))
+        return;
+
+    const qint64 roundTripTime = d->requestClock.elapsed() - d->requestSendTimes.value(batchId, d->requestClock.elapsed());
+    MixpanelMessageBatch batch = takeInFlightBatch(batchId);
+
+    switch (result)
+    {
+    case MixpanelTransport::Accepted:
+    case MixpanelTransport::PartiallyAccepted:
+        d->batchController.batchAccepted(roundTripTime);
+        break;
+    case MixpanelTransport::Failed:
+        d->batchController.batchFailed();
+        break;
+    case MixpanelTransport::TimedOut:
+        d->batchController.batchTimedOut();
+        break;
+    case MixpanelTransport::TooLarge:
+        d->batchController.batchTooLarge();
+        break;
+    case MixpanelTransport::Throttled:
+        d->batchController.batchThrottled();
+        break;
+    default:
+        break;
+    }
+
+    int oversizedRecord = -1;
+    if (result == MixpanelTransport::TooLarge && batch.size() <= d->batchController.batchSize())
+    {
+        oversizedRecord = 0;
+        for (int i = 1; i < batch.size(); ++i)
+        {
+            if (batch.contentSize(i) > batch.contentSize(oversizedRecord))
+                oversizedRecord = i;
+        }
+        qWarning() << "Analytic message too large for a batch -> message quarantined";
+    }
 
-    if (reply->error() == QNetworkReply::NoError)
+    QHash<int, QString> rejectedRecords;
+    Q_FOREACH(QVariant recordError, recordErrors)
     {
-        QByteArray mixpanelResponse = reply->readAll();
-        if (mixpanelResponse.toInt() == MixpanelError)
+        const QVariantMap recordErrorMap = recordError.toMap();
+        const int index = recordErrorMap.value("index").toInt();
+        if (index >= 0 && index < batch.size())
+            rejectedRecords.insert(index, recordErrorMap.value("message").toString());
+    }
+    if (oversizedRecord >= 0)
+        rejectedRecords.insert(oversizedRecord, QString("Message too large"));
+
+    const bool batchRefused = result == MixpanelTransport::Rejected || oversizedRecord >= 0;
+    if (result == MixpanelTransport::Rejected && rejectedRecords.isEmpty() && batch.size() > 1)
+    {
+        qWarning() << "Batch rejected without record errors -> messages sent again in two batches (" << batch.size() << ")";
+
+        QList<int> firstHalf;
+        QList<int> secondHalf;
+        for (int i = 0; i < batch.size(); ++i)
+        {
+            if (i < batch.size() / 2)
+                firstHalf.append(i);
+            else
+                secondHalf.append(i);
+        }
+
+        postAnalyticsBatch(batch.records(firstHalf));
+        postAnalyticsBatch(batch.records(secondHalf));
+    } else if (result == MixpanelTransport::Accepted || result == MixpanelTransport::PartiallyAccepted || batchRefused) {
+
+        const bool batchRejected = result == MixpanelTransport::Rejected && rejectedRecords.isEmpty();
+
+        QList<int> deliveredRecords;
+        QList<int> quarantinedRecords;
+        QList<int> resentRecords;
+        QStringList quarantineErrors;
+        for (int i = 0; i < batch.size(); ++i)
+        {
+            if (batchRejected || rejectedRecords.contains(i))
+            {
+                quarantinedRecords.append(i);
+                quarantineErrors.append(rejectedRecords.value(i));
+            } else if (batchRefused) {
+                resentRecords.append(i);
+            } else {
+                deliveredRecords.append(i);
+            }
+        }
+
+        Q_FOREACH(int index, deliveredRecords)
+            emit mixpanelMessagePosted(NoError, batch.at(index).toVariantMap());
+        Q_FOREACH(int index, quarantinedRecords)
+            emit mixpanelMessagePosted(MixpanelError, batch.at(index).toVariantMap());
+
+        if (!quarantinedRecords.isEmpty())
+        {
+            d->deadLetterStore.append(batch.records(quarantinedRecords).messages(), quarantineErrors);
+            emit messagesQuarantined(quarantinedRecords.size());
+        }
+
+        const QList<int> finishedRecords = deliveredRecords + quarantinedRecords;
+        QList<qint64> finishedIds;
+        qint64 finishedBytes = 0;
+        Q_FOREACH(int index, finishedRecords)
+        {
+            finishedIds.append(batch.storageId(index));
+            finishedBytes += batch.contentSize(index);
+        }
+
+        d->messageStore->remove(finishedIds);
+        d->pendingMessagesSaved = false;
+        d->pendingCount -= finishedRecords.size();
+        d->pendingBytes -= finishedBytes;
+        requeueBatch(batch.records(resentRecords));
+        checkWatermarks();
+
+        if (d->drainLoop)
         {
-            qDebug() << "Error due to incorrect Analytic Message sent to Mixpanel server";
-            emit mixpanelMessagePosted(MixpanelError, d->messageQueue.first().toVariantMap());
+            d->drainSentMessages += finishedRecords.size();
+            postDrainBatches();
+        } else if (batch.priority() == MixpanelAnalyticsMessage::HighPriority) {
+            if (!d->priorityQueue.isEmpty())
+                postAnalyticsBatch(takeBatch());
         } else {
-            qDebug() << "Analytic Message sent successfully to Mixpanel server";
-            emit mixpanelMessagePosted(NoError, d->messageQueue.first().toVariantMap());
+            while (queuedMessages() > 0 && d->inFlightBatches.size() < d->batchController.window())
+                postAnalyticsBatch(takeBatch());
         }
-        d->messageQueue.pop_front();
-        postToServer();
     } else {
-        qWarning() << "Network request error (" << reply->error() << "): " << reply->errorString();
-        emit mixpanelMessagePosted(NetworkError, d->messageQueue.first().toVariantMap());
+        if (result == MixpanelTransport::TimedOut)
+            d->timedOutRequestCount++;
+        requeueBatch(batch);
+        d->drainFailed = true;
+
+        for (int i = 0; i < batch.size(); ++i)
+            emit mixpanelMessagePosted(NetworkError, batch.at(i).toVariantMap());
     }
-}
 
+    if (d->drainLoop && d->inFlightBatches.isEmpty())
+        d->drainLoop->quit();
+}
@@ -0,0 +1,540 @@
+/*
+ * MixpanelMessageRing.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelMessageRing.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+
+#include <QUrl>
+
+#include <string.h>
+
+/// Header of a queued message, followed by its content and padded to 8 bytes.
+
+struct MixpanelMessageRecord
+{
+    qint64 enqueueTime;
+    qint64 enqueueClock;
+    qint64 storageId;
+    qint32 size;
+    qint16 type;
+    qint16 priority;
+};
+
+/// A slab of records, the used part goes from begin to end.
+
+class MixpanelMessageSlab
+{
+public:
+    explicit MixpanelMessageSlab(const int capacity);
+    ~MixpanelMessageSlab();
+
+    char* data;
+    int capacity;
+    int begin;
+    int end;
+
+private:
+    Q_DISABLE_COPY(MixpanelMessageSlab)
+};
+
+/// Returns the bytes taken in a slab by a message of the given size.
+
+static int recordSpace(const int size)
+{
+    return (int(sizeof(MixpanelMessageRecord)) + size + 7) & ~7;
+}
+
+/// Returns the header of a record.
+
+static MixpanelMessageRecord readHeader(const char* in)
+{
+    MixpanelMessageRecord record;
+    memcpy(&record, in, sizeof(record));
+    return record;
+}
+
+/// Writes the record of a message.
+
+static void writeRecord(char* out, const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                        const QByteArray& content, const qint64 enqueueTime, const qint64 enqueueClock, const qint64 storageId)
+{
+    MixpanelMessageRecord record;
+    record.enqueueTime = enqueueTime;
+    record.enqueueClock = enqueueClock;
+    record.storageId = storageId;
+    record.size = content.size();
+    record.type = qint16(type);
+    record.priority = qint16(priority);
+
+    memcpy(out, &record, sizeof(record));
+    memcpy(out + sizeof(record), content.constData(), content.size());
+}
+
+/// Reads the record of a message.
+///
+/// \return the bytes taken by the record
+///
+
+static int readRecord(const char* in, MixpanelAnalyticsMessage& message)
+{
+    const MixpanelMessageRecord record = readHeader(in);
+
+    message = MixpanelAnalyticsMessage(MixpanelAnalyticsMessage::MessageType(record.type), QByteArray(in + sizeof(record), record.size),
+                                       MixpanelAnalyticsMessage::Priority(record.priority), record.enqueueTime, record.enqueueClock);
+    message.setStorageId(record.storageId);
+
+    return recordSpace(record.size);
+}
+
+/// Appends the content of a record to a request body, as it is sent to the Mixpanel server.
+///
+/// \note The content is read in place, it is only copied to the body.
+///
+
+static void appendExpandedContent(QByteArray& body, const char* in)
+{
+    const MixpanelMessageRecord record = readHeader(in);
+    const QByteArray content = QByteArray::fromRawData(in + sizeof(record), record.size);
+
+    body.append(MixpanelAnalyticsMessage::expandedContent(MixpanelAnalyticsMessage::MessageType(record.type), content,
+                                                          record.enqueueTime, record.enqueueClock));
+}
+
+/// Creates an empty batch.
+
+MixpanelMessageBatch::MixpanelMessageBatch()
+    : m_bytes(0)
+{
+}
+
+/// Returns whether the batch has no message.
+
+bool MixpanelMessageBatch::isEmpty() const
+{
+    return m_offsets.isEmpty();
+}
+
+/// Returns the number of messages of the batch.
+
+int MixpanelMessageBatch::size() const
+{
+    return m_offsets.size();
+}
+
+/// Returns the size in bytes of the content of the messages.
+
+qint64 MixpanelMessageBatch::bytes() const
+{
+    return m_bytes;
+}
+
+/// Returns the type of the messages.
+///
+/// \note The batch must not be empty.
+///
+
+MixpanelAnalyticsMessage::MessageType MixpanelMessageBatch::type() const
+{
+    Q_ASSERT(!isEmpty());
+    return MixpanelAnalyticsMessage::MessageType(readHeader(record(0)).type);
+}
+
+/// Returns the priority of the messages.
+///
+/// \note The batch must not be empty.
+///
+
+MixpanelAnalyticsMessage::Priority MixpanelMessageBatch::priority() const
+{
+    Q_ASSERT(!isEmpty());
+    return MixpanelAnalyticsMessage::Priority(readHeader(record(0)).priority);
+}
+
+/// Returns the size in bytes of the stored content of a message.
+
+int MixpanelMessageBatch::contentSize(const int index) const
+{
+    return readHeader(record(index)).size;
+}
+
+/// Returns the time a message was queued (ms since epoch).
+
+qint64 MixpanelMessageBatch::enqueueTime(const int index) const
+{
+    return readHeader(record(index)).enqueueTime;
+}
+
+/// Returns the id of a message in the persistent store, -1 if it has not been stored.
+
+qint64 MixpanelMessageBatch::storageId(const int index) const
+{
+    return readHeader(record(index)).storageId;
+}
+
+/// Returns the ids of the messages in the persistent store, see storageId.
+
+QList<qint64> MixpanelMessageBatch::storageIds() const
+{
+    QList<qint64> ids;
+    ids.reserve(size());
+    for (int i = 0; i < size(); ++i)
+        ids.append(storageId(i));
+    return ids;
+}
+
+/// Returns the content of a message as it is sent, see MixpanelAnalyticsMessage::expandedContent.
+
+QByteArray MixpanelMessageBatch::expandedContent(const int index) const
+{
+    QByteArray content;
+    appendExpandedContent(content, record(index));
+    return content;
+}
+
+/// Returns a message of the batch.
+
+MixpanelAnalyticsMessage MixpanelMessageBatch::at(const int index) const
+{
+    MixpanelAnalyticsMessage message;
+    readRecord(record(index), message);
+    return message;
+}
+
+/// Returns the messages of the batch.
+
+QList<MixpanelAnalyticsMessage> MixpanelMessageBatch::messages() const
+{
+    QList<MixpanelAnalyticsMessage> messages;
+    messages.reserve(size());
+    for (int i = 0; i < size(); ++i)
+        messages.append(at(i));
+    return messages;
+}
+
+/// Returns a batch with a copy of the given messages, in the given order.
+
+MixpanelMessageBatch MixpanelMessageBatch::records(const QList<int>& indexes) const
+{
+    MixpanelMessageBatch batch;
+    Q_FOREACH(int index, indexes)
+        batch.appendRecord(record(index), recordSize(index));
+    return batch;
+}
+
+/// Returns a POST QNetworkRequest containing the messages of the batch.
+///
+/// \note The messages are sent as a JSON array in the "data" form parameter, as described in the
+///  Mixpanel HTTP API. The array is written straight from the records.
+///
+/// \param postData Returns the body of the request
+/// \return network request
+///
+
+QNetworkRequest MixpanelMessageBatch::toNetworkRequest(QByteArray& postData) const
+{
+    QNetworkRequest networkRequest;
+    if (isEmpty())
+        return networkRequest;
+
+    QByteArray content;
+    content.reserve(m_bytes + m_bytes / 2 + size() + 2);
+    content.append('[');
+    for (int i = 0; i < size(); ++i)
+    {
+        if (i > 0)
+            content.append(',');
+        appendExpandedContent(content, record(i));
+    }
+    content.append(']');
+
+    postData = "data=" + content.toBase64().toPercentEncoding();
+
+    if (type() == MixpanelAnalyticsMessage::Event)
+        networkRequest.setUrl(QUrl(g_urlTrackEvent));
+    else
+        networkRequest.setUrl(QUrl(g_urlEngageProfile));
+
+    networkRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+
+    return networkRequest;
+}
+
+/// Returns the record of a message.
+
+const char* MixpanelMessageBatch::record(const int index) const
+{
+    return m_records.constData() + m_offsets.at(index);
+}
+
+/// Returns the bytes taken by the record of a message.
+
+int MixpanelMessageBatch::recordSize(const int index) const
+{
+    return recordSpace(contentSize(index));
+}
+
+/// Appends a copy of a record at the end of the batch.
+
+void MixpanelMessageBatch::appendRecord(const char* record, const int space)
+{
+    m_offsets.append(m_records.size());
+    m_records.append(record, space);
+    m_bytes += readHeader(record).size;
+}
+
+/// Creates an empty slab.
+
+MixpanelMessageSlab::MixpanelMessageSlab(const int capacity)
+    : data(new char[capacity])
+    , capacity(capacity)
+    , begin(0)
+    , end(0)
+{
+}
+
+/// Destructor, frees the records.
+
+MixpanelMessageSlab::~MixpanelMessageSlab()
+{
+    delete[] data;
+}
+
+/// Creates an empty ring.
+
+MixpanelMessageRing::MixpanelMessageRing()
+    : m_spareSlab(NULL)
+    , m_size(0)
+    , m_bytes(0)
+{
+}
+
+/// Destructor, frees the slabs.
+
+MixpanelMessageRing::~MixpanelMessageRing()
+{
+    qDeleteAll(m_slabs);
+    delete m_spareSlab;
+}
+
+/// Queues a message at the tail.
+
+void MixpanelMessageRing::append(const MixpanelAnalyticsMessage& message)
+{
+    append(message.type(), message.priority(), message.content(), message.enqueueTime(), message.enqueueClock(), message.storageId());
+}
+
+/// Queues a message at the tail, written straight from its fields.
+///
+/// \param type Type of the analytic message
+/// \param priority Priority of the analytic message
+/// \param content Raw data of the analytic message, it may be compacted by MixpanelStringPool
+/// \param enqueueTime Time the message was queued (ms since epoch)
+/// \param enqueueClock Monotonic clock when the message was queued, -1 if it was restored from a previous run
+/// \param storageId Id of the message in the persistent store, -1 if it has not been stored
+///
+
+void MixpanelMessageRing::append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority, const QByteArray& content,
+                                 const qint64 enqueueTime, const qint64 enqueueClock, const qint64 storageId)
+{
+    writeRecord(appendSpace(recordSpace(content.size())), type, priority, content, enqueueTime, enqueueClock, storageId);
+
+    m_size++;
+    m_bytes += content.size();
+}
+
+/// Queues a message at the head, before the other ones.
+
+void MixpanelMessageRing::prepend(const MixpanelAnalyticsMessage& message)
+{
+    const QByteArray content = message.content();
+    writeRecord(prependSpace(recordSpace(content.size())), message.type(), message.priority(), content,
+                message.enqueueTime(), message.enqueueClock(), message.storageId());
+
+    m_size++;
+    m_bytes += content.size();
+}
+
+/// Queues the messages of a batch at the head, before the other ones and in the order of the batch.
+
+void MixpanelMessageRing::prepend(const MixpanelMessageBatch& batch)
+{
+    for (int i = batch.size() - 1; i >= 0; --i)
+    {
+        const int space = batch.recordSize(i);
+        memcpy(prependSpace(space), batch.record(i), space);
+    }
+
+    m_size += batch.size();
+    m_bytes += batch.bytes();
+}
+
+/// Moves the message at the head to the end of a batch.
+///
+/// \note The ring must not be empty.
+///
+
+void MixpanelMessageRing::takeFirst(MixpanelMessageBatch& batch)
+{
+    Q_ASSERT(!isEmpty());
+
+    MixpanelMessageSlab* slab = m_slabs.first();
+    const char* record = slab->data + slab->begin;
+    const int size = readHeader(record).size;
+    const int space = recordSpace(size);
+
+    batch.appendRecord(record, space);
+    slab->begin += space;
+
+    m_size--;
+    m_bytes -= size;
+
+    if (slab->begin == slab->end)
+        releaseFirstSlab();
+}
+
+/// Removes up to maxMessages consecutive messages of the type of the first one from the head and returns them.
+
+MixpanelMessageBatch MixpanelMessageRing::take(const int maxMessages)
+{
+    MixpanelMessageBatch batch;
+    if (isEmpty())
+        return batch;
+
+    const MixpanelAnalyticsMessage::MessageType type = firstType();
+    while (!isEmpty() && batch.size() < maxMessages && firstType() == type)
+        takeFirst(batch);
+
+    return batch;
+}
+
+/// Returns the type of the message at the head.
+///
+/// \note The ring must not be empty.
+///
+
+MixpanelAnalyticsMessage::MessageType MixpanelMessageRing::firstType() const
+{
+    Q_ASSERT(!isEmpty());
+
+    const MixpanelMessageSlab* slab = m_slabs.first();
+    return MixpanelAnalyticsMessage::MessageType(readHeader(slab->data + slab->begin).type);
+}
+
+/// Returns a copy of the queued messages, from the head to the tail.
+
+QList<MixpanelAnalyticsMessage> MixpanelMessageRing::messages() const
+{
+    QList<MixpanelAnalyticsMessage> messages;
+    messages.reserve(m_size);
+
+    Q_FOREACH(const MixpanelMessageSlab* slab, m_slabs)
+    {
+        int offset = slab->begin;
+        while (offset < slab->end)
+        {
+            MixpanelAnalyticsMessage message;
+            offset += readRecord(slab->data + offset, message);
+            messages.append(message);
+        }
+    }
+
+    return messages;
+}
+
+/// Removes all the messages.
+
+void MixpanelMessageRing::clear()
+{
+    while (!m_slabs.isEmpty())
+        releaseFirstSlab();
+
+    m_size = 0;
+    m_bytes = 0;
+}
+
+/// Returns whether no message is queued.
+
+bool MixpanelMessageRing::isEmpty() const
+{
+    return m_size == 0;
+}
+
+/// Returns the number of queued messages.
+
+int MixpanelMessageRing::size() const
+{
+    return m_size;
+}
+
+/// Returns the size in bytes of the content of the queued messages.
+
+qint64 MixpanelMessageRing::bytes() const
+{
+    return m_bytes;
+}
+
+/// Returns the number of slabs holding messages.
+
+int MixpanelMessageRing::slabs() const
+{
+    return m_slabs.size();
+}
+
+/// Returns room for a record of the given space at the tail, opening a new slab when the last one is full.
+
+char* MixpanelMessageRing::appendSpace(const int space)
+{
+    if (m_slabs.isEmpty() || m_slabs.last()->end + space > m_slabs.last()->capacity)
+        m_slabs.append(newSlab(space));
+
+    MixpanelMessageSlab* slab = m_slabs.last();
+    slab->end += space;
+    return slab->data + slab->end - space;
+}
+
+/// Returns room for a record of the given space before the head, opening a new slab when the first one has none.
+
+char* MixpanelMessageRing::prependSpace(const int space)
+{
+    if (m_slabs.isEmpty() || m_slabs.first()->begin < space)
+    {
+        MixpanelMessageSlab* slab = newSlab(space);
+        slab->begin = slab->end = slab->capacity & ~7;
+        m_slabs.prepend(slab);
+    }
+
+    MixpanelMessageSlab* slab = m_slabs.first();
+    slab->begin -= space;
+    return slab->data + slab->begin;
+}
+
+/// Returns an empty slab with room for a record of the given space, the spare one if it is large enough.
+
+MixpanelMessageSlab* MixpanelMessageRing::newSlab(const int space)
+{
+    if (m_spareSlab && m_spareSlab->capacity >= space)
+    {
+        MixpanelMessageSlab* slab = m_spareSlab;
+        m_spareSlab = NULL;
+        slab->begin = slab->end = 0;
+        return slab;
+    }
+
+    return new MixpanelMessageSlab(qMax(space, g_messageSlabSize));
+}
+
+/// Removes the first slab, keeping it as the spare one if there is none.
+
+void MixpanelMessageRing::releaseFirstSlab()
+{
+    MixpanelMessageSlab* slab = m_slabs.takeFirst();
+    if (!m_spareSlab && slab->capacity == g_messageSlabSize)
+        m_spareSlab = slab;
+    else
+        delete slab;
+}
@@ -0,0 +1,173 @@
+/*
+ * MixpanelMessageStore.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelMessageStore.hpp"
+
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelSettings.hpp"
+#include "../include/MixpanelSettingsMessageStore.hpp"
+#include "../include/MixpanelSqliteMessageStore.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+/// Creates a MixpanelMessageStore object that keeps every message.
+
+MixpanelMessageStore::MixpanelMessageStore()
+    : m_eventTtl(0)
+    , m_profileTtl(0)
+    , m_maxMessages(0)
+    , m_expiredMessages(0)
+    , m_trimmedMessages(0)
+{
+}
+
+/// Destructor, destroys the MixpanelMessageStore object.
+
+MixpanelMessageStore::~MixpanelMessageStore()
+{
+}
+
+/// Creates the message store of the given engine.
+///
+/// \param engine The storage engine
+/// \param storageNamespace Namespace of the persisted queue (see MixpanelSettings)
+/// \return a new store, owned by the caller
+///
+
+MixpanelMessageStore* MixpanelMessageStore::create(const MixpanelConfiguration::StorageEngine engine, const QString& storageNamespace)
+{
+    if (engine == MixpanelConfiguration::SqliteStorage)
+        return new MixpanelSqliteMessageStore(MixpanelSettings::filePath(g_sqliteQueueFileName, storageNamespace));
+
+    return new MixpanelSettingsMessageStore(storageNamespace);
+}
+
+/// Stores a queued message, see append(MessageType, Priority, qint64, QByteArray).
+///
+/// \param message The message queued, its storage id is updated
+///
+
+void MixpanelMessageStore::append(MixpanelAnalyticsMessage& message)
+{
+    message.setStorageId(append(message.type(), message.priority(), message.enqueueTime(), message.content()));
+}
+
+/// Removes the acknowledged messages, see remove(QList<qint64>).
+
+void MixpanelMessageStore::remove(const QList<MixpanelAnalyticsMessage>& messages)
+{
+    QList<qint64> storageIds;
+    storageIds.reserve(messages.size());
+    Q_FOREACH(MixpanelAnalyticsMessage message, messages)
+        storageIds.append(message.storageId());
+
+    remove(storageIds);
+}
+
+/// Returns whether appended messages wait for sync() to be written, false by default.
+
+bool MixpanelMessageStore::isDirty() const
+{
+    return false;
+}
+
+/// Writes the appended messages that have not been written yet, nothing by default.
+
+void MixpanelMessageStore::sync()
+{
+}
+
+/// Restores the string pool entries persisted with the messages.
+///
+/// \return False if the restored content must be re-compacted (see restoreContent)
+///
+
+bool MixpanelMessageStore::adoptStringPool(const QVariantList& stringPoolEntries)
+{
+    return MixpanelStringPool::instance().adoptDynamicEntries(stringPoolEntries);
+}
+
+/// Returns the content of a persisted message compacted with the current string pool.
+///
+/// \param content The persisted content
+/// \param stringPoolEntries The string pool entries persisted with the content
+/// \param stringPoolAdopted The result of adoptStringPool
+///
+
+QByteArray MixpanelMessageStore::restoreContent(const QByteArray& content, const QVariantList& stringPoolEntries, bool stringPoolAdopted)
+{
+    if (stringPoolAdopted)
+        return content;
+
+    MixpanelStringPool& stringPool = MixpanelStringPool::instance();
+    return stringPool.compact(MixpanelStringPool::expand(content, stringPoolEntries));
+}
+
+/// Sets which persisted messages are pruned.
+///
+/// \param eventTtl Time in miliseconds after which an event message expires, 0 if they do not expire
+/// \param profileTtl Time in miliseconds after which a profile message expires, 0 if they do not expire
+/// \param maxMessages Number of newest messages kept, 0 keeps all of them
+///
+
+void MixpanelMessageStore::setRetention(const qint64 eventTtl, const qint64 profileTtl, const int maxMessages)
+{
+    m_eventTtl = eventTtl;
+    m_profileTtl = profileTtl;
+    m_maxMessages = maxMessages;
+}
+
+/// Returns the number of messages pruned because they expired.
+
+int MixpanelMessageStore::expiredMessages() const
+{
+    return m_expiredMessages;
+}
+
+/// Returns the number of messages pruned because the persisted queue exceeded its maximum size.
+
+int MixpanelMessageStore::trimmedMessages() const
+{
+    return m_trimmedMessages;
+}
+
+/// Returns the enqueue time before which the messages of a type are expired, 0 if they do not expire.
+
+qint64 MixpanelMessageStore::expiryTime(const MixpanelAnalyticsMessage::MessageType type) const
+{
+    const qint64 ttl = type == MixpanelAnalyticsMessage::Event ? m_eventTtl : m_profileTtl;
+    if (ttl <= 0)
+        return 0;
+
+    return MixpanelClock::currentMSecsSinceEpoch() - ttl;
+}
+
+/// Returns the newest maxMessages messages that are not expired, and counts the pruned ones.
+
+QList<MixpanelAnalyticsMessage> MixpanelMessageStore::pruneMessages(const QList<MixpanelAnalyticsMessage>& messages)
+{
+    const qint64 eventExpiry = expiryTime(MixpanelAnalyticsMessage::Event);
+    const qint64 profileExpiry = expiryTime(MixpanelAnalyticsMessage::Profile);
+    const int firstMessage = m_maxMessages > 0 ? qMax(0, messages.size() - m_maxMessages) : 0;
+    if (eventExpiry == 0 && profileExpiry == 0 && firstMessage == 0)
+        return messages;
+
+    m_trimmedMessages += firstMessage;
+
+    QList<MixpanelAnalyticsMessage> keptMessages;
+    for (int i = firstMessage; i < messages.size(); ++i)
+    {
+        const MixpanelAnalyticsMessage& message = messages.at(i);
+        const qint64 expiry = message.type() == MixpanelAnalyticsMessage::Event ? eventExpiry : profileExpiry;
+        if (expiry > 0 && message.enqueueTime() < expiry)
+            m_expiredMessages++;
+        else
+            keptMessages.append(message);
+    }
+
+    return keptMessages;
+}
@@ -6,17 +6,22 @@
  */
 
 #include "../include/MixpanelPeople.hpp"
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelJsonWriter.hpp"
+#include "../include/MixpanelProfileCache.hpp"
 
-#include <bb/data/JsonDataAccess>
-#include <QDateTime>
+#include <QTimer>
 
-using namespace bb::data;
+#include "qdebug.h"
 
 class MixpanelPeoplePrivate
 {
 
 public:
     MixpanelPersistentIdentity persistentIdentity;
+    MixpanelProfileCache profileCache;
+    QTimer *profileCacheSyncTimer;
 };
 
 /// Creates a MixpanelPeople object.
@@ -26,7 +31,14 @@ MixpanelPeople::MixpanelPeople(QObject *parent)
     : QObject(parent)
     , d(new MixpanelPeoplePrivate)
 {
-
+    d->profileCacheSyncTimer = new QTimer(this);
+    d->profileCacheSyncTimer->setSingleShot(true);
+    d->profileCacheSyncTimer->setInterval(g_profileCacheSyncDelay);
+
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+    connectResult = connect(d->profileCacheSyncTimer, SIGNAL(timeout()), this, SLOT(syncProfileCache()));
+    Q_ASSERT(connectResult);
 }
 
 /// Destructor, destroys the MixpanelPeople object.
@@ -47,6 +59,52 @@ MixpanelPersistentIdentity& MixpanelPeople::persistentIdentity()
     return d->persistentIdentity;
 }
 
+/// Returns the cache of the profile properties, disabled by default.
+///
+/// \return profile cache
+///
+
+MixpanelProfileCache& MixpanelPeople::profileCache()
+{
+    return d->profileCache;
+}
+
+/// Returns the known properties of the identified user, without a request to the Mixpanel server.
+///
+/// \note Only the properties set while the profile cache is enabled are known (see MixpanelProfileCache).
+///
+/// \return the cached profile properties
+///
+
+QVariantMap MixpanelPeople::cachedProperties() const
+{
+    return d->profileCache.properties(d->persistentIdentity.peopleDistinctId());
+}
+
+/// Clears the profile cache, the next updates will send every property.
+
+void MixpanelPeople::clearProfileCache()
+{
+    if (d->profileCache.isEnabled())
+        d->profileCache.clear();
+}
+
+/// Writes the updates of the profile cache to QSettings, see MixpanelProfileCache::sync.
+
+void MixpanelPeople::syncProfileCache()
+{
+    d->profileCacheSyncTimer->stop();
+    d->profileCache.sync();
+}
+
+/// Starts the timer that syncs the profile cache, unless it is already running.
+
+void MixpanelPeople::scheduleProfileCacheSync()
+{
+    if (d->profileCache.isDirty() && !d->profileCacheSyncTimer->isActive())
+        d->profileCacheSyncTimer->start();
+}
+
 ///
 /// Associate future calls to set(QVariantMap) and increment(QvariantMap),
 /// with a particular People Analytics user.
@@ -62,6 +120,8 @@ MixpanelPersistentIdentity& MixpanelPeople::persistentIdentity()
 ///     that is meaningful to your other systems (for example, a server-side account
 ///     identifier).
 ///
+/// \note With the profile cache, the profile update is only sent the first time the user is identified.
+///
 
 void MixpanelPeople::identify(const QString& distinctId)
 {
@@ -95,14 +155,35 @@ QString MixpanelPeople::distinctId() const
 /// \param properties a QVariantMap containing the collection of properties you wish to apply
 ///      to the identified user. Each key in the JSONObject will be associated with
 ///      a property name, and the value of that key will be assigned to the property.
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::set(const QVariantMap& properties)
+void MixpanelPeople::set(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
     QVariantMap updatedProperties(properties);
     updatedProperties.unite(d->persistentIdentity.referrerProperties());
 
-    engageProfileMessage("$set", updatedProperties);
+    if (!d->profileCache.isEnabled())
+    {
+        engageProfileMessage("$set", updatedProperties, priority);
+        return;
+    }
+
+    const QString distinctId = d->persistentIdentity.peopleDistinctId();
+    const bool knownProfile = d->profileCache.contains(distinctId);
+
+    updatedProperties = d->profileCache.changedProperties(distinctId, updatedProperties);
+    if (knownProfile && updatedProperties.isEmpty())
+    {
+        qDebug() << "Profile properties unchanged -> Analytic message not recorded";
+        return;
+    }
+
+    if (engageProfileMessage("$set", updatedProperties, priority))
+    {
+        d->profileCache.set(distinctId, updatedProperties);
+        scheduleProfileCacheSync();
+    }
 }
 
 ///
@@ -112,14 +193,15 @@ void MixpanelPeople::set(const QVariantMap& properties)
 ///
 /// \param propertyName The name of the Mixpanel property. This must be a QString, for example "Zip Code"
 /// \param value The value of the Mixpanel property. For "Zip Code", this value might be the QString "90210"
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::set(const QString& propertyName, const QVariant& value)
+void MixpanelPeople::set(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority)
 {
     QVariantMap dataMap;
     dataMap.insert(propertyName, value);
 
-    set(dataMap);
+    set(dataMap, priority);
 }
 
 ///
@@ -128,11 +210,19 @@ void MixpanelPeople::set(const QString& propertyName, const QVariant& value)
 /// \param properties a QVariantMap containing the collection of properties you wish to apply
 ///      to the identified user. Each key in the JSONObject will be associated with
 ///      a property name, and the value of that key will be assigned to the property.
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::setOnce(const QVariantMap& properties)
+void MixpanelPeople::setOnce(const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
-    engageProfileMessage("$set_once", properties);
+    const QVariantMap unknownProperties = d->profileCache.unknownProperties(d->persistentIdentity.peopleDistinctId(), properties);
+    if (unknownProperties.isEmpty() && !properties.isEmpty())
+    {
+        qDebug() << "Profile properties already set -> Analytic message not recorded";
+        return;
+    }
+
+    engageProfileMessage("$set_once", unknownProperties, priority);
 }
 
 
@@ -141,28 +231,33 @@ void MixpanelPeople::setOnce(const QVariantMap& properties)
 ///
 /// \param propertyName The name of the Mixpanel property. This must be a QString, for example "Zip Code"
 /// \param value The value of the Mixpanel property. For "Zip Code", this value might be the QString "90210"
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::setOnce(const QString& propertyName, const QVariant& value)
+void MixpanelPeople::setOnce(const QString& propertyName, const QVariant& value, const MixpanelAnalyticsMessage::Priority priority)
 {
     QVariantMap dataMap;
     dataMap.insert(propertyName, value);
 
-    setOnce(dataMap);
+    setOnce(dataMap, priority);
 }
 
 
 /// Records a analytic profile update message using an action given
 ///
 /// \param actionProperties A QVariantMap containtin an action and its properties
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::setCustomAction(const QVariantMap& actionProperies)
+void MixpanelPeople::setCustomAction(const QVariantMap& actionProperies, const MixpanelAnalyticsMessage::Priority priority)
 {
+    d->profileCache.remove(d->persistentIdentity.peopleDistinctId());
+    scheduleProfileCacheSync();
+
     QByteArray peopleMessageData = stdPeopleMessage("", actionProperies);
 
     if (!peopleMessageData.isEmpty())
-       emit recordPeopleMessage(peopleMessageData);
+       emit recordPeopleMessage(peopleMessageData, priority);
     else
        emit engageProfileError(InvalidJson, "", actionProperies);
 }
@@ -174,9 +269,10 @@ void MixpanelPeople::setCustomAction(const QVariantMap& actionProperies)
 ///
 /// \param propertyName name of the People Analytics property that should have its value changed
 /// \param value the amount to be added to the current value of the named property
+/// \param priority High priority updates are sent right away instead of waiting for the next flush
 ///
 
-void MixpanelPeople::increment(const QString& propertyName, double value)
+void MixpanelPeople::increment(const QString& propertyName, double value, const MixpanelAnalyticsMessage::Priority priority)
 {
     QVariantMap properties;
     properties.insert(propertyName, QVariant(value));
@@ -188,14 +284,22 @@ void MixpanelPeople::increment(const QString& propertyName, double value)
         return;
     }
 
-    engageProfileMessage("$add", properties);
+    if (engageProfileMessage("$add", properties, priority))
+    {
+        d->profileCache.add(d->persistentIdentity.peopleDistinctId(), propertyName, value);
+        scheduleProfileCacheSync();
+    }
 }
 
 /// Records a delete user mixpanel analytics message
 
-void MixpanelPeople::deleteUser()
+void MixpanelPeople::deleteUser(const MixpanelAnalyticsMessage::Priority priority)
 {
-    engageProfileMessage("$delete", QVariantMap());
+    if (engageProfileMessage("$delete", QVariantMap(), priority))
+    {
+        d->profileCache.remove(d->persistentIdentity.peopleDistinctId());
+        scheduleProfileCacheSync();
+    }
 }
 
 /// Prepares the engage analytic message to be recorded
@@ -205,22 +309,28 @@ void MixpanelPeople::deleteUser()
 ///
 /// \param action is the action type of the engage message
 /// \param properties The properties to be contained in the engage message
+/// \param priority The priority of the engage message
+/// \return True if the message has been recorded
 ///
 
-void MixpanelPeople::engageProfileMessage(const QString& action, const QVariantMap& properties)
+bool MixpanelPeople::engageProfileMessage(const QString& action, const QVariantMap& properties, const MixpanelAnalyticsMessage::Priority priority)
 {
     if (engageHasErrors(action, properties))
     {
         qWarning() << "Profile update invalid -> Analytic message not recorded";
-        return;
+        return false;
     }
 
     QByteArray peopleMessageData = stdPeopleMessage(action, properties);
 
-    if (!peopleMessageData.isEmpty())
-        emit recordPeopleMessage(peopleMessageData);
-    else
+    if (peopleMessageData.isEmpty())
+    {
         emit engageProfileError(InvalidJson, action, properties);
+        return false;
+    }
+
+    emit recordPeopleMessage(peopleMessageData, priority);
+    return true;
 }
 
 /// Returns whether the engage action has any errors
@@ -258,11 +368,11 @@ bool MixpanelPeople::engageHasErrors(const QString& action, const QVariantMap& p
 /// \param properties A QVariantMap containing the key value pairs of the properties to include in this profile update.
 ///
 /// \note In case that action is empty it is considered that the action already inside the properties
+/// \return the message, empty if any text of the update is not valid Unicode
 
 QByteArray MixpanelPeople::stdPeopleMessage(const QString& action, const QVariantMap& properties)
 {
     QVariantMap dataMap;
-    JsonDataAccess dataAccess;
     QByteArray peopleMessageData;
 
     if (!action.isEmpty())
@@ -272,13 +382,11 @@ QByteArray MixpanelPeople::stdPeopleMessage(const QString& action, const QVarian
 
     dataMap.insert("$token", d->persistentIdentity.token());
     dataMap.insert("$distinct_id", d->persistentIdentity.peopleDistinctId());
-    dataMap.insert("$time", QDateTime::currentDateTimeUtc().toMSecsSinceEpoch());
-
-    dataAccess.saveToBuffer(dataMap, &peopleMessageData);
+    dataMap.insert("$time", MixpanelClock::currentMSecsSinceEpoch());
 
-    if (dataAccess.hasError())
+    if (!MixpanelJsonWriter::appendVariantMap(peopleMessageData, dataMap))
     {
-        qWarning() << "JsonDataAccess has errors";
+        qWarning() << "Profile update text is not valid Unicode";
         return QByteArray();
     }
 
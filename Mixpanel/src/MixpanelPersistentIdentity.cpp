@@ -8,6 +8,8 @@
 #include "../include/MixpanelPersistentIdentity.hpp"
 
 #include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelSettings.hpp"
+#include "../include/MixpanelStringPool.hpp"
 
 #include <bb/device/HardwareInfo>
 #include <bb/ApplicationInfo>
@@ -21,6 +23,8 @@ public:
     QString peopleDistinctId;
     QVariantMap referrerProperties;
     QVariantMap superPropertiesCache;
+    QString storageNamespace;
+    bool persistent;
 };
 
 /// Creates a PersistentIdentity object.
@@ -28,7 +32,7 @@ public:
 MixpanelPersistentIdentity::MixpanelPersistentIdentity()
     : d(new MixpanelPersistentIdentityPrivate())
 {
-
+    d->persistent = true;
 }
 
 /// Creates a copy of \a other.
@@ -55,6 +59,19 @@ MixpanelPersistentIdentity& MixpanelPersistentIdentity::operator=(const Mixpanel
     return *this;
 }
 
+/// Returns a detached copy of the identity whose changes are not persisted.
+///
+/// \note It is used by the MixpanelThreadContext objects, so the events tracked from other threads
+///  read their own copy instead of the identity shared by the thread of the Mixpanel object.
+///
+
+MixpanelPersistentIdentity MixpanelPersistentIdentity::snapshot() const
+{
+    MixpanelPersistentIdentity copy(*this);
+    copy.d.detach();
+    copy.d->persistent = false;
+    return copy;
+}
 
 /// Sets the Mixpanel token.
 ///
@@ -66,6 +83,40 @@ void MixpanelPersistentIdentity::setToken(const QString& token)
     d->token = token;
 }
 
+/// Sets the namespace of the persisted super properties and people distinct id (see MixpanelSettings).
+///
+/// \note If the namespace has persisted data it is loaded, otherwise the current data is persisted in it,
+///  so the data persisted before the namespace was set moves to the first namespace set.
+///
+/// \param storageNamespace The namespace, usually the Mixpanel token
+///
+
+void MixpanelPersistentIdentity::setStorageNamespace(const QString& storageNamespace)
+{
+    if (storageNamespace == d->storageNamespace)
+        return;
+
+    d->storageNamespace = storageNamespace;
+
+    MixpanelSettings settings(d->storageNamespace);
+    if (settings.contains(g_superPropertiesKey) || settings.contains(g_peopleDistinctIdKey))
+    {
+        loadPersistentData();
+    } else {
+        if (!d->superPropertiesCache.isEmpty())
+            saveSuperProperties();
+        if (!d->peopleDistinctId.isEmpty())
+            saveDistinctPeopleId();
+    }
+}
+
+/// Returns the namespace of the persisted data.
+
+QString MixpanelPersistentIdentity::storageNamespace() const
+{
+    return d->storageNamespace;
+}
+
 /// Sets the distinct id for the events.
 ///
 /// \param token distinct id to use on the events
@@ -166,6 +217,7 @@ void MixpanelPersistentIdentity::registerSuperProperties(const QVariantMap& supe
         }
     }
 
+    internSuperPropertyKeys();
     saveSuperProperties();
 }
 
@@ -189,6 +241,7 @@ void MixpanelPersistentIdentity::registerSuperPropertiesOnce(const QVariantMap&
         }
     }
 
+    internSuperPropertyKeys();
     saveSuperProperties();
 }
 
@@ -224,8 +277,11 @@ void MixpanelPersistentIdentity::unregisterSuperProperty(const QString& superPro
 
 void MixpanelPersistentIdentity::clearSuperProperties()
 {
-    QSettings settings(g_organizationName);
-    settings.remove(g_superPropertiesKey);
+    if (d->persistent)
+    {
+        MixpanelSettings settings(d->storageNamespace);
+        settings.remove(g_superPropertiesKey);
+    }
 
     d->superPropertiesCache.clear();
 }
@@ -272,10 +328,22 @@ void MixpanelPersistentIdentity::readIdentities()
 
 void MixpanelPersistentIdentity::loadPersistentData()
 {
-    QSettings settings(g_organizationName);
+    MixpanelSettings settings(d->storageNamespace);
     d->superPropertiesCache = settings.value(g_superPropertiesKey, QVariantMap()).toMap();
+    internSuperPropertyKeys();
 
-    d->peopleDistinctId = settings.value(g_peopleDistinctIdKey, QString()).toString();
+    d->peopleDistinctId = settings.value(g_peopleDistinctIdKey, d->peopleDistinctId).toString();
+}
+
+///
+/// Interns the names of the super properties, which are written in every event (see MixpanelStringPool).
+///
+
+void MixpanelPersistentIdentity::internSuperPropertyKeys()
+{
+    MixpanelStringPool& stringPool = MixpanelStringPool::instance();
+    Q_FOREACH(QString propertyName, d->superPropertiesCache.keys())
+        stringPool.intern(propertyName);
 }
 
 ///
@@ -284,7 +352,10 @@ void MixpanelPersistentIdentity::loadPersistentData()
 
 void MixpanelPersistentIdentity::saveSuperProperties()
 {
-    QSettings settings(g_organizationName);
+    if (!d->persistent)
+        return;
+
+    MixpanelSettings settings(d->storageNamespace);
     settings.setValue(g_superPropertiesKey, d->superPropertiesCache);
 }
 
@@ -294,7 +365,10 @@ void MixpanelPersistentIdentity::saveSuperProperties()
 
 void MixpanelPersistentIdentity::saveDistinctPeopleId()
 {
-    QSettings settings(g_organizationName);
+    if (!d->persistent)
+        return;
+
+    MixpanelSettings settings(d->storageNamespace);
     settings.setValue(g_peopleDistinctIdKey, d->peopleDistinctId);
 }
 
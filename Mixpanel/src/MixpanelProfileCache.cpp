@@ -0,0 +1,340 @@
+/*
+ * MixpanelProfileCache.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelProfileCache.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelJsonWriter.hpp"
+#include "../include/MixpanelSettings.hpp"
+
+#include <bb/data/JsonDataAccess>
+
+#include "qdebug.h"
+
+using namespace bb::data;
+
+/// Creates a MixpanelProfileCache object.
+///
+/// \param maxProfiles Number of profiles kept, 0 disables the cache
+///
+
+MixpanelProfileCache::MixpanelProfileCache(const int maxProfiles)
+    : m_maxProfiles(qMax(maxProfiles, 0))
+    , m_loaded(false)
+    , m_dirty(false)
+    , m_skippedProperties(0)
+{
+}
+
+/// Destructor, writes the updates not synced yet.
+///
+
+MixpanelProfileCache::~MixpanelProfileCache()
+{
+    sync();
+}
+
+/// Sets the number of profiles kept, the least recently updated ones are removed first.
+///
+/// \param maxProfiles Number of profiles kept, 0 disables the cache and removes the cached profiles
+///
+
+void MixpanelProfileCache::setMaxProfiles(const int maxProfiles)
+{
+    if (maxProfiles < 0 || maxProfiles == m_maxProfiles)
+        return;
+
+    m_maxProfiles = maxProfiles;
+
+    if (m_maxProfiles == 0)
+    {
+        clear();
+        return;
+    }
+
+    load();
+    if (m_recentProfiles.size() > m_maxProfiles)
+    {
+        trim();
+        m_dirty = true;
+    }
+}
+
+/// Sets the namespace of the persisted profiles (see MixpanelSettings), they are read again when needed.
+///
+/// \note The updates not synced yet are written to the previous namespace first.
+///
+
+void MixpanelProfileCache::setStorageNamespace(const QString& storageNamespace)
+{
+    if (storageNamespace == m_storageNamespace)
+        return;
+
+    sync();
+    m_storageNamespace = storageNamespace;
+    m_profiles.clear();
+    m_recentProfiles.clear();
+    m_loaded = false;
+}
+
+/// Returns whether the profiles are cached.
+
+bool MixpanelProfileCache::isEnabled() const
+{
+    return m_maxProfiles > 0;
+}
+
+/// Returns whether a profile has been updated since it was cached.
+
+bool MixpanelProfileCache::contains(const QString& distinctId) const
+{
+    if (!isEnabled())
+        return false;
+
+    load();
+    return m_profiles.contains(distinctId);
+}
+
+/// Returns the known properties of a profile, without a request to the Mixpanel server.
+///
+/// \param distinctId The distinct id of the profile
+/// \return the properties as decoded from JSON, empty if the profile is not cached
+///
+
+QVariantMap MixpanelProfileCache::properties(const QString& distinctId) const
+{
+    if (!contains(distinctId))
+        return QVariantMap();
+
+    JsonDataAccess dataAccess;
+    return dataAccess.loadFromBuffer(toJson(m_profiles.value(distinctId))).toMap();
+}
+
+/// Returns the properties whose value is not the cached one, the ones to send in a $set update.
+
+QVariantMap MixpanelProfileCache::changedProperties(const QString& distinctId, const QVariantMap& properties) const
+{
+    if (!contains(distinctId))
+        return properties;
+
+    const Profile& profile = m_profiles[distinctId];
+
+    QVariantMap changed;
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+    {
+        Profile::const_iterator cached = profile.constFind(it.key());
+        if (cached != profile.constEnd() && cached.value() == encode(it.value()))
+            m_skippedProperties++;
+        else
+            changed.insert(it.key(), it.value());
+    }
+
+    return changed;
+}
+
+/// Returns the properties that are not cached, the ones to send in a $set_once update.
+
+QVariantMap MixpanelProfileCache::unknownProperties(const QString& distinctId, const QVariantMap& properties) const
+{
+    if (!contains(distinctId))
+        return properties;
+
+    const Profile& profile = m_profiles[distinctId];
+
+    QVariantMap unknown;
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+    {
+        if (profile.contains(it.key()))
+            m_skippedProperties++;
+        else
+            unknown.insert(it.key(), it.value());
+    }
+
+    return unknown;
+}
+
+/// Records the properties of a $set update.
+///
+/// \note The profile becomes the most recently updated one, even if the properties are empty.
+///
+
+void MixpanelProfileCache::set(const QString& distinctId, const QVariantMap& properties)
+{
+    if (!isEnabled())
+        return;
+
+    load();
+
+    Profile& profile = m_profiles[distinctId];
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+    {
+        if (profile.size() < g_maxCachedProfileProperties || profile.contains(it.key()))
+            profile.insert(it.key(), encode(it.value()));
+    }
+
+    m_recentProfiles.removeOne(distinctId);
+    m_recentProfiles.append(distinctId);
+    trim();
+    m_dirty = true;
+}
+
+/// Folds an $add update into the cached value of the property.
+///
+/// \note Properties that are not cached are left unknown, the server keeps a value the cache does not know.
+///
+
+void MixpanelProfileCache::add(const QString& distinctId, const QString& propertyName, const double value)
+{
+    if (!contains(distinctId))
+        return;
+
+    Profile& profile = m_profiles[distinctId];
+    Profile::iterator cached = profile.find(propertyName);
+    if (cached == profile.end())
+        return;
+
+    bool isNumber = false;
+    const double cachedValue = cached.value().toDouble(&isNumber);
+    if (isNumber)
+        cached.value() = encode(cachedValue + value);
+    else
+        profile.erase(cached);
+
+    m_dirty = true;
+}
+
+/// Removes a profile, the next updates of the profile will send every property.
+
+void MixpanelProfileCache::remove(const QString& distinctId)
+{
+    if (!contains(distinctId))
+        return;
+
+    m_profiles.remove(distinctId);
+    m_recentProfiles.removeOne(distinctId);
+    m_dirty = true;
+}
+
+/// Removes all the profiles.
+
+void MixpanelProfileCache::clear()
+{
+    m_profiles.clear();
+    m_recentProfiles.clear();
+    m_loaded = true;
+    m_dirty = false;
+
+    MixpanelSettings settings(m_storageNamespace);
+    settings.remove(g_profileCacheKey);
+}
+
+/// Returns whether the cache has updates not written to QSettings yet.
+
+bool MixpanelProfileCache::isDirty() const
+{
+    return m_dirty;
+}
+
+/// Writes the cached profiles to QSettings if they were updated since the last write.
+
+void MixpanelProfileCache::sync()
+{
+    if (!m_dirty)
+        return;
+
+    m_dirty = false;
+    save();
+}
+
+/// Returns the number of properties not sent because their cached value was the same.
+
+qint64 MixpanelProfileCache::skippedProperties() const
+{
+    return m_skippedProperties;
+}
+
+/// Returns the JSON encoding of a property value.
+
+QByteArray MixpanelProfileCache::encode(const QVariant& value)
+{
+    QByteArray encodedValue;
+    MixpanelJsonWriter::appendVariant(encodedValue, value);
+    return encodedValue;
+}
+
+/// Returns the JSON object of a profile.
+
+QByteArray MixpanelProfileCache::toJson(const Profile& profile)
+{
+    QByteArray json;
+    json.append('{');
+    for (Profile::const_iterator it = profile.constBegin(); it != profile.constEnd(); ++it)
+    {
+        if (json.size() > 1)
+            json.append(',');
+        MixpanelJsonWriter::appendKey(json, it.key());
+        json.append(it.value());
+    }
+    json.append('}');
+
+    return json;
+}
+
+/// Reads the cached profiles from QSettings the first time they are needed.
+
+void MixpanelProfileCache::load() const
+{
+    if (m_loaded)
+        return;
+
+    m_loaded = true;
+
+    MixpanelSettings settings(m_storageNamespace);
+    const QVariantList cachedProfiles = settings.value(g_profileCacheKey).toList();
+
+    JsonDataAccess dataAccess;
+    Q_FOREACH(QVariant cachedProfile, cachedProfiles)
+    {
+        const QVariantMap profileMap = cachedProfile.toMap();
+        const QString distinctId = profileMap.value("id").toString();
+        const QVariantMap properties = dataAccess.loadFromBuffer(profileMap.value("properties").toByteArray()).toMap();
+        if (dataAccess.hasError())
+            continue;
+
+        Profile& profile = m_profiles[distinctId];
+        for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+            profile.insert(it.key(), encode(it.value()));
+
+        m_recentProfiles.removeOne(distinctId);
+        m_recentProfiles.append(distinctId);
+    }
+}
+
+/// Writes the cached profiles to QSettings, the least recently updated first.
+
+void MixpanelProfileCache::save() const
+{
+    QVariantList cachedProfiles;
+    Q_FOREACH(QString distinctId, m_recentProfiles)
+    {
+        QVariantMap profileMap;
+        profileMap.insert("id", distinctId);
+        profileMap.insert("properties", toJson(m_profiles.value(distinctId)));
+        cachedProfiles.append(profileMap);
+    }
+
+    MixpanelSettings settings(m_storageNamespace);
+    settings.setValue(g_profileCacheKey, cachedProfiles);
+}
+
+/// Removes the least recently updated profiles beyond maxProfiles.
+
+void MixpanelProfileCache::trim()
+{
+    while (m_recentProfiles.size() > m_maxProfiles)
+        m_profiles.remove(m_recentProfiles.takeFirst());
+}
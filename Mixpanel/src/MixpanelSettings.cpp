@@ -0,0 +1,57 @@
+/*
+ * MixpanelSettings.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelSettings.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+
+#include <QDir>
+
+/// Creates a MixpanelSettings object for the state of a namespace.
+///
+/// \param storageNamespace The namespace, usually the Mixpanel token
+///
+
+MixpanelSettings::MixpanelSettings(const QString& storageNamespace)
+    : QSettings(g_organizationName)
+{
+    if (!storageNamespace.isEmpty())
+        beginGroup(groupName(storageNamespace));
+}
+
+/// Returns the path, in the application data folder, of a file of a namespace.
+///
+/// \param fileName Name of the file, the namespace is inserted before its extension
+/// \param storageNamespace The namespace, usually the Mixpanel token
+///
+
+QString MixpanelSettings::filePath(const QString& fileName, const QString& storageNamespace)
+{
+    QString namespacedFileName(fileName);
+    if (!storageNamespace.isEmpty())
+    {
+        const int extension = namespacedFileName.lastIndexOf('.');
+        namespacedFileName.insert(extension < 0 ? namespacedFileName.size() : extension, "_" + groupName(storageNamespace));
+    }
+
+    return QDir::homePath() + "/" + namespacedFileName;
+}
+
+/// Returns the namespace with only letters, digits, '-' and '_', so it can name a group or a file.
+
+QString MixpanelSettings::groupName(const QString& storageNamespace)
+{
+    QString name(storageNamespace);
+    for (int i = 0; i < name.size(); ++i)
+    {
+        const QChar c = name.at(i);
+        if (!(c.isLetterOrNumber() && c.unicode() < 128) && c != '-' && c != '_')
+            name[i] = '_';
+    }
+
+    return name;
+}
@@ -0,0 +1,119 @@
+/*
+ * MixpanelSettingsMessageStore.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelSettingsMessageStore.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelSettings.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+/// Creates a MixpanelSettingsMessageStore object.
+///
+/// \param storageNamespace Namespace of the persisted queue (see MixpanelSettings)
+///
+
+MixpanelSettingsMessageStore::MixpanelSettingsMessageStore(const QString& storageNamespace)
+    : m_storageNamespace(storageNamespace)
+{
+}
+
+/// Destructor, destroys the MixpanelSettingsMessageStore object.
+
+MixpanelSettingsMessageStore::~MixpanelSettingsMessageStore()
+{
+}
+
+/// Returns SettingsStorage.
+
+MixpanelConfiguration::StorageEngine MixpanelSettingsMessageStore::engine() const
+{
+    return MixpanelConfiguration::SettingsStorage;
+}
+
+/// Does nothing, the queued messages are only written by save().
+///
+/// \return -1, the messages have no storage id
+///
+
+qint64 MixpanelSettingsMessageStore::append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                                            const qint64 enqueueTime, const QByteArray& content)
+{
+    Q_UNUSED(type);
+    Q_UNUSED(priority);
+    Q_UNUSED(enqueueTime);
+    Q_UNUSED(content);
+    return -1;
+}
+
+/// Does nothing, the queued messages are only written by save().
+
+void MixpanelSettingsMessageStore::remove(const QList<qint64>& storageIds)
+{
+    Q_UNUSED(storageIds);
+}
+
+/// Saves the message queue into QSettings
+///
+/// \note The messages are saved compacted, together with the string pool entries needed to expand them.
+///  The expired messages are not saved (see MixpanelMessageStore::setRetention).
+///
+
+void MixpanelSettingsMessageStore::save(const QList<MixpanelAnalyticsMessage>& messages)
+{
+    MixpanelSettings settings(m_storageNamespace);
+
+    QVariantList analyticsMessages;
+    Q_FOREACH(MixpanelAnalyticsMessage analyticsMessage, pruneMessages(messages))
+    {
+        analyticsMessages.push_back(analyticsMessage.toStorageMap());
+    }
+    settings.setValue(g_stringPoolKey, MixpanelStringPool::instance().dynamicEntries());
+    settings.setValue(g_analyticsMessagesKey, analyticsMessages);
+}
+
+/// Restores the message queue saved into QSettings, and removes it from QSettings.
+///
+/// \note The expired messages are skipped before their content is restored. The messages saved by the
+///  versions that did not store the enqueue time are never expired, they are restored with the
+///  current time.
+///
+
+QList<MixpanelAnalyticsMessage> MixpanelSettingsMessageStore::restore()
+{
+    MixpanelSettings settings(m_storageNamespace);
+
+    QVariantList analyticsMessages = settings.value(g_analyticsMessagesKey).toList();
+    QVariantList stringPoolEntries = settings.value(g_stringPoolKey).toList();
+
+    bool stringPoolAdopted = adoptStringPool(stringPoolEntries);
+
+    const qint64 eventExpiry = expiryTime(MixpanelAnalyticsMessage::Event);
+    const qint64 profileExpiry = expiryTime(MixpanelAnalyticsMessage::Profile);
+    const int firstMessage = m_maxMessages > 0 ? qMax(0, analyticsMessages.size() - m_maxMessages) : 0;
+    m_trimmedMessages += firstMessage;
+
+    QList<MixpanelAnalyticsMessage> messages;
+    for (int i = firstMessage; i < analyticsMessages.size(); ++i)
+    {
+        QVariantMap analyticsMap = analyticsMessages.at(i).toMap();
+
+        const qint64 expiry = analyticsMap.value("type").toInt() == MixpanelAnalyticsMessage::Event ? eventExpiry : profileExpiry;
+        if (expiry > 0 && analyticsMap.contains("time") && analyticsMap.value("time").toLongLong() < expiry)
+        {
+            m_expiredMessages++;
+            continue;
+        }
+
+        analyticsMap.insert("content", restoreContent(analyticsMap.value("content").toByteArray(), stringPoolEntries, stringPoolAdopted));
+
+        messages.push_back(MixpanelAnalyticsMessage(analyticsMap));
+    }
+
+    settings.remove(g_analyticsMessagesKey);
+
+    return messages;
+}
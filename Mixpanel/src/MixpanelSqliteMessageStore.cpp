@@ -0,0 +1,386 @@
+/*
+ * MixpanelSqliteMessageStore.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelSqliteMessageStore.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelStringPool.hpp"
+
+#include <QDir>
+#include <QSqlError>
+
+#include "qdebug.h"
+
+/// Number of rows read by every range scan when the queue is restored
+static const int g_restorePageSize = 1000;
+
+/// Creates a MixpanelSqliteMessageStore object and opens (or creates) its database.
+///
+/// \param databasePath Path of the database file. By default g_sqliteQueueFileName in the application data folder
+///
+
+MixpanelSqliteMessageStore::MixpanelSqliteMessageStore(const QString& databasePath)
+    : m_connectionName(QString("Mixpanel message store %1").arg(quintptr(this)))
+    , m_insertQuery(NULL)
+    , m_savedStringPoolEntries(0)
+    , m_inTransaction(false)
+{
+    m_database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    m_database.setDatabaseName(databasePath.isEmpty() ? QDir::homePath() + "/" + g_sqliteQueueFileName : databasePath);
+
+    if (!m_database.open())
+    {
+        qWarning() << "Message store database could not be opened:" << m_database.lastError().text();
+        return;
+    }
+
+    execute("PRAGMA journal_mode=WAL");
+    execute("PRAGMA synchronous=NORMAL");
+    execute("CREATE TABLE IF NOT EXISTS messages ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "type INTEGER NOT NULL, "
+            "priority INTEGER NOT NULL DEFAULT 0, "
+            "enqueued INTEGER NOT NULL, "
+            "content BLOB NOT NULL)");
+    execute("CREATE INDEX IF NOT EXISTS messages_priority ON messages (priority, id)");
+    execute("CREATE TABLE IF NOT EXISTS string_pool (id INTEGER PRIMARY KEY, token BLOB NOT NULL)");
+
+    m_insertQuery = new QSqlQuery(m_database);
+    m_insertQuery->prepare("INSERT INTO messages (type, priority, enqueued, content) VALUES (?, ?, ?, ?)");
+}
+
+/// Destructor, commits the appended messages and closes the database.
+
+MixpanelSqliteMessageStore::~MixpanelSqliteMessageStore()
+{
+    sync();
+    delete m_insertQuery;
+
+    m_database.close();
+    m_database = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+/// Returns SqliteStorage.
+
+MixpanelConfiguration::StorageEngine MixpanelSqliteMessageStore::engine() const
+{
+    return MixpanelConfiguration::SqliteStorage;
+}
+
+/// Stores a queued message in its own row.
+///
+/// \note The row is written in the transaction of the appended messages, committed by sync().
+///
+/// \return the row id of the message, -1 if it could not be stored
+///
+
+qint64 MixpanelSqliteMessageStore::append(const MixpanelAnalyticsMessage::MessageType type, const MixpanelAnalyticsMessage::Priority priority,
+                                          const qint64 enqueueTime, const QByteArray& content)
+{
+    if (!m_insertQuery)
+        return -1;
+
+    beginTransaction();
+    saveStringPool();
+
+    m_insertQuery->addBindValue((int)type);
+    m_insertQuery->addBindValue((int)priority);
+    m_insertQuery->addBindValue(enqueueTime);
+    m_insertQuery->addBindValue(content);
+
+    qint64 storageId = -1;
+    if (m_insertQuery->exec())
+        storageId = m_insertQuery->lastInsertId().toLongLong();
+    else
+        qWarning() << "Analytic message could not be stored:" << m_insertQuery->lastError().text();
+
+    return storageId;
+}
+
+/// Returns whether the transaction of the appended messages is open.
+
+bool MixpanelSqliteMessageStore::isDirty() const
+{
+    return m_inTransaction;
+}
+
+/// Commits the transaction of the appended messages.
+
+void MixpanelSqliteMessageStore::sync()
+{
+    if (!m_inTransaction)
+        return;
+
+    m_inTransaction = false;
+    if (!m_database.commit())
+        qWarning() << "Analytic messages could not be stored:" << m_database.lastError().text();
+}
+
+/// Deletes the acknowledged messages in a single transaction.
+///
+/// \note Contiguous batches, the usual case, are deleted with a single range delete.
+///
+
+void MixpanelSqliteMessageStore::remove(const QList<qint64>& storageIds)
+{
+    if (!m_database.isOpen())
+        return;
+
+    QList<qint64> ids;
+    qint64 minId = 0;
+    qint64 maxId = 0;
+    Q_FOREACH(qint64 id, storageIds)
+    {
+        if (id < 0)
+            continue;
+
+        minId = ids.isEmpty() ? id : qMin(minId, id);
+        maxId = ids.isEmpty() ? id : qMax(maxId, id);
+        ids.append(id);
+    }
+
+    if (ids.isEmpty())
+        return;
+
+    sync();
+    m_database.transaction();
+
+    QSqlQuery query(m_database);
+    if (maxId - minId + 1 == ids.size())
+    {
+        query.prepare("DELETE FROM messages WHERE id BETWEEN ? AND ?");
+        query.addBindValue(minId);
+        query.addBindValue(maxId);
+        query.exec();
+    } else {
+        query.prepare("DELETE FROM messages WHERE id = ?");
+        Q_FOREACH(qint64 id, ids)
+        {
+            query.addBindValue(id);
+            query.exec();
+        }
+    }
+
+    if (!m_database.commit())
+        qWarning() << "Acknowledged messages could not be deleted:" << m_database.lastError().text();
+}
+
+/// Stores the messages that have not been stored yet and the string pool entries.
+///
+/// \note Messages are stored when queued, so there is usually nothing left to write. The expired
+///  messages are deleted (see pruneStoredMessages).
+///
+
+void MixpanelSqliteMessageStore::save(const QList<MixpanelAnalyticsMessage>& messages)
+{
+    if (!m_database.isOpen())
+        return;
+
+    beginTransaction();
+    saveStringPool();
+
+    Q_FOREACH(MixpanelAnalyticsMessage message, messages)
+    {
+        if (message.storageId() < 0)
+            append(message);
+    }
+
+    sync();
+    pruneStoredMessages();
+}
+
+/// Restores the messages stored by previous sessions, in the order they were queued.
+///
+/// \note The expired messages are deleted before the messages are read (see pruneStoredMessages).
+///
+
+QList<MixpanelAnalyticsMessage> MixpanelSqliteMessageStore::restore()
+{
+    QList<MixpanelAnalyticsMessage> messages;
+    if (!m_database.isOpen())
+        return messages;
+
+    sync();
+    pruneStoredMessages();
+
+    QVariantList stringPoolEntries;
+    QSqlQuery stringPoolQuery("SELECT token FROM string_pool ORDER BY id", m_database);
+    while (stringPoolQuery.next())
+        stringPoolEntries.append(stringPoolQuery.value(0));
+
+    const bool stringPoolAdopted = adoptStringPool(stringPoolEntries);
+
+    qint64 lastId = 0;
+    QList<MixpanelAnalyticsMessage> page = load(lastId, g_restorePageSize);
+    while (!page.isEmpty())
+    {
+        lastId = page.last().storageId();
+        messages.append(page);
+        page = load(lastId, g_restorePageSize);
+    }
+
+    if (!stringPoolAdopted)
+    {
+        qDebug() << "String pool changed -> compacting stored messages again";
+
+        m_database.transaction();
+        execute("DELETE FROM string_pool");
+        m_savedStringPoolEntries = 0;
+
+        QSqlQuery update(m_database);
+        update.prepare("UPDATE messages SET content = ? WHERE id = ?");
+        for (int i = 0; i < messages.size(); ++i)
+        {
+            QVariantMap analyticsMap = messages.at(i).toStorageMap();
+            analyticsMap.insert("content", restoreContent(messages.at(i).content(), stringPoolEntries, false));
+
+            MixpanelAnalyticsMessage message(analyticsMap);
+            message.setStorageId(messages.at(i).storageId());
+            messages[i] = message;
+
+            update.addBindValue(message.content());
+            update.addBindValue(message.storageId());
+            update.exec();
+        }
+
+        saveStringPool();
+        m_database.commit();
+    } else {
+        MixpanelStringPool& stringPool = MixpanelStringPool::instance();
+        m_savedStringPoolEntries = stringPool.size() - stringPool.dynamicEntries().size() + stringPoolEntries.size();
+    }
+
+    return messages;
+}
+
+/// Reads a batch of stored messages with a range scan.
+///
+/// \param afterId Only messages with a greater storage id are read
+/// \param maxMessages Maximum number of messages to read
+/// \return the messages ordered by storage id
+///
+
+QList<MixpanelAnalyticsMessage> MixpanelSqliteMessageStore::load(const qint64 afterId, const int maxMessages)
+{
+    QList<MixpanelAnalyticsMessage> messages;
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, type, enqueued, content, priority FROM messages WHERE id > ? ORDER BY id LIMIT ?");
+    query.addBindValue(afterId);
+    query.addBindValue(maxMessages);
+
+    if (!query.exec())
+    {
+        qWarning() << "Stored messages could not be read:" << query.lastError().text();
+        return messages;
+    }
+
+    while (query.next())
+    {
+        QVariantMap analyticsMap;
+        analyticsMap.insert("type", query.value(1));
+        analyticsMap.insert("time", query.value(2));
+        analyticsMap.insert("content", query.value(3));
+        analyticsMap.insert("priority", query.value(4));
+
+        MixpanelAnalyticsMessage message(analyticsMap);
+        message.setStorageId(query.value(0).toLongLong());
+        messages.append(message);
+    }
+
+    return messages;
+}
+
+/// Deletes the expired messages and the oldest ones over the maximum size of the persisted queue.
+///
+/// \note Only the type, enqueued and id columns are read, the content of the messages is not loaded.
+///
+
+void MixpanelSqliteMessageStore::pruneStoredMessages()
+{
+    const qint64 eventExpiry = expiryTime(MixpanelAnalyticsMessage::Event);
+    const qint64 profileExpiry = expiryTime(MixpanelAnalyticsMessage::Profile);
+    if (eventExpiry == 0 && profileExpiry == 0 && m_maxMessages == 0)
+        return;
+
+    sync();
+    m_database.transaction();
+
+    QSqlQuery query(m_database);
+    if (m_maxMessages > 0)
+    {
+        query.prepare("DELETE FROM messages WHERE id <= (SELECT id FROM messages ORDER BY id DESC LIMIT 1 OFFSET ?)");
+        query.addBindValue(m_maxMessages);
+        if (query.exec())
+            m_trimmedMessages += qMax(0, query.numRowsAffected());
+    }
+
+    query.prepare("DELETE FROM messages WHERE type = ? AND enqueued < ?");
+    if (eventExpiry > 0)
+    {
+        query.addBindValue((int)MixpanelAnalyticsMessage::Event);
+        query.addBindValue(eventExpiry);
+        if (query.exec())
+            m_expiredMessages += qMax(0, query.numRowsAffected());
+    }
+    if (profileExpiry > 0)
+    {
+        query.addBindValue((int)MixpanelAnalyticsMessage::Profile);
+        query.addBindValue(profileExpiry);
+        if (query.exec())
+            m_expiredMessages += qMax(0, query.numRowsAffected());
+    }
+
+    if (!m_database.commit())
+        qWarning() << "Expired messages could not be deleted:" << m_database.lastError().text();
+}
+
+/// Opens the transaction of the appended messages, unless it is already open.
+
+void MixpanelSqliteMessageStore::beginTransaction()
+{
+    if (!m_inTransaction)
+        m_inTransaction = m_database.transaction();
+}
+
+/// Executes a statement without parameters.
+
+bool MixpanelSqliteMessageStore::execute(const QString& statement)
+{
+    QSqlQuery query(m_database);
+    if (!query.exec(statement))
+    {
+        qWarning() << "Message store statement failed:" << statement << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+/// Stores the string pool entries interned since the last call.
+
+void MixpanelSqliteMessageStore::saveStringPool()
+{
+    MixpanelStringPool& stringPool = MixpanelStringPool::instance();
+    if (stringPool.size() <= m_savedStringPoolEntries)
+        return;
+
+    const QVariantList entries = stringPool.dynamicEntries();
+    const int seedCount = stringPool.size() - entries.size();
+
+    QSqlQuery query(m_database);
+    query.prepare("INSERT OR REPLACE INTO string_pool (id, token) VALUES (?, ?)");
+    for (int i = qMax(0, m_savedStringPoolEntries - seedCount); i < entries.size(); ++i)
+    {
+        query.addBindValue(i);
+        query.addBindValue(entries.at(i));
+        query.exec();
+    }
+
+    m_savedStringPoolEntries = stringPool.size();
+}
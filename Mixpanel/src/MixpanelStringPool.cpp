@@ -0,0 +1,249 @@
+/*
+ * MixpanelStringPool.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelStringPool.hpp"
+
+#include "../include/MixpanelJsonWriter.hpp"
+
+#include <QMutexLocker>
+
+#include <string.h>
+
+/// Identifiers present in most analytic messages. Their ids are fixed, new seeds must be appended.
+static const char* const g_stringPoolSeeds[] =
+{
+    "event", "properties", "token", "distinct_id", "time",
+    "$token", "$distinct_id", "$time", "$set", "$set_once", "$add", "$delete",
+    "mp_lib", "blackberry", "$os", "BB10", "$os_version", "$app_version", "Device name", "$model", "PIN"
+};
+
+/// Expands the references of a compacted message using the given entries (index = id).
+
+static QByteArray expandWithEntries(const QByteArray& compactJson, const QList<QByteArray>& entries)
+{
+    const char* data = compactJson.constData();
+    const int size = compactJson.size();
+
+    const char* marker = static_cast<const char*>(memchr(data, MixpanelStringPool::ReferenceMarker, size));
+    if (!marker)
+        return compactJson;
+
+    QByteArray json;
+    json.reserve(size * 2);
+
+    int runStart = 0;
+    while (marker)
+    {
+        const int position = marker - data;
+        json.append(data + runStart, position - runStart);
+
+        if (position + 1 < size)
+        {
+            const quint8 id = static_cast<quint8>(data[position + 1]);
+            if (id < entries.size())
+                json.append(entries.at(id));
+        }
+
+        runStart = position + 2;
+        if (runStart >= size)
+            break;
+        marker = static_cast<const char*>(memchr(data + runStart, MixpanelStringPool::ReferenceMarker, size - runStart));
+    }
+
+    if (runStart < size)
+        json.append(data + runStart, size - runStart);
+
+    return json;
+}
+
+/// Returns the pool shared by the whole process.
+
+MixpanelStringPool& MixpanelStringPool::instance()
+{
+    static MixpanelStringPool pool;
+    return pool;
+}
+
+/// Creates a MixpanelStringPool object containing the seed identifiers.
+
+MixpanelStringPool::MixpanelStringPool()
+    : m_seedCount(0)
+{
+    m_entries.append(QByteArray());
+
+    const int seeds = sizeof(g_stringPoolSeeds) / sizeof(g_stringPoolSeeds[0]);
+    for (int i = 0; i < seeds; ++i)
+        intern(QString::fromUtf8(g_stringPoolSeeds[i]));
+
+    m_seedCount = m_entries.size();
+}
+
+/// Interns a string (e.g. an event name) so it is stored as a reference in the queued messages.
+///
+/// \note A string that is not valid Unicode is not interned, see MixpanelJsonWriter::appendString.
+///
+/// \param value String to intern
+///
+
+void MixpanelStringPool::intern(const QString& value)
+{
+    QByteArray token;
+    if (!MixpanelJsonWriter::appendString(token, value))
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (!lookup(token))
+        internToken(token);
+}
+
+/// Returns a compacted copy of a JSON message.
+///
+/// \note Whitespace between tokens is removed, and interned strings are replaced by references.
+///  Nothing is interned here: the other keys and event names, which may be unbounded (e.g. generated
+///  from user data), are written as they are instead of filling the pool for the whole process.
+///
+/// \param json A JSON analytic message
+/// \return the compacted message
+///
+
+QByteArray MixpanelStringPool::compact(const QByteArray& json)
+{
+    const char* data = json.constData();
+    const int size = json.size();
+
+    QByteArray compactJson;
+    compactJson.reserve(size);
+
+    QMutexLocker locker(&m_mutex);
+    int i = 0;
+    while (i < size)
+    {
+        const char c = data[i];
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+        {
+            ++i;
+            continue;
+        }
+
+        if (c != '"')
+        {
+            compactJson.append(c);
+            ++i;
+            continue;
+        }
+
+        int end = i + 1;
+        while (end < size && data[end] != '"')
+            end += (data[end] == '\\') ? 2 : 1;
+
+        const int tokenSize = qMin(end, size - 1) - i + 1;
+        const quint8 id = lookup(QByteArray::fromRawData(data + i, tokenSize));
+        if (id)
+        {
+            compactJson.append(char(ReferenceMarker));
+            compactJson.append(char(id));
+        } else {
+            compactJson.append(data + i, tokenSize);
+        }
+
+        i += tokenSize;
+    }
+
+    return compactJson;
+}
+
+/// Returns the JSON message of a compacted message.
+
+QByteArray MixpanelStringPool::expand(const QByteArray& compactJson) const
+{
+    QMutexLocker locker(&m_mutex);
+    return expandWithEntries(compactJson, m_entries);
+}
+
+/// Returns the number of interned strings.
+
+int MixpanelStringPool::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size() - 1;
+}
+
+/// Returns the strings interned at runtime, to be persisted with the compacted messages.
+
+QVariantList MixpanelStringPool::dynamicEntries() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVariantList entries;
+    for (int i = m_seedCount; i < m_entries.size(); ++i)
+        entries.append(m_entries.at(i));
+    return entries;
+}
+
+/// Restores the strings interned in a previous session.
+///
+/// \param entries Dynamic entries previously returned by dynamicEntries()
+/// \return False if the pool already interned different strings at the same ids. In that case
+///  the messages compacted with those entries must be expanded with expand(compactJson, entries).
+///
+
+bool MixpanelStringPool::adoptDynamicEntries(const QVariantList& entries)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < entries.size(); ++i)
+    {
+        const QByteArray token = entries.at(i).toByteArray();
+        const int id = m_seedCount + i;
+
+        if (id < m_entries.size())
+        {
+            if (m_entries.at(id) != token)
+                return false;
+        } else if (lookup(token) || internToken(token) != id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Expands a compacted message using the dynamic entries of another session.
+
+QByteArray MixpanelStringPool::expand(const QByteArray& compactJson, const QVariantList& dynamicEntries)
+{
+    const MixpanelStringPool& pool = instance();
+
+    pool.m_mutex.lock();
+    QList<QByteArray> entries = pool.m_entries.mid(0, pool.m_seedCount);
+    pool.m_mutex.unlock();
+    Q_FOREACH(QVariant entry, dynamicEntries)
+        entries.append(entry.toByteArray());
+
+    return expandWithEntries(compactJson, entries);
+}
+
+/// Returns the id of an interned JSON string token, 0 if not interned.
+
+quint8 MixpanelStringPool::lookup(const QByteArray& token) const
+{
+    return m_ids.value(token, 0);
+}
+
+/// Interns a JSON string token.
+///
+/// \return the id of the token, 0 if the pool is full or the token too long
+///
+
+quint8 MixpanelStringPool::internToken(const QByteArray& token)
+{
+    if (m_entries.size() > MaxEntries || token.size() > MaxStringSize + 2)
+        return 0;
+
+    const quint8 id = m_entries.size();
+    const QByteArray ownedToken(token.constData(), token.size());
+    m_entries.append(ownedToken);
+    m_ids.insert(ownedToken, id);
+    return id;
+}
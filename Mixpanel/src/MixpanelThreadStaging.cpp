@@ -0,0 +1,670 @@
+/*
+ * MixpanelThreadStaging.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelThreadStaging.hpp"
+
+#include "../include/MixpanelClock.hpp"
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelEvent.hpp"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadStorage>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+#include "qdebug.h"
+
+/// Number of merged chunks kept to be handed back to the threads
+static const int g_maxFreeStagingChunks = 16;
+
+/// Header of a staged message, followed by the message bytes and padded to 8 bytes.
+
+struct MixpanelStagedRecord
+{
+    qint64 stamp;
+    quint32 sequence;
+    qint32 size;
+    qint32 priority;
+    qint32 reserved;
+};
+
+/// A part of a chunk taken by a merge, from one thread.
+
+struct MixpanelStagedSpan
+{
+    const char* begin;
+    const char* end;
+    int context;
+};
+
+/// A staged message found by a merge, pointing into its chunk.
+
+struct MixpanelStagedMessage
+{
+    qint64 stamp;
+    int context;
+    quint32 sequence;
+    const char* data;
+    int size;
+    MixpanelAnalyticsMessage::Priority priority;
+};
+
+/// Returns whether a staged message was tracked before another one.
+
+static bool stagedBefore(const MixpanelStagedMessage& first, const MixpanelStagedMessage& second)
+{
+    if (first.stamp != second.stamp)
+        return first.stamp < second.stamp;
+    if (first.context != second.context)
+        return first.context < second.context;
+    return first.sequence < second.sequence;
+}
+
+/// A block of messages staged by one thread, written with a bump pointer.
+///
+/// \note The thread publishes every record it appends by storing the end of the used part in
+///  committed (release), so the owner can take the records of a chunk the thread still fills. The
+///  part already taken ends at collected, which is only read and written with the mutex locked.
+///
+
+class MixpanelStagingChunk
+{
+public:
+    explicit MixpanelStagingChunk(const int capacity);
+    ~MixpanelStagingChunk();
+
+    static int recordSpace(const int size);
+
+    bool fits(const int space) const;
+    void append(const qint64 stamp, const quint32 sequence, const MixpanelAnalyticsMessage::Priority priority, const char* content, const int size);
+    void clear();
+
+    char* buffer;
+    int capacity;
+    int used;
+    int records;
+    qint64 firstStamp;
+    int context;
+    QAtomicInt committed;
+    int collected;
+
+private:
+    Q_DISABLE_COPY(MixpanelStagingChunk)
+};
+
+/// State shared by a MixpanelThreadStaging object and the contexts of its threads.
+///
+/// \note The contexts keep it alive, so a thread finishing after the staging is destroyed does not
+///  touch freed memory. The mutex guards everything but the generation numbers, the admission and
+///  the counters of the events shed.
+///
+
+class MixpanelStagingState
+{
+public:
+    MixpanelStagingState();
+    ~MixpanelStagingState();
+
+    MixpanelStagingChunk* takeChunk(const int space);
+    void recycle(MixpanelStagingChunk* chunk);
+    void requestMerge();
+
+    QMutex mutex;
+    MixpanelThreadStaging* staging;
+    QList<MixpanelThreadContext*> contexts;
+    QList<MixpanelStagingChunk*> chunks;
+    QList<MixpanelStagingChunk*> freeChunks;
+    MixpanelPersistentIdentity identity;
+    MixpanelEventSampler sampler;
+    int deduplicationWindow;
+    int deduplicationWindowSize;
+    int lastContextId;
+    bool mergePending;
+    QAtomicInt generation;
+    QAtomicInt handOffGeneration;
+    QAtomicInt alive;
+    QAtomicInt admission;
+    QAtomicInt pressureSampleInterval;
+    QAtomicInt sampledEvents;
+    QAtomicInt rejectedEvents;
+    int id;
+};
+
+/// The contexts of a thread by staging id, deleted when the thread finishes.
+
+class MixpanelThreadContexts
+{
+public:
+    ~MixpanelThreadContexts();
+
+    QHash<int, MixpanelThreadContext*> contexts;
+};
+
+Q_GLOBAL_STATIC(QThreadStorage<MixpanelThreadContexts*>, threadContexts)
+
+/// Creates an empty chunk.
+
+MixpanelStagingChunk::MixpanelStagingChunk(const int capacity)
+    : buffer(new char[capacity])
+    , capacity(capacity)
+    , used(0)
+    , records(0)
+    , firstStamp(0)
+    , context(0)
+    , committed(0)
+    , collected(0)
+{
+}
+
+/// Destructor, frees the buffer.
+
+MixpanelStagingChunk::~MixpanelStagingChunk()
+{
+    delete[] buffer;
+}
+
+/// Returns the bytes taken in a chunk by a message of the given size.
+
+int MixpanelStagingChunk::recordSpace(const int size)
+{
+    return (int(sizeof(MixpanelStagedRecord)) + size + 7) & ~7;
+}
+
+/// Returns whether a record of the given space fits in the free part of the chunk.
+
+bool MixpanelStagingChunk::fits(const int space) const
+{
+    return used + space <= capacity;
+}
+
+/// Appends a message, the caller checks that it fits.
+
+void MixpanelStagingChunk::append(const qint64 stamp, const quint32 sequence, const MixpanelAnalyticsMessage::Priority priority, const char* content, const int size)
+{
+    MixpanelStagedRecord record;
+    record.stamp = stamp;
+    record.sequence = sequence;
+    record.size = size;
+    record.priority = priority;
+    record.reserved = 0;
+
+    char* out = buffer + used;
+    memcpy(out, &record, sizeof(record));
+    memcpy(out + sizeof(record), content, size);
+
+    if (records == 0)
+        firstStamp = stamp;
+
+    used += recordSpace(size);
+    records++;
+    committed.fetchAndStoreRelease(used);
+}
+
+/// Empties the chunk, keeping its buffer.
+
+void MixpanelStagingChunk::clear()
+{
+    used = 0;
+    records = 0;
+    firstStamp = 0;
+    context = 0;
+    committed.fetchAndStoreRelaxed(0);
+    collected = 0;
+}
+
+/// Creates the shared state of a staging.
+
+MixpanelStagingState::MixpanelStagingState()
+    : staging(NULL)
+    , deduplicationWindow(0)
+    , deduplicationWindowSize(0)
+    , lastContextId(0)
+    , mergePending(false)
+    , generation(0)
+    , handOffGeneration(0)
+    , alive(1)
+    , admission(MixpanelMessageQueue::Accepted)
+    , pressureSampleInterval(1)
+    , sampledEvents(0)
+    , rejectedEvents(0)
+    , id(0)
+{
+}
+
+/// Destructor, deletes the chunks left.
+
+MixpanelStagingState::~MixpanelStagingState()
+{
+    qDeleteAll(chunks);
+    qDeleteAll(freeChunks);
+}
+
+/// Returns an empty chunk with room for a record of the given space, a recycled one if possible.
+///
+/// \note The mutex must be locked.
+///
+
+MixpanelStagingChunk* MixpanelStagingState::takeChunk(const int space)
+{
+    if (space <= g_stagingChunkSize && !freeChunks.isEmpty())
+        return freeChunks.takeLast();
+
+    return new MixpanelStagingChunk(qMax(space, g_stagingChunkSize));
+}
+
+/// Keeps an empty chunk to be handed back to a thread, or deletes it if enough are kept.
+///
+/// \note The mutex must be locked.
+///
+
+void MixpanelStagingState::recycle(MixpanelStagingChunk* chunk)
+{
+    if (chunk->capacity == g_stagingChunkSize && freeChunks.size() < g_maxFreeStagingChunks)
+    {
+        chunk->clear();
+        freeChunks.append(chunk);
+    } else {
+        delete chunk;
+    }
+}
+
+/// Asks the thread of the staging to merge the chunks handed off, unless a merge is pending.
+///
+/// \note The mutex must be locked.
+///
+
+void MixpanelStagingState::requestMerge()
+{
+    if (!staging || mergePending)
+        return;
+
+    mergePending = true;
+    QMetaObject::invokeMethod(staging, "merge", Qt::QueuedConnection);
+}
+
+/// Destructor, deletes the contexts of the finishing thread.
+
+MixpanelThreadContexts::~MixpanelThreadContexts()
+{
+    qDeleteAll(contexts);
+}
+
+/// Creates the context of the calling thread and registers it in the shared state.
+
+MixpanelThreadContext::MixpanelThreadContext(const QSharedPointer<MixpanelStagingState>& state)
+    : QObject(0)
+    , m_state(state)
+    , m_event(new MixpanelEvent(this))
+    , m_chunk(NULL)
+    , m_id(0)
+    , m_sequence(0)
+    , m_generation(-1)
+    , m_handOffGeneration(0)
+    , m_deduplicationWindow(0)
+    , m_deduplicationWindowSize(0)
+    , m_admission(MixpanelMessageQueue::Accepted)
+{
+    m_event->setSink(this);
+
+    QMutexLocker locker(&m_state->mutex);
+    m_id = ++m_state->lastContextId;
+    m_handOffGeneration = m_state->handOffGeneration;
+    m_chunk = m_state->takeChunk(0);
+    m_state->contexts.append(this);
+}
+
+/// Destructor, hands the last chunk off to the staging.
+
+MixpanelThreadContext::~MixpanelThreadContext()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->contexts.removeOne(this);
+
+    if (m_chunk->records > 0)
+    {
+        m_chunk->context = m_id;
+        m_state->chunks.append(m_chunk);
+        m_state->requestMerge();
+    } else {
+        m_state->recycle(m_chunk);
+    }
+}
+
+/// Returns the event object of the thread, with the last published identity, sampling rules and deduplication window.
+
+MixpanelEvent& MixpanelThreadContext::event()
+{
+    if (m_state->generation == m_generation)
+        return *m_event;
+
+    QMutexLocker locker(&m_state->mutex);
+    m_event->persistentIdentity() = m_state->identity.snapshot();
+    m_event->sampler() = m_state->sampler;
+
+    if (m_deduplicationWindow != m_state->deduplicationWindow || m_deduplicationWindowSize != m_state->deduplicationWindowSize)
+    {
+        m_deduplicationWindow = m_state->deduplicationWindow;
+        m_deduplicationWindowSize = m_state->deduplicationWindowSize;
+        m_event->setDeduplicationWindow(m_deduplicationWindow, m_deduplicationWindowSize);
+    }
+
+    m_generation = m_state->generation;
+    return *m_event;
+}
+
+/// Hands the chunk off to the staging and takes an empty one.
+///
+/// \param space Room needed in the new chunk, for a message larger than g_stagingChunkSize
+///
+
+void MixpanelThreadContext::handOff(const int space)
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_handOffGeneration = m_state->handOffGeneration;
+
+    if (m_chunk->records > 0)
+    {
+        m_chunk->context = m_id;
+        m_state->chunks.append(m_chunk);
+        m_state->requestMerge();
+    } else if (m_chunk->capacity >= space) {
+        return;
+    } else {
+        m_state->recycle(m_chunk);
+    }
+
+    m_chunk = m_state->takeChunk(space);
+}
+
+/// Called when the event object of the thread records a message, it stages the message.
+
+void MixpanelThreadContext::recordEventMessage(const char* eventMessage, const int size, const MixpanelAnalyticsMessage::Priority priority)
+{
+    if (m_state->alive == 0)
+        return;
+
+    const qint64 stamp = MixpanelClock::nsecsElapsed();
+    const int space = MixpanelStagingChunk::recordSpace(size);
+    if (!m_chunk->fits(space))
+        handOff(space);
+
+    m_chunk->append(stamp, m_sequence++, priority, eventMessage, size);
+
+    if (priority == MixpanelAnalyticsMessage::HighPriority || m_state->handOffGeneration != m_handOffGeneration
+        || stamp - m_chunk->firstStamp >= qint64(g_stagingLatency) * 1000000)
+        handOff(0);
+}
+
+/// Returns whether an event of the thread should be tracked according to the published admission.
+///
+/// \note Under the SampleByEventName policy the thread keeps its own counters by event name, they are
+///  reset when the message queue admits every event again.
+///
+
+MixpanelMessageQueue::AdmissionStatus MixpanelThreadContext::admit(const QString& eventName)
+{
+    const int admission = m_state->admission;
+    if (admission != m_admission)
+    {
+        if (admission == MixpanelMessageQueue::Accepted)
+            m_pressureSampleCounters.clear();
+        m_admission = admission;
+    }
+
+    if (admission == MixpanelMessageQueue::Rejected)
+    {
+        m_state->rejectedEvents.ref();
+        return MixpanelMessageQueue::Rejected;
+    }
+
+    if (admission == MixpanelMessageQueue::Sampled)
+    {
+        int& counter = m_pressureSampleCounters[eventName];
+        if (counter++ % qMax(1, int(m_state->pressureSampleInterval)) != 0)
+        {
+            m_state->sampledEvents.ref();
+            return MixpanelMessageQueue::Sampled;
+        }
+    }
+
+    return MixpanelMessageQueue::Accepted;
+}
+
+/// Creates a MixpanelThreadStaging object.
+
+MixpanelThreadStaging::MixpanelThreadStaging(QObject* parent)
+    : QObject(parent)
+    , m_state(new MixpanelStagingState)
+    , m_mergedMessages(0)
+    , m_mergedChunks(0)
+{
+    static QAtomicInt nextId(1);
+
+    m_state->staging = this;
+    m_state->id = nextId.fetchAndAddRelaxed(1);
+}
+
+/// Destructor, the messages staged and not merged yet are discarded.
+
+MixpanelThreadStaging::~MixpanelThreadStaging()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->staging = NULL;
+    m_state->alive = 0;
+}
+
+/// Publishes the state read by the event objects of the threads.
+///
+/// \param identity The identity, the threads read a copy that is not persisted
+/// \param sampler The sampler, the threads read a copy of its rules that shares its rate limits
+/// \param deduplicationWindow Deduplication window, see MixpanelEvent::setDeduplicationWindow
+/// \param deduplicationWindowSize Maximum number of recent track calls remembered by every thread
+///
+
+void MixpanelThreadStaging::publish(const MixpanelPersistentIdentity& identity, const MixpanelEventSampler& sampler, const int deduplicationWindow, const int deduplicationWindowSize)
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->identity = identity.snapshot();
+    m_state->sampler = sampler;
+    m_state->deduplicationWindow = deduplicationWindow;
+    m_state->deduplicationWindowSize = deduplicationWindowSize;
+    m_state->generation.ref();
+}
+
+/// Returns the event object of the calling thread, it is created the first time.
+///
+/// \note It must not be called from the thread of the staging, whose messages would wait for a merge.
+///
+
+MixpanelEvent& MixpanelThreadStaging::event()
+{
+    return context().event();
+}
+
+/// Publishes the admission of the message queue, read by admit().
+///
+/// \param admission The status of the queue, see MixpanelMessageQueue::admission
+/// \param pressureSampleInterval One event out of pressureSampleInterval is kept by name when Sampled
+///
+
+void MixpanelThreadStaging::setAdmission(const MixpanelMessageQueue::AdmissionStatus admission, const int pressureSampleInterval)
+{
+    m_state->pressureSampleInterval.fetchAndStoreRelaxed(pressureSampleInterval);
+    m_state->admission.fetchAndStoreRelease(admission);
+}
+
+/// Returns whether an event tracked by the calling thread should be encoded, see MixpanelMessageQueue::admit.
+///
+/// \note The events shed are counted by sampledEvents() and rejectedEvents(), not by the message queue.
+///
+
+MixpanelMessageQueue::AdmissionStatus MixpanelThreadStaging::admit(const QString& eventName)
+{
+    return context().admit(eventName);
+}
+
+/// Returns the context of the calling thread, it is created the first time.
+
+MixpanelThreadContext& MixpanelThreadStaging::context()
+{
+    QThreadStorage<MixpanelThreadContexts*>* storage = threadContexts();
+    if (!storage->hasLocalData())
+        storage->setLocalData(new MixpanelThreadContexts);
+
+    MixpanelThreadContext*& context = storage->localData()->contexts[m_state->id];
+    if (!context)
+        context = new MixpanelThreadContext(m_state);
+
+    return *context;
+}
+
+/// Asks the threads to hand their chunk off the next time they track an event.
+///
+/// \note A thread that does not track again keeps its chunk, use collect() to take its messages.
+///
+
+void MixpanelThreadStaging::requestHandOff()
+{
+    m_state->handOffGeneration.ref();
+}
+
+/// Returns the number of threads that have tracked events and have not finished.
+
+int MixpanelThreadStaging::threads() const
+{
+    QMutexLocker locker(&m_state->mutex);
+    return m_state->contexts.size();
+}
+
+/// Returns the number of messages merged since the staging was created.
+
+qint64 MixpanelThreadStaging::mergedMessages() const
+{
+    return m_mergedMessages;
+}
+
+/// Returns the number of chunks merged since the staging was created.
+
+qint64 MixpanelThreadStaging::mergedChunks() const
+{
+    return m_mergedChunks;
+}
+
+/// Returns the number of events of the threads sampled out by admit() while the queue was under pressure.
+
+qint64 MixpanelThreadStaging::sampledEvents() const
+{
+    return int(m_state->sampledEvents);
+}
+
+/// Returns the number of events of the threads rejected by admit() while the queue was over budget.
+
+qint64 MixpanelThreadStaging::rejectedEvents() const
+{
+    return int(m_state->rejectedEvents);
+}
+
+/// Takes the chunks handed off by the threads and emits their messages with recordEventMessage(),
+/// in the order they were tracked.
+///
+/// \note The chunks are handed back to the threads once their messages have been emitted.
+///
+
+void MixpanelThreadStaging::merge()
+{
+    mergeChunks(false);
+}
+
+/// Merges the chunks handed off and the messages published in the chunks the threads still fill,
+/// e.g. before a flush or a shutdown.
+///
+/// \note The messages of a thread that has stopped tracking are merged too, without waiting for the
+///  thread to hand its chunk off.
+///
+
+void MixpanelThreadStaging::collect()
+{
+    mergeChunks(true);
+}
+
+/// Merges the messages of the chunks handed off, and of the chunks of the threads if collectActive is set.
+
+void MixpanelThreadStaging::mergeChunks(const bool collectActive)
+{
+    QList<MixpanelStagingChunk*> chunks;
+    QVector<MixpanelStagedSpan> spans;
+    {
+        QMutexLocker locker(&m_state->mutex);
+        chunks = m_state->chunks;
+        m_state->chunks.clear();
+        m_state->mergePending = false;
+
+        Q_FOREACH(MixpanelStagingChunk* chunk, chunks)
+        {
+            MixpanelStagedSpan span = { chunk->buffer + chunk->collected, chunk->buffer + chunk->used, chunk->context };
+            spans.append(span);
+            chunk->collected = chunk->used;
+        }
+
+        if (collectActive)
+        {
+            Q_FOREACH(MixpanelThreadContext* context, m_state->contexts)
+            {
+                MixpanelStagingChunk* chunk = context->m_chunk;
+                const int committed = chunk->committed.fetchAndAddAcquire(0);
+                if (committed == chunk->collected)
+                    continue;
+
+                MixpanelStagedSpan span = { chunk->buffer + chunk->collected, chunk->buffer + committed, context->m_id };
+                spans.append(span);
+                chunk->collected = committed;
+            }
+        }
+    }
+
+    QVector<MixpanelStagedMessage> messages;
+    Q_FOREACH(const MixpanelStagedSpan& span, spans)
+    {
+        for (const char* record = span.begin; record < span.end; )
+        {
+            MixpanelStagedRecord header;
+            memcpy(&header, record, sizeof(header));
+
+            MixpanelStagedMessage message;
+            message.stamp = header.stamp;
+            message.context = span.context;
+            message.sequence = header.sequence;
+            message.data = record + sizeof(header);
+            message.size = header.size;
+            message.priority = MixpanelAnalyticsMessage::Priority(header.priority);
+            messages.append(message);
+
+            record += MixpanelStagingChunk::recordSpace(header.size);
+        }
+    }
+
+    qSort(messages.begin(), messages.end(), stagedBefore);
+
+    m_mergedMessages += messages.size();
+    m_mergedChunks += chunks.size();
+
+    for (int i = 0; i < messages.size(); ++i)
+        emit recordEventMessage(QByteArray(messages.at(i).data, messages.at(i).size), messages.at(i).priority);
+
+    if (chunks.isEmpty())
+        return;
+
+    QMutexLocker locker(&m_state->mutex);
+    Q_FOREACH(MixpanelStagingChunk* chunk, chunks)
+        m_state->recycle(chunk);
+}
@@ -0,0 +1,54 @@
+/*
+ * MixpanelTransport.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelTransport.hpp"
+
+#include "../include/MixpanelFileTransport.hpp"
+#include "../include/MixpanelHttpTransport.hpp"
+#include "../include/MixpanelMemoryTransport.hpp"
+
+/// Creates a MixpanelTransport object.
+
+MixpanelTransport::MixpanelTransport(QObject* parent)
+    : QObject(parent)
+{
+}
+
+/// Destructor, destroys the MixpanelTransport object.
+
+MixpanelTransport::~MixpanelTransport()
+{
+}
+
+/// Creates the transport of the given configuration.
+///
+/// \param config The configuration, see MixpanelConfiguration::transport
+/// \param parent Parent of the new transport
+/// \return a new transport
+///
+
+MixpanelTransport* MixpanelTransport::create(const MixpanelConfiguration& config, QObject* parent)
+{
+    MixpanelTransport* transport = NULL;
+
+    if (config.transport() == MixpanelConfiguration::MemoryTransport)
+        transport = new MixpanelMemoryTransport(parent);
+    else if (config.transport() == MixpanelConfiguration::FileTransport)
+        transport = new MixpanelFileTransport(config.transportFilePath(), parent);
+    else
+        transport = new MixpanelHttpTransport(parent);
+
+    transport->setConfiguration(config);
+    return transport;
+}
+
+/// Applies the configuration of the message queue, by default it is ignored.
+
+void MixpanelTransport::setConfiguration(const MixpanelConfiguration& config)
+{
+    Q_UNUSED(config);
+}
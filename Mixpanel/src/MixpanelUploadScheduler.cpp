@@ -0,0 +1,225 @@
+/*
+ * MixpanelUploadScheduler.cpp
+ *
+ *  Created on: 19 Oct 2026
+ *      Author: JAragon
+ */
+
+#include "../include/MixpanelUploadScheduler.hpp"
+
+#include "../include/MixpanelConstants.hpp"
+#include "../include/MixpanelHttpTransport.hpp"
+
+#include <QCoreApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include "qdebug.h"
+
+/// The scheduler of the process, created by MixpanelUploadScheduler::instance
+static MixpanelUploadScheduler* g_uploadScheduler = NULL;
+
+/// Deletes the scheduler of the process, called by the destructor of the application.
+
+static void destroyUploadScheduler()
+{
+    MixpanelUploadScheduler* scheduler = g_uploadScheduler;
+    g_uploadScheduler = NULL;
+    delete scheduler;
+}
+
+/// Returns the scheduler shared by the whole process.
+///
+/// \note It has no parent, it is deleted by a post routine (qAddPostRoutine) while the application is
+///  destroyed, so its network access manager is torn down with the application and its event loop still
+///  around. See exists() for the transports destroyed later.
+///
+
+MixpanelUploadScheduler& MixpanelUploadScheduler::instance()
+{
+    if (!g_uploadScheduler)
+    {
+        g_uploadScheduler = new MixpanelUploadScheduler;
+        qAddPostRoutine(destroyUploadScheduler);
+    }
+    return *g_uploadScheduler;
+}
+
+/// Returns whether the scheduler of the process can be used, false before it is created and once the
+/// application has destroyed it.
+
+bool MixpanelUploadScheduler::exists()
+{
+    return g_uploadScheduler != NULL;
+}
+
+/// Creates a MixpanelUploadScheduler object.
+
+MixpanelUploadScheduler::MixpanelUploadScheduler(QObject* parent)
+    : QObject(parent)
+    , m_networkAccessManager(new QNetworkAccessManager(this))
+    , m_maxRequests(g_maxSharedRequests)
+    , m_nextTransport(0)
+{
+    bool connectResult = false;
+    Q_UNUSED(connectResult);
+
+    connectResult = connect(m_networkAccessManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkRequestFinished(QNetworkReply*)));
+    Q_ASSERT(connectResult);
+}
+
+/// Returns the network access manager shared by the Mixpanel requests.
+
+QNetworkAccessManager* MixpanelUploadScheduler::networkAccessManager() const
+{
+    return m_networkAccessManager;
+}
+
+/// Sets the number of requests in flight at once, by default g_maxSharedRequests.
+
+void MixpanelUploadScheduler::setMaxRequests(const int maxRequests)
+{
+    if (maxRequests <= 0)
+        return;
+
+    m_maxRequests = maxRequests;
+    postWaitingRequests();
+}
+
+/// Returns the number of requests in flight at once.
+
+int MixpanelUploadScheduler::maxRequests() const
+{
+    return m_maxRequests;
+}
+
+/// Posts a request, right away if the budget allows it or when it is the turn of the transport.
+///
+/// \note The transport is notified with MixpanelHttpTransport::requestStarted when the request is posted,
+///  and with MixpanelHttpTransport::requestFinished when its reply finishes.
+///
+/// \param transport The transport posting the request
+/// \param requestId Identifier of the request for the transport
+/// \param request The request
+/// \param data The body of the request
+///
+
+void MixpanelUploadScheduler::post(MixpanelHttpTransport* transport, const int requestId, const QNetworkRequest& request, const QByteArray& data)
+{
+    WaitingRequest waitingRequest;
+    waitingRequest.requestId = requestId;
+    waitingRequest.request = request;
+    waitingRequest.data = data;
+
+    QList<WaitingRequest>& transportRequests = m_waitingRequests[transport];
+    if (transportRequests.isEmpty())
+        m_waitingTransports.append(transport);
+    transportRequests.append(waitingRequest);
+
+    postWaitingRequests();
+}
+
+/// Removes a request that is still waiting.
+///
+/// \return False if the request is not waiting, it may be in flight
+///
+
+bool MixpanelUploadScheduler::cancel(MixpanelHttpTransport* transport, const int requestId)
+{
+    QHash<MixpanelHttpTransport*, QList<WaitingRequest> >::iterator it = m_waitingRequests.find(transport);
+    if (it == m_waitingRequests.end())
+        return false;
+
+    for (int i = 0; i < it.value().size(); ++i)
+    {
+        if (it.value().at(i).requestId != requestId)
+            continue;
+
+        it.value().removeAt(i);
+        if (it.value().isEmpty())
+        {
+            m_waitingRequests.erase(it);
+            m_waitingTransports.removeOne(transport);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/// Removes the waiting requests of a transport and stops notifying it, to be called when it is destroyed.
+///
+/// \note Its requests in flight still count in the budget until they finish.
+///
+
+void MixpanelUploadScheduler::removeTransport(MixpanelHttpTransport* transport)
+{
+    m_waitingRequests.remove(transport);
+    m_waitingTransports.removeOne(transport);
+
+    for (QHash<QNetworkReply*, MixpanelHttpTransport*>::iterator it = m_inFlightRequests.begin(); it != m_inFlightRequests.end(); ++it)
+    {
+        if (it.value() == transport)
+            it.value() = NULL;
+    }
+}
+
+/// Returns the number of requests waiting for the budget.
+
+int MixpanelUploadScheduler::waitingRequests() const
+{
+    int requests = 0;
+    Q_FOREACH(MixpanelHttpTransport* transport, m_waitingTransports)
+        requests += m_waitingRequests.value(transport).size();
+    return requests;
+}
+
+/// Returns the number of requests in flight.
+
+int MixpanelUploadScheduler::inFlightRequests() const
+{
+    return m_inFlightRequests.size();
+}
+
+/// Posts the waiting requests while the budget allows it, one per transport in turns.
+
+void MixpanelUploadScheduler::postWaitingRequests()
+{
+    while (m_inFlightRequests.size() < m_maxRequests && !m_waitingTransports.isEmpty())
+    {
+        if (m_nextTransport >= m_waitingTransports.size())
+            m_nextTransport = 0;
+
+        MixpanelHttpTransport* transport = m_waitingTransports.at(m_nextTransport);
+        QList<WaitingRequest>& transportRequests = m_waitingRequests[transport];
+        const WaitingRequest waitingRequest = transportRequests.takeFirst();
+
+        if (transportRequests.isEmpty())
+        {
+            m_waitingRequests.remove(transport);
+            m_waitingTransports.removeAt(m_nextTransport);
+        } else {
+            m_nextTransport++;
+        }
+
+        QNetworkReply* reply = m_networkAccessManager->post(waitingRequest.request, waitingRequest.data);
+        m_inFlightRequests.insert(reply, transport);
+        transport->requestStarted(waitingRequest.requestId, reply);
+    }
+}
+
+/// Slot called when a request finishes, it notifies its transport and posts the next waiting requests.
+
+void MixpanelUploadScheduler::networkRequestFinished(QNetworkReply* reply)
+{
+    if (!m_inFlightRequests.contains(reply))
+        return;
+
+    MixpanelHttpTransport* transport = m_inFlightRequests.take(reply);
+    if (transport)
+        transport->requestFinished(reply);
+    else
+        reply->deleteLater();
+
+    postWaitingRequests();
+}
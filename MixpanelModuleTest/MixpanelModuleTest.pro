@@ -6,7 +6,7 @@ CONFIG += precompile_header
 
 PRECOMPILED_HEADER = $$quote($$BASEDIR/precompiled.h)
 
-QT += testlib network
+QT += testlib network sql
 LIBS += -lbbdata -lbbdevice -lbb -lbbplatform
 
 INCLUDEPATH += ../src ../../Mixpanel/include  
@@ -10,7 +10,32 @@
 #include "MixpanelEvent.hpp"
 #include "MixpanelPersistentIdentity.hpp"
 #include "MixpanelConfiguration.hpp"
+#include "MixpanelConstants.hpp"
 #include "MixpanelMessageQueue.hpp"
+#include "MixpanelEventBuilder.hpp"
+#include "MixpanelEventSchema.hpp"
+#include "MixpanelStringPool.hpp"
+#include "MixpanelSettingsMessageStore.hpp"
+#include "MixpanelSqliteMessageStore.hpp"
+#include "MixpanelEventSampler.hpp"
+#include "MixpanelLatencyHistogram.hpp"
+#include "MixpanelMemoryTransport.hpp"
+#include "MixpanelBatchController.hpp"
+#include "MixpanelImporter.hpp"
+#include "MixpanelImportSource.hpp"
+#include "MixpanelHttpTransport.hpp"
+#include "MixpanelEventTimers.hpp"
+#include "MixpanelClock.hpp"
+#include "MixpanelProfileCache.hpp"
+#include "MixpanelSettings.hpp"
+#include "MixpanelUploadScheduler.hpp"
+#include "MixpanelThreadStaging.hpp"
+#include "MixpanelMessageRing.hpp"
+#include "MixpanelJsonWriter.hpp"
+
+#include <dlfcn.h>
+#include <limits>
+#include <string.h>
 
 using namespace bb::data;
 
@@ -19,6 +44,160 @@ static MixpanelEvent* mixEvent = new MixpanelEvent(NULL);
 static MixpanelPersistentIdentity persistentIdentity;
 static MixpanelConfiguration mixpanelConfig;
 
+static const int g_benchmarkQueueSize = 100000;
+
+MIXPANEL_EVENT_SCHEMA_3(LevelCompleteEvent, "Level Complete",
+                        int, "Level Number",
+                        QString, "Difficulty",
+                        double, "Score \"ratio\"")
+
+MIXPANEL_EVENT_SCHEMA_8(SessionSummaryEvent, "Session Summary",
+                        int, "Levels", int, "Deaths", int, "Coins", int, "Gems",
+                        qint64, "Duration", double, "Accuracy", bool, "Completed", QString, "Mode")
+
+/// Tracks events from its own thread through a MixpanelThreadStaging.
+
+class MixpanelTrackingThread : public QThread
+{
+public:
+    MixpanelTrackingThread(MixpanelThreadStaging& staging, const int thread, const int events)
+        : m_staging(staging)
+        , m_thread(thread)
+        , m_events(events)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        for (int i = 0; i < m_events; ++i)
+        {
+            QVariantMap properties;
+            properties.insert("Thread", m_thread);
+            properties.insert("Index", i);
+            properties.insert("Duration", i * 0.25);
+            m_staging.event().track("Thread event", properties);
+        }
+    }
+
+private:
+    MixpanelThreadStaging& m_staging;
+    int m_thread;
+    int m_events;
+};
+
+/// Tracks an event, stays idle until it is released and tracks a second event.
+
+class MixpanelIdleTrackingThread : public QThread
+{
+public:
+    MixpanelIdleTrackingThread(MixpanelThreadStaging& staging, QSemaphore& tracked, QSemaphore& released)
+        : m_staging(staging)
+        , m_tracked(tracked)
+        , m_released(released)
+    {
+    }
+
+protected:
+    virtual void run()
+    {
+        m_staging.event().track("Before idle", QVariantMap());
+        m_tracked.release();
+        m_released.acquire();
+        m_staging.event().track("After idle", QVariantMap());
+    }
+
+private:
+    MixpanelThreadStaging& m_staging;
+    QSemaphore& m_tracked;
+    QSemaphore& m_released;
+};
+
+/// Tracks events from several threads at once and waits for them to finish.
+
+static void trackFromThreads(MixpanelThreadStaging& staging, const int threads, const int events)
+{
+    QList<MixpanelTrackingThread*> trackingThreads;
+    for (int i = 0; i < threads; ++i)
+        trackingThreads.append(new MixpanelTrackingThread(staging, i, events));
+
+    Q_FOREACH(MixpanelTrackingThread* thread, trackingThreads)
+        thread->start();
+
+    Q_FOREACH(MixpanelTrackingThread* thread, trackingThreads)
+        thread->wait();
+
+    qDeleteAll(trackingThreads);
+}
+
+/// Number of calls to malloc and realloc while g_countAllocations is set
+static QAtomicInt g_allocations(0);
+static volatile bool g_countAllocations = false;
+
+/// Counts the calls to malloc, including the ones of Qt and operator new, before calling the C library.
+
+extern "C" void* malloc(size_t size)
+{
+    typedef void* (*MallocFunction)(size_t);
+    static MallocFunction libraryMalloc = NULL;
+    if (!libraryMalloc)
+        libraryMalloc = reinterpret_cast<MallocFunction>(dlsym(RTLD_NEXT, "malloc"));
+
+    if (g_countAllocations)
+        g_allocations.ref();
+    return libraryMalloc(size);
+}
+
+/// Counts the calls to realloc before calling the C library.
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    typedef void* (*ReallocFunction)(void*, size_t);
+    static ReallocFunction libraryRealloc = NULL;
+    if (!libraryRealloc)
+        libraryRealloc = reinterpret_cast<ReallocFunction>(dlsym(RTLD_NEXT, "realloc"));
+
+    if (g_countAllocations)
+        g_allocations.ref();
+    return libraryRealloc(pointer, size);
+}
+
+/// Copies the messages of a MixpanelEvent one after the other into a preallocated slab.
+
+class MixpanelSlabSink : public MixpanelEventSink
+{
+public:
+    explicit MixpanelSlabSink(const int capacity)
+        : m_slab(capacity, '\0')
+        , m_used(0)
+        , m_lastSize(0)
+        , m_messages(0)
+    {
+    }
+
+    virtual void recordEventMessage(const char* eventMessage, const int size, const MixpanelAnalyticsMessage::Priority priority)
+    {
+        Q_UNUSED(priority);
+
+        if (m_used + size > m_slab.size())
+            m_used = 0;
+
+        memcpy(m_slab.data() + m_used, eventMessage, size);
+        m_used += size;
+        m_lastSize = size;
+        m_messages++;
+    }
+
+    QByteArray lastMessage() const { return m_slab.mid(m_used - m_lastSize, m_lastSize); }
+    int messages() const { return m_messages; }
+
+private:
+    QByteArray m_slab;
+    int m_used;
+    int m_lastSize;
+    int m_messages;
+};
+
 
 
 void MixpanelModuleTest::testPersistentProperties()
@@ -212,9 +391,1191 @@ void MixpanelModuleTest::testMixpanelConfiguration()
     QCOMPARE(mixpanelConfig.messatesToFlush(), 20);
 }
 
+void MixpanelModuleTest::testTrackEventBuilder()
+{
+    MixpanelEventBuilder builder("Frame rendered");
+    builder.add("fps", 59.5).add("dropped", 2).add("vsync", true).add("scene", "Main \"menu\"").add("token", "ignored");
 
+    QByteArray messageJson = mixEvent->stdTrackEvent(builder);
 
+    JsonDataAccess dataAccess;
+    QVariantMap jsonData = dataAccess.loadFromBuffer(messageJson).toMap();
+    QVariantMap properties = jsonData["properties"].toMap();
+
+    QCOMPARE(dataAccess.hasError(), false);
+    QCOMPARE(jsonData.value("event").toString(), QString("Frame rendered"));
+    QCOMPARE(properties.value("fps").toDouble(), 59.5);
+    QCOMPARE(properties.value("dropped").toInt(), 2);
+    QCOMPARE(properties.value("vsync").toBool(), true);
+    QCOMPARE(properties.value("scene").toString(), QString("Main \"menu\""));
+    QCOMPARE(properties.value("distinct_id").toString(), QString("13793"));
+    QCOMPARE(properties.value("token").toString(), QString("36ada5b10da39a1347559321baf13063"));
+    QCOMPARE(properties.value("mp_lib").toString(), QString("blackberry"));
+}
 
+void MixpanelModuleTest::testTrackEventSchema()
+{
+    QByteArray messageJson = mixEvent->stdTrackEvent(LevelCompleteEvent::build(9, "Hard", 0.25));
+
+    JsonDataAccess dataAccess;
+    QVariantMap jsonData = dataAccess.loadFromBuffer(messageJson).toMap();
+    QVariantMap properties = jsonData["properties"].toMap();
 
+    QCOMPARE(jsonData.value("event").toString(), QString("Level Complete"));
+    QCOMPARE(properties.value("Level Number").toInt(), 9);
+    QCOMPARE(properties.value("Difficulty").toString(), QString("Hard"));
+    QCOMPARE(properties.value("Score \"ratio\"").toDouble(), 0.25);
+    QCOMPARE(properties.value("token").toString(), QString("36ada5b10da39a1347559321baf13063"));
+
+    messageJson = mixEvent->stdTrackEvent(SessionSummaryEvent::build(4, 1, 250, 3, 600000, 0.5, true, "Arcade"));
+    properties = dataAccess.loadFromBuffer(messageJson).toMap().value("properties").toMap();
+    QCOMPARE(properties.value("Levels").toInt(), 4);
+    QCOMPARE(properties.value("Mode").toString(), QString("Arcade"));
+}
 
+void MixpanelModuleTest::testStringPool()
+{
+    QVariantMap eventProperties;
+    eventProperties.insert("Level Number", QVariant(9));
+    eventProperties.insert("Player", "$os \"token\"");
+
+    QByteArray messageJson = mixEvent->stdTrackEvent("Level Complete", eventProperties);
+    QByteArray compactJson = MixpanelStringPool::instance().compact(messageJson);
+
+    QVERIFY(compactJson.size() < messageJson.size());
+    QVERIFY(!compactJson.contains("distinct_id"));
+
+    JsonDataAccess dataAccess;
+    QVariantMap expected = dataAccess.loadFromBuffer(messageJson).toMap();
+    QVariantMap actual = dataAccess.loadFromBuffer(MixpanelStringPool::instance().expand(compactJson)).toMap();
+
+    QCOMPARE(actual, expected);
+    QCOMPARE(actual["properties"].toMap().value("Player").toString(), QString("$os \"token\""));
+
+    const int internedStrings = MixpanelStringPool::instance().size();
+    eventProperties.insert("Generated key 13793", QVariant(1));
+    MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent("Generated event 13793", eventProperties));
+    QCOMPARE(MixpanelStringPool::instance().size(), internedStrings);
+
+    MixpanelPersistentIdentity identity = persistentIdentity.snapshot();
+    QVariantMap superProperties;
+    superProperties.insert("Pooled super property", QVariant(true));
+    identity.registerSuperProperties(superProperties);
+    QCOMPARE(MixpanelStringPool::instance().size(), internedStrings + 1);
+}
+
+static QString sqliteTestDatabase()
+{
+    QString path = QDir::tempPath() + "/mixpanel_test_queue.db";
+    QFile::remove(path);
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+    return path;
+}
 
+static QList<MixpanelAnalyticsMessage> benchmarkMessages()
+{
+    QList<MixpanelAnalyticsMessage> messages;
+    QByteArray content = MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent("Benchmark", QVariantMap()));
+
+    for (int i = 0; i < g_benchmarkQueueSize; ++i)
+        messages.append(MixpanelAnalyticsMessage(MixpanelAnalyticsMessage::Event, content));
+
+    return messages;
+}
+
+static QVariantMap numericProperties()
+{
+    QVariantMap properties;
+    for (int i = 0; i < 50; ++i)
+    {
+        properties.insert(QString("Price %1").arg(i), 19.99 + i * 0.37);
+        properties.insert(QString("Ratio %1").arg(i), 1.0 / (i + 3));
+        properties.insert(QString("Count %1").arg(i), Q_INT64_C(1400000000000) + i * 7919);
+    }
+
+    return properties;
+}
+
+void MixpanelModuleTest::testSqliteMessageStore()
+{
+    QString path = sqliteTestDatabase();
+    QByteArray content = MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent("Stored", QVariantMap()));
+
+    QList<MixpanelAnalyticsMessage> messages;
+    {
+        MixpanelSqliteMessageStore store(path);
+        for (int i = 0; i < 5; ++i)
+        {
+            MixpanelAnalyticsMessage message(MixpanelAnalyticsMessage::Event, content);
+            store.append(message);
+            QVERIFY(message.storageId() >= 0);
+            messages.append(message);
+        }
+        QVERIFY(store.isDirty());
+        store.sync();
+        QVERIFY(!store.isDirty());
+        store.remove(messages.mid(0, 2));
+
+        MixpanelAnalyticsMessage unsynced(MixpanelAnalyticsMessage::Event, content);
+        store.append(unsynced);
+        QVERIFY(store.isDirty());
+    }
+
+    MixpanelSqliteMessageStore store(path);
+    QList<MixpanelAnalyticsMessage> restored = store.restore();
+
+    QCOMPARE(restored.size(), 4);
+    QCOMPARE(restored.first().storageId(), messages.at(2).storageId());
+    QCOMPARE(restored.first().content(), content);
+    QCOMPARE(store.load(messages.at(3).storageId(), 10).size(), 1);
+}
+
+void MixpanelModuleTest::testEventSampler()
+{
+    MixpanelEventSampler sampler;
+    double sampleRate = 0.0;
+
+    QVERIFY(sampler.accept("Unsampled", "13793", sampleRate));
+    QCOMPARE(sampleRate, 1.0);
+
+    sampler.setSampleRate("Sampled", 0.25);
+    int accepted = 0;
+    for (int i = 0; i < 4000; ++i)
+    {
+        const QString distinctId = QString::number(i);
+        const bool first = sampler.accept("Sampled", distinctId, sampleRate);
+        QCOMPARE(sampler.accept("Sampled", distinctId, sampleRate), first);
+        if (first)
+        {
+            QCOMPARE(sampleRate, 0.25);
+            accepted++;
+        }
+    }
+    QVERIFY(accepted > 800 && accepted < 1200);
+
+    sampler.setRateLimit("Limited", 0.001, 3);
+    QVERIFY(sampler.accept("Limited", "13793", sampleRate));
+    QVERIFY(sampler.accept("Limited", "13793", sampleRate));
+    QVERIFY(sampler.accept("Limited", "13793", sampleRate));
+    QVERIFY(!sampler.accept("Limited", "13793", sampleRate));
+    QCOMPARE(sampler.rateLimitedEvents(), qint64(1));
+
+    sampler.setRateLimit("Shared", 0.001, 2);
+    MixpanelEventSampler threadSampler = sampler;
+    QVERIFY(sampler.accept("Shared", "13793", sampleRate));
+    QVERIFY(threadSampler.accept("Shared", "13793", sampleRate));
+    QVERIFY(!threadSampler.accept("Shared", "13793", sampleRate));
+    QVERIFY(!sampler.accept("Shared", "13793", sampleRate));
+}
+
+void MixpanelModuleTest::testInsertIdDeduplication()
+{
+    JsonDataAccess dataAccess;
+    QVariantMap first = dataAccess.loadFromBuffer(mixEvent->stdTrackEvent("Signed Up", QVariantMap())).toMap();
+    QVariantMap second = dataAccess.loadFromBuffer(mixEvent->stdTrackEvent(MixpanelEventBuilder("Signed Up"))).toMap();
+
+    QString firstInsertId = first["properties"].toMap().value("$insert_id").toString();
+    QVERIFY(!firstInsertId.isEmpty());
+    QVERIFY(firstInsertId != second["properties"].toMap().value("$insert_id").toString());
+
+    MixpanelEvent event(NULL);
+    event.persistentIdentity() = persistentIdentity;
+    event.setDeduplicationWindow(60000, 16);
+    QSignalSpy recorded(&event, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+
+    QVariantMap properties;
+    properties.insert("Button", "Buy");
+    event.track("Clicked", properties);
+    event.track("Clicked", properties);
+    properties.insert("Button", "Cancel");
+    event.track("Clicked", properties);
+
+    QCOMPARE(recorded.count(), 2);
+    QCOMPARE(event.duplicateEvents(), qint64(1));
+
+    event.track("Event 63208", QVariantMap());
+    event.track("Event 900284", QVariantMap());
+    QCOMPARE(recorded.count(), 4);
+    QCOMPARE(event.duplicateEvents(), qint64(1));
+
+    event.setDeduplicationWindow(60000, 0);
+    event.track("Clicked", properties);
+    event.track("Clicked", properties);
+    QCOMPARE(recorded.count(), 6);
+}
+
+void MixpanelModuleTest::testMessagePriority()
+{
+    QByteArray content = MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent("Purchase", QVariantMap()));
+    MixpanelAnalyticsMessage message(MixpanelAnalyticsMessage::Event, content, MixpanelAnalyticsMessage::HighPriority);
+
+    QCOMPARE(MixpanelAnalyticsMessage(message.toStorageMap()).priority(), MixpanelAnalyticsMessage::HighPriority);
+    QCOMPARE(MixpanelAnalyticsMessage(MixpanelAnalyticsMessage::Event, content).priority(), MixpanelAnalyticsMessage::NormalPriority);
+
+    MixpanelSqliteMessageStore store(sqliteTestDatabase());
+    store.append(message);
+
+    QList<MixpanelAnalyticsMessage> restored = store.restore();
+    QCOMPARE(restored.size(), 1);
+    QCOMPARE(restored.first().priority(), MixpanelAnalyticsMessage::HighPriority);
+}
+
+void MixpanelModuleTest::testLatencyHistogram()
+{
+    MixpanelLatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(0.5), qint64(0));
+
+    for (int i = 1; i <= 100; ++i)
+        histogram.record(i);
+    histogram.record(-5);
+
+    QCOMPARE(histogram.count(), qint64(101));
+    QCOMPARE(histogram.min(), qint64(0));
+    QCOMPARE(histogram.max(), qint64(100));
+    QVERIFY(histogram.percentile(0.5) >= 50 && histogram.percentile(0.5) < 64);
+    QCOMPARE(histogram.percentile(0.99), qint64(100));
+
+    QVariantMap histogramMap = histogram.toVariantMap();
+    QCOMPARE(histogramMap.value("count").toLongLong(), qint64(101));
+    QCOMPARE(histogramMap.value("buckets").toList().size(), int(MixpanelLatencyHistogram::BucketCount));
+}
+
+void MixpanelModuleTest::testMemoryTransport()
+{
+    MixpanelConfiguration config = mixpanelConfig;
+    config.setFlushMechanism(MixpanelConfiguration::Manual);
+    config.setTransport(MixpanelConfiguration::MemoryTransport);
+
+    MixpanelMessageQueue queue(NULL, config);
+    QVERIFY(queue.transport().type() == MixpanelConfiguration::MemoryTransport);
+
+    MixpanelMemoryTransport* transport = new MixpanelMemoryTransport;
+    transport->setResult(MixpanelTransport::Failed);
+    queue.setTransport(transport);
+    QCOMPARE(&queue.transport(), static_cast<MixpanelTransport*>(transport));
+
+    const int restoredMessages = queue.statistics().value("queuedMessages").toInt();
+    const int trackedMessages = 2 * g_maxBatchSize + 1;
+    QByteArray event = mixEvent->stdTrackEvent("Transport", QVariantMap());
+    for (int i = 0; i < trackedMessages; ++i)
+        queue.recordEventMessage(event);
+
+    queue.postToServer();
+    QCOMPARE(transport->messageCount(), qint64(0));
+    QCOMPARE(queue.statistics().value("queuedMessages").toInt(), restoredMessages + trackedMessages);
+
+    transport->setResult(MixpanelTransport::Accepted);
+    queue.postToServer();
+    QCOMPARE(transport->messageCount(), qint64(restoredMessages + trackedMessages));
+    QVERIFY(transport->batchCount() >= 3);
+    QCOMPARE(queue.statistics().value("queuedMessages").toInt(), 0);
+    QCOMPARE(queue.statistics().value("inFlightMessages").toInt(), 0);
+
+    config.setMaxQueuedMessages(1);
+    MixpanelMessageQueue fullQueue(NULL, config);
+    fullQueue.setTransport(new MixpanelMemoryTransport);
+    fullQueue.recordEventMessage(event);
+    QCOMPARE(fullQueue.admit("Transport"), MixpanelMessageQueue::Rejected);
+    QCOMPARE(fullQueue.statistics().value("rejectedEvents").toLongLong(), qint64(1));
+    QCOMPARE(fullQueue.statistics().value("droppedMessages").toLongLong(), qint64(0));
+    fullQueue.postToServer();
+}
+
+void MixpanelModuleTest::testBatchController()
+{
+    MixpanelBatchController controller;
+    controller.setLimits(5, 40, 3);
+    QCOMPARE(controller.batchSize(), g_initialBatchSize);
+    QCOMPARE(controller.window(), 1);
+
+    for (int i = 0; i < 20; ++i)
+        controller.batchAccepted(100);
+    QCOMPARE(controller.batchSize(), 40);
+    QCOMPARE(controller.window(), 3);
+
+    controller.batchAccepted(500);
+    QCOMPARE(controller.batchSize(), 40);
+    QCOMPARE(controller.smoothedRoundTripTime(), qint64(150));
+
+    controller.batchTooLarge();
+    QCOMPARE(controller.batchSize(), 20);
+    QCOMPARE(controller.window(), 3);
+
+    controller.batchThrottled();
+    QCOMPARE(controller.batchSize(), 20);
+    QCOMPARE(controller.window(), 1);
+
+    controller.batchTimedOut();
+    controller.batchTimedOut();
+    QCOMPARE(controller.batchSize(), 5);
+    QCOMPARE(controller.window(), 1);
+    QCOMPARE(controller.backOffs(), qint64(4));
+
+    controller.batchAccepted(800);
+    QCOMPARE(controller.batchSize(), 10);
+    QCOMPARE(controller.window(), 2);
+
+    MixpanelBatchController cachedReply;
+    cachedReply.setLimits(5, 40, 3);
+    cachedReply.batchAccepted(0);
+    for (int i = 0; i < 20; ++i)
+        cachedReply.batchAccepted(100);
+    QCOMPARE(cachedReply.batchSize(), 40);
+    QCOMPARE(cachedReply.window(), 3);
+}
+
+void MixpanelModuleTest::testImportSources()
+{
+    QDateTime recordTime(QDate(2026, 1, 15), QTime(10, 30), Qt::UTC);
+    JsonDataAccess dataAccess;
+
+    QVariantMap importedEvent = dataAccess.loadFromBuffer(mixEvent->stdImportEvent("Backfill", QVariantMap(), recordTime)).toMap();
+    QCOMPARE(importedEvent.value("event").toString(), QString("Backfill"));
+    QCOMPARE(importedEvent.value("properties").toMap().value("time").toLongLong(), recordTime.toMSecsSinceEpoch());
+    QVERIFY(importedEvent.value("properties").toMap().contains("$insert_id"));
+
+    MixpanelListImportSource listSource;
+    listSource.append(mixEvent->stdImportEvent("Backfill", QVariantMap(), recordTime));
+    listSource.append(mixEvent->stdImportEvent("Backfill", QVariantMap(), recordTime.addSecs(60)));
+
+    QByteArray event;
+    QVERIFY(listSource.next(event));
+    QVERIFY(listSource.next(event));
+    QVERIFY(!listSource.next(event));
+
+    const QString filePath = QDir::tempPath() + "/mixpanel_import_test.ndjson";
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("{\"event\":\"A\"}\n\n{\"event\":\"B\"}\n");
+    file.close();
+
+    MixpanelFileImportSource fileSource(filePath);
+    QVERIFY(fileSource.isOpen());
+    QVERIFY(fileSource.next(event));
+    QCOMPARE(event, QByteArray("{\"event\":\"A\"}"));
+    QVERIFY(fileSource.next(event));
+    QCOMPARE(event, QByteArray("{\"event\":\"B\"}"));
+    QVERIFY(!fileSource.next(event));
+    QFile::remove(filePath);
+
+    QByteArray gzipData = MixpanelImporter::gzipCompress("123456789");
+    QCOMPARE(gzipData.left(3), QByteArray("\x1f\x8b\x08"));
+    QCOMPARE(gzipData.right(8), QByteArray("\x26\x39\xf4\xcb\x09\x00\x00\x00", 8));
+}
+
+void MixpanelModuleTest::testVerboseResponse()
+{
+    QVariantList recordErrors;
+    QCOMPARE(MixpanelHttpTransport::parseResponse("1", recordErrors), MixpanelTransport::Accepted);
+    QCOMPARE(MixpanelHttpTransport::parseResponse("0", recordErrors), MixpanelTransport::Rejected);
+    QCOMPARE(MixpanelHttpTransport::parseResponse("{\"status\":1,\"error\":null}", recordErrors), MixpanelTransport::Accepted);
+    QCOMPARE(MixpanelHttpTransport::parseResponse("{\"status\":0,\"error\":\"data, missing or empty\"}", recordErrors), MixpanelTransport::Rejected);
+    QCOMPARE(MixpanelHttpTransport::parseResponse(" ", recordErrors), MixpanelTransport::Failed);
+    QCOMPARE(MixpanelHttpTransport::parseResponse("<html>Gateway</html>", recordErrors), MixpanelTransport::Failed);
+    QVERIFY(recordErrors.isEmpty());
+
+    QByteArray partialReply("{\"code\":400,\"num_records_imported\":2,\"status\":\"Bad Request\","
+                            "\"failed_records\":[{\"index\":1,\"$insert_id\":\"a1\",\"field\":\"properties.time\",\"message\":\"'properties.time' is invalid\"}]}");
+    QCOMPARE(MixpanelHttpTransport::parseResponse(partialReply, recordErrors), MixpanelTransport::PartiallyAccepted);
+    QCOMPARE(recordErrors.size(), 1);
+    QCOMPARE(recordErrors.first().toMap().value("index").toInt(), 1);
+
+    recordErrors.clear();
+    partialReply.replace("\"num_records_imported\":2", "\"num_records_imported\":0");
+    QCOMPARE(MixpanelHttpTransport::parseResponse(partialReply, recordErrors), MixpanelTransport::Rejected);
+    QCOMPARE(recordErrors.size(), 1);
+
+    MixpanelConfiguration config = mixpanelConfig;
+    config.setFlushMechanism(MixpanelConfiguration::Manual);
+    MixpanelMessageQueue queue(NULL, config);
+    queue.clearDeadLetters();
+
+    MixpanelMemoryTransport* transport = new MixpanelMemoryTransport;
+    transport->setResult(MixpanelTransport::PartiallyAccepted);
+    transport->setRecordErrors(recordErrors);
+    queue.setTransport(transport);
+
+    QSignalSpy quarantinedSpy(&queue, SIGNAL(messagesQuarantined(int)));
+    const int restoredMessages = queue.statistics().value("queuedMessages").toInt();
+    QByteArray event = mixEvent->stdTrackEvent("Verbose", QVariantMap());
+    for (int i = 0; i < 3; ++i)
+        queue.recordEventMessage(event);
+    queue.postToServer();
+
+    QCOMPARE(queue.statistics().value("queuedMessages").toInt(), 0);
+    QVERIFY(transport->messageCount() >= 2);
+    QVERIFY(quarantinedSpy.count() >= 1);
+    QCOMPARE(queue.deadLetters().size(), quarantinedSpy.count());
+    QCOMPARE(queue.deadLetters().first().toMap().value("error").toString(), QString("'properties.time' is invalid"));
+    QCOMPARE(transport->messageCount() + queue.deadLetters().size(), qint64(restoredMessages + 3));
+
+    queue.clearDeadLetters();
+    QCOMPARE(queue.statistics().value("deadLetters").toInt(), 0);
+
+    config.setMinBatchSize(2);
+    config.setMaxBatchSize(2);
+    MixpanelMessageQueue tooLargeQueue(NULL, config);
+    MixpanelMemoryTransport* tooLargeTransport = new MixpanelMemoryTransport;
+    tooLargeTransport->setResult(MixpanelTransport::TooLarge);
+    tooLargeQueue.setTransport(tooLargeTransport);
+
+    QSignalSpy tooLargeSpy(&tooLargeQueue, SIGNAL(messagesQuarantined(int)));
+    const int tooLargeMessages = tooLargeQueue.statistics().value("queuedMessages").toInt() + 3;
+    for (int i = 0; i < 3; ++i)
+        tooLargeQueue.recordEventMessage(event);
+    for (int i = 0; i < tooLargeMessages && tooLargeQueue.statistics().value("queuedMessages").toInt() > 0; ++i)
+        tooLargeQueue.postToServer();
+
+    QCOMPARE(tooLargeQueue.statistics().value("queuedMessages").toInt(), 0);
+    QCOMPARE(tooLargeSpy.count(), tooLargeMessages);
+    QCOMPARE(tooLargeQueue.deadLetters().first().toMap().value("error").toString(), QString("Message too large"));
+    QCOMPARE(tooLargeTransport->messageCount(), qint64(0));
+
+    tooLargeQueue.clearDeadLetters();
+
+    config.setMinBatchSize(1);
+    config.setMaxBatchSize(8);
+    MixpanelMessageQueue rejectedQueue(NULL, config);
+    MixpanelMemoryTransport* rejectingTransport = new MixpanelMemoryTransport;
+    rejectingTransport->setRejectedContent("Invalid marker");
+    rejectedQueue.setTransport(rejectingTransport);
+
+    QSignalSpy rejectedSpy(&rejectedQueue, SIGNAL(messagesQuarantined(int)));
+    const int rejectedQueueMessages = rejectedQueue.statistics().value("queuedMessages").toInt() + 8;
+    for (int i = 0; i < 7; ++i)
+        rejectedQueue.recordEventMessage(event);
+    rejectedQueue.recordEventMessage(mixEvent->stdTrackEvent("Invalid marker", QVariantMap()));
+    for (int i = 0; i < rejectedQueueMessages && rejectedQueue.statistics().value("queuedMessages").toInt() > 0; ++i)
+        rejectedQueue.postToServer();
+
+    QCOMPARE(rejectedQueue.statistics().value("queuedMessages").toInt(), 0);
+    QCOMPARE(rejectedSpy.count(), 1);
+    QCOMPARE(rejectedQueue.deadLetters().size(), 1);
+    QCOMPARE(rejectingTransport->messageCount(), qint64(rejectedQueueMessages - 1));
+
+    rejectedQueue.clearDeadLetters();
+}
+
+void MixpanelModuleTest::testMessageRetention()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 day = Q_INT64_C(86400000);
+    QByteArray content = MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent("Retention", QVariantMap()));
+
+    QList<MixpanelAnalyticsMessage> messages;
+    for (int i = 0; i < 6; ++i)
+    {
+        QVariantMap analyticsMap;
+        analyticsMap.insert("type", int(i % 2 == 0 ? MixpanelAnalyticsMessage::Event : MixpanelAnalyticsMessage::Profile));
+        analyticsMap.insert("content", content);
+        analyticsMap.insert("time", now - (6 - i) * day);
+        messages.append(MixpanelAnalyticsMessage(analyticsMap));
+    }
+
+    MixpanelSqliteMessageStore sqliteStore(sqliteTestDatabase());
+    for (int i = 0; i < messages.size(); ++i)
+    {
+        MixpanelAnalyticsMessage message(messages.at(i).toStorageMap());
+        sqliteStore.append(message);
+    }
+
+    sqliteStore.setRetention(day, 0, 2);
+    QList<MixpanelAnalyticsMessage> restored = sqliteStore.restore();
+    QCOMPARE(restored.size(), 1);
+    QCOMPARE(restored.first().type(), MixpanelAnalyticsMessage::Profile);
+    QCOMPARE(sqliteStore.trimmedMessages(), 4);
+    QCOMPARE(sqliteStore.expiredMessages(), 1);
+
+    MixpanelSettingsMessageStore settingsStore;
+    settingsStore.setRetention(3 * day, 4 * day + day / 2, 0);
+    settingsStore.save(messages);
+    QCOMPARE(settingsStore.expiredMessages(), 3);
+
+    restored = settingsStore.restore();
+    QCOMPARE(restored.size(), 3);
+    QCOMPARE(settingsStore.expiredMessages(), 3);
+    Q_FOREACH(MixpanelAnalyticsMessage message, restored)
+        QVERIFY(message.type() == MixpanelAnalyticsMessage::Profile || message.enqueueTime() >= now - 3 * day);
+
+    QVariantList legacyMessages;
+    for (int i = 0; i < 2; ++i)
+    {
+        QVariantMap legacyMap;
+        legacyMap.insert("type", int(i == 0 ? MixpanelAnalyticsMessage::Event : MixpanelAnalyticsMessage::Profile));
+        legacyMap.insert("content", mixEvent->stdTrackEvent("Legacy", QVariantMap()));
+        legacyMessages.append(legacyMap);
+    }
+    MixpanelSettings().setValue(g_analyticsMessagesKey, legacyMessages);
+
+    MixpanelSettingsMessageStore legacyStore;
+    legacyStore.setRetention(day, day, 0);
+    restored = legacyStore.restore();
+    QCOMPARE(restored.size(), 2);
+    QCOMPARE(legacyStore.expiredMessages(), 0);
+    QVERIFY(restored.first().enqueueTime() >= now);
+
+    MixpanelSettingsMessageStore("Retention token").save(messages);
+
+    MixpanelConfiguration config = mixpanelConfig;
+    config.setFlushMechanism(MixpanelConfiguration::Manual);
+    config.setStorageEngine(MixpanelConfiguration::SettingsStorage);
+    config.setToken("Retention token");
+    config.setEventTtl(3 * day + day / 2);
+    config.setProfileTtl(3 * day + day / 2);
+
+    MixpanelMessageQueue queue(NULL, config);
+    QSignalSpy droppedSpy(&queue, SIGNAL(messagesDropped(int)));
+    QCOMPARE(queue.statistics().value("queuedMessages").toInt(), 3);
+    QCoreApplication::processEvents();
+    QCOMPARE(droppedSpy.count(), 1);
+    QCOMPARE(droppedSpy.first().first().toInt(), 3);
+}
+
+void MixpanelModuleTest::testTimedEvents()
+{
+    const qint64 wallClock = QDateTime::currentMSecsSinceEpoch();
+    QVERIFY(qAbs(MixpanelClock::currentMSecsSinceEpoch() - wallClock) < 1000);
+
+    MixpanelEvent event(NULL);
+    event.persistentIdentity() = persistentIdentity;
+    QSignalSpy recorded(&event, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+
+    event.timeEvent("Checkout");
+    event.timeEvent("Download");
+    QCOMPARE(event.timers().size(), 2);
+
+    event.track("Checkout", QVariantMap());
+    event.track(MixpanelEventBuilder("Download"));
+    event.track("Checkout", QVariantMap());
+    QCOMPARE(recorded.count(), 3);
+    QCOMPARE(event.timers().size(), 0);
+
+    JsonDataAccess dataAccess;
+    QVariantMap checkout = dataAccess.loadFromBuffer(recorded.at(0).at(0).toByteArray()).toMap()["properties"].toMap();
+    QVariantMap download = dataAccess.loadFromBuffer(recorded.at(1).at(0).toByteArray()).toMap()["properties"].toMap();
+    QVariantMap untimed = dataAccess.loadFromBuffer(recorded.at(2).at(0).toByteArray()).toMap()["properties"].toMap();
+    QVERIFY(checkout.contains("$duration") && checkout["$duration"].toDouble() >= 0.0);
+    QVERIFY(download.contains("$duration") && download["$duration"].toDouble() >= 0.0);
+    QVERIFY(!untimed.contains("$duration"));
+
+    event.timeEvent("Paused");
+    event.sampler().setSampleRate("Paused", 0.0);
+    event.track("Paused", QVariantMap());
+    QCOMPARE(recorded.count(), 3);
+    QCOMPARE(event.timers().size(), 1);
+
+    event.sampler().removeRules("Paused");
+    event.track("Paused", QVariantMap());
+    QCOMPARE(recorded.count(), 4);
+    QVERIFY(dataAccess.loadFromBuffer(recorded.at(3).at(0).toByteArray()).toMap()["properties"].toMap().contains("$duration"));
+
+    MixpanelEventTimers timers(4);
+    for (int i = 0; i < 10; ++i)
+        timers.start(QString("Event %1").arg(i));
+
+    QCOMPARE(timers.size(), 4);
+    QCOMPARE(timers.discardedTimers(), qint64(6));
+    QCOMPARE(timers.take("Event 0"), qint64(-1));
+    QVERIFY(timers.take("Event 9") >= 0);
+    timers.cancel("Event 8");
+    QCOMPARE(timers.take("Event 8"), qint64(-1));
+    QCOMPARE(timers.size(), 2);
+
+    timers.clear();
+    QCOMPARE(qHash(QString("Ab")), qHash(QString("BR")));
+    timers.start("Ab");
+    QCOMPARE(timers.take("BR"), qint64(-1));
+    timers.cancel("BR");
+    QVERIFY(timers.take("Ab") >= 0);
+}
+
+void MixpanelModuleTest::testClockSkewCorrection()
+{
+    QCOMPARE(MixpanelHttpTransport::parseDate("Sun, 06 Nov 1994 08:49:37 GMT"), Q_INT64_C(784111777000));
+    QCOMPARE(MixpanelHttpTransport::parseDate("06 Nov 1994"), Q_INT64_C(0));
+
+    MixpanelClock::resetServerTime();
+
+    QVariantMap tricky;
+    tricky.insert("Note", "{\"time\":1}");
+    MixpanelAnalyticsMessage event(MixpanelAnalyticsMessage::Event, mixEvent->stdTrackEvent("Skewed", tricky));
+    MixpanelAnalyticsMessage profile(MixpanelAnalyticsMessage::Profile, mixPeople->stdPeopleMessage("$set", QVariantMap()));
+    MixpanelAnalyticsMessage restored(event.toStorageMap());
+    QCOMPARE(event.expandedContent(), event.content());
+
+    const qint64 skew = Q_INT64_C(3600000);
+    MixpanelClock::addServerTimeSample(MixpanelClock::currentMSecsSinceEpoch() + skew, 0);
+    QVERIFY(qAbs(MixpanelClock::serverTimeOffset() - skew) < 2000);
+
+    JsonDataAccess dataAccess;
+    QVariantMap original = dataAccess.loadFromBuffer(event.content()).toMap()["properties"].toMap();
+    QVariantMap corrected = dataAccess.loadFromBuffer(event.expandedContent()).toMap()["properties"].toMap();
+    QVERIFY(qAbs(corrected["time"].toLongLong() - original["time"].toLongLong() - skew / 1000) <= 2);
+    QCOMPARE(corrected["Note"].toString(), QString("{\"time\":1}"));
+
+    corrected = dataAccess.loadFromBuffer(restored.expandedContent()).toMap()["properties"].toMap();
+    QVERIFY(qAbs(corrected["time"].toLongLong() - original["time"].toLongLong() - skew / 1000) <= 2);
+
+    original = dataAccess.loadFromBuffer(profile.content()).toMap();
+    corrected = dataAccess.loadFromBuffer(profile.expandedContent()).toMap();
+    QVERIFY(qAbs(corrected["$time"].toLongLong() - original["$time"].toLongLong() - skew) < 2000);
+
+    MixpanelClock::resetServerTime();
+}
+
+void MixpanelModuleTest::testProfileCache()
+{
+    MixpanelPeople people(NULL);
+    people.persistentIdentity() = persistentIdentity;
+    people.profileCache().setMaxProfiles(2);
+    people.profileCache().clear();
+    QSignalSpy recorded(&people, SIGNAL(recordPeopleMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+
+    const QString distinctId = people.distinctId();
+    people.identify(distinctId);
+    people.identify(distinctId);
+    QCOMPARE(recorded.count(), 1);
+
+    QVariantMap properties;
+    properties.insert("Plan", "Free");
+    properties.insert("Logins", 3);
+    people.set(properties);
+    people.set(properties);
+    QCOMPARE(recorded.count(), 2);
+
+    properties.insert("Plan", "Premium");
+    people.set(properties);
+    QCOMPARE(recorded.count(), 3);
+
+    JsonDataAccess dataAccess;
+    QVariantMap changed = dataAccess.loadFromBuffer(recorded.last().at(0).toByteArray()).toMap()["$set"].toMap();
+    QCOMPARE(changed.value("Plan").toString(), QString("Premium"));
+    QVERIFY(!changed.contains("Logins"));
+
+    people.increment("Logins", 2);
+    people.setOnce("Plan", "Trial");
+    QCOMPARE(recorded.count(), 4);
+    QCOMPARE(people.cachedProperties().value("Logins").toDouble(), 5.0);
+    QCOMPARE(people.cachedProperties().value("Plan").toString(), QString("Premium"));
+
+    QVERIFY(people.profileCache().isDirty());
+    QVERIFY(!MixpanelProfileCache(2).contains(distinctId));
+    people.syncProfileCache();
+    QVERIFY(!people.profileCache().isDirty());
+
+    MixpanelProfileCache restored(2);
+    QCOMPARE(restored.properties(distinctId).value("Plan").toString(), QString("Premium"));
+
+    restored.set("Other user", QVariantMap());
+    restored.set("Another user", QVariantMap());
+    QVERIFY(!restored.contains(distinctId));
+    QVERIFY(restored.contains("Another user"));
+
+    restored.clear();
+    QVERIFY(MixpanelProfileCache(2).properties("Another user").isEmpty());
+}
+
+void MixpanelModuleTest::testStorageNamespaces()
+{
+    QVERIFY(MixpanelSettings::filePath(g_sqliteQueueFileName, QString()).endsWith("/mixpanel_queue.db"));
+    QVERIFY(MixpanelSettings::filePath(g_sqliteQueueFileName, "abc/123").endsWith("/mixpanel_queue_abc_123.db"));
+
+    MixpanelSettings("First token").setValue("Test key", 1);
+    MixpanelSettings("Second token").setValue("Test key", 2);
+    QCOMPARE(MixpanelSettings("First token").value("Test key").toInt(), 1);
+    QCOMPARE(MixpanelSettings("Second token").value("Test key").toInt(), 2);
+    QVERIFY(!MixpanelSettings().contains("Test key"));
+    MixpanelSettings("First token").remove("Test key");
+    MixpanelSettings("Second token").remove("Test key");
+
+    MixpanelProfileCache firstCache(2);
+    firstCache.setStorageNamespace("First token");
+    firstCache.clear();
+    MixpanelProfileCache secondCache(2);
+    secondCache.setStorageNamespace("Second token");
+    secondCache.clear();
+
+    QVariantMap properties;
+    properties.insert("Plan", "Free");
+    firstCache.set("Shared user", properties);
+    firstCache.sync();
+
+    MixpanelProfileCache restored(2);
+    restored.setStorageNamespace("First token");
+    QCOMPARE(restored.properties("Shared user").value("Plan").toString(), QString("Free"));
+    restored.setStorageNamespace("Second token");
+    QVERIFY(!restored.contains("Shared user"));
+    firstCache.clear();
+
+    MixpanelUploadScheduler& scheduler = MixpanelUploadScheduler::instance();
+    QVERIFY(MixpanelUploadScheduler::exists());
+    QVERIFY(!scheduler.parent());
+    QCOMPARE(scheduler.maxRequests(), g_maxSharedRequests);
+    scheduler.setMaxRequests(0);
+    QCOMPARE(scheduler.maxRequests(), g_maxSharedRequests);
+    QCOMPARE(scheduler.waitingRequests(), 0);
+    QVERIFY(!scheduler.cancel(NULL, 1));
+}
+
+void MixpanelModuleTest::testThreadStaging()
+{
+    MixpanelThreadStaging staging;
+    QSignalSpy merged(&staging, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+
+    MixpanelPersistentIdentity identity = persistentIdentity.snapshot();
+    QVariantMap superProperties;
+    superProperties.insert("Build", "Threads");
+    identity.registerSuperProperties(superProperties);
+    staging.publish(identity, MixpanelEventSampler(), 0, 0);
+
+    trackFromThreads(staging, 4, 50);
+    QCOMPARE(staging.threads(), 0);
+
+    staging.merge();
+    QCOMPARE(merged.count(), 200);
+    QCOMPARE(staging.mergedMessages(), Q_INT64_C(200));
+
+    JsonDataAccess dataAccess;
+    QVector<int> nextIndex(4, 0);
+    for (int i = 0; i < merged.count(); ++i)
+    {
+        const QVariantMap properties = dataAccess.loadFromBuffer(merged.at(i).at(0).toByteArray()).toMap()["properties"].toMap();
+        QCOMPARE(properties.value("Build").toString(), QString("Threads"));
+        QCOMPARE(properties.value("token").toString(), persistentIdentity.token());
+
+        const int thread = properties.value("Thread").toInt();
+        QCOMPARE(properties.value("Index").toInt(), nextIndex[thread]++);
+    }
+
+    QVERIFY(!persistentIdentity.eventSuperProperties().contains("Build"));
+    QVERIFY(staging.mergedChunks() >= 4);
+
+    // A chunk waits until it is handed off
+    merged.clear();
+    staging.event().track("Staged event", QVariantMap());
+    staging.merge();
+    QCOMPARE(merged.count(), 0);
+
+    staging.requestHandOff();
+    staging.event().track("Handed off event", QVariantMap());
+    staging.merge();
+    QCOMPARE(merged.count(), 2);
+    QCOMPARE(dataAccess.loadFromBuffer(merged.at(0).at(0).toByteArray()).toMap()["event"].toString(), QString("Staged event"));
+
+    merged.clear();
+    staging.event().track("Urgent event", QVariantMap(), MixpanelAnalyticsMessage::HighPriority);
+    staging.merge();
+    QCOMPARE(merged.count(), 1);
+
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Accepted);
+    staging.setAdmission(MixpanelMessageQueue::Rejected, 2);
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Rejected);
+    staging.setAdmission(MixpanelMessageQueue::Sampled, 2);
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Accepted);
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Sampled);
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Accepted);
+    staging.setAdmission(MixpanelMessageQueue::Accepted, 2);
+    QCOMPARE(staging.admit("Shed event"), MixpanelMessageQueue::Accepted);
+    QCOMPARE(staging.rejectedEvents(), Q_INT64_C(1));
+    QCOMPARE(staging.sampledEvents(), Q_INT64_C(1));
+}
+
+void MixpanelModuleTest::testArenaAllocations()
+{
+    MixpanelEvent event(NULL);
+    event.persistentIdentity() = persistentIdentity.snapshot();
+
+    MixpanelSlabSink sink(1024 * 1024);
+    event.setSink(&sink);
+
+    const QString name("Arena event");
+    QVariantMap properties;
+    properties.insert("Level Number", 9);
+    properties.insert("Score", 0.25);
+    properties.insert("Sound", true);
+    properties.insert("Player", QString::fromUtf8("Zo\xc3\xab \"\xf0\x9f\x8e\xae\""));
+
+    MixpanelEventBuilder builder(name);
+    builder.add("Level Number", 9).add("Score", 0.25).add("Player", "Zoe");
+
+    for (int i = 0; i < 10; ++i)
+    {
+        event.track(name, properties);
+        event.track(builder);
+    }
+
+    g_allocations.fetchAndStoreRelaxed(0);
+    g_countAllocations = true;
+    for (int i = 0; i < 1000; ++i)
+    {
+        event.track(name, properties);
+        event.track(builder);
+    }
+    g_countAllocations = false;
+
+    QCOMPARE(int(g_allocations), 0);
+    QCOMPARE(sink.messages(), 2020);
+
+    JsonDataAccess dataAccess;
+    const QVariantMap message = dataAccess.loadFromBuffer(sink.lastMessage()).toMap();
+    QCOMPARE(dataAccess.hasError(), false);
+    QCOMPARE(message.value("event").toString(), name);
+    QCOMPARE(message["properties"].toMap().value("Player").toString(), QString("Zoe"));
+    QCOMPARE(message["properties"].toMap().value("token").toString(), persistentIdentity.token());
+
+    event.setSink(NULL);
+    QSignalSpy recorded(&event, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+    event.track(name, properties);
+    QCOMPARE(recorded.count(), 1);
+
+    const QVariantMap mapMessage = dataAccess.loadFromBuffer(recorded.at(0).at(0).toByteArray()).toMap();
+    QCOMPARE(mapMessage["properties"].toMap().value("Player").toString(), properties.value("Player").toString());
+    QCOMPARE(mapMessage["properties"].toMap().value("Score").toDouble(), 0.25);
+}
+
+void MixpanelModuleTest::testMessageRing()
+{
+    MixpanelMessageRing ring;
+    QList<MixpanelAnalyticsMessage> expected;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        const int size = i % 500 == 0 ? g_messageSlabSize + i : i % 97;
+        MixpanelAnalyticsMessage message(i < 1500 ? MixpanelAnalyticsMessage::Event : MixpanelAnalyticsMessage::Profile,
+                                         QByteArray(size, char('a' + i % 26)), MixpanelAnalyticsMessage::NormalPriority,
+                                         Q_INT64_C(1400000000000) + i, i % 3 == 0 ? -1 : i);
+        message.setStorageId(i);
+        ring.append(message);
+        expected.append(message);
+    }
+
+    QCOMPARE(ring.size(), 2000);
+    QVERIFY(ring.slabs() > 4);
+    QCOMPARE(ring.messages().size(), 2000);
+
+    MixpanelMessageBatch firstBatch = ring.take(1000);
+    QCOMPARE(firstBatch.size(), 1000);
+    QList<int> requeuedRecords;
+    for (int i = 500; i < firstBatch.size(); ++i)
+        requeuedRecords.append(i);
+    ring.prepend(firstBatch.records(requeuedRecords));
+    QList<MixpanelAnalyticsMessage> batch = firstBatch.messages().mid(0, 500);
+
+    while (!ring.isEmpty())
+    {
+        const MixpanelAnalyticsMessage::MessageType type = ring.firstType();
+        const MixpanelMessageBatch next = ring.take(700);
+        QVERIFY(next.size() <= 700);
+        QCOMPARE(next.type(), type);
+        Q_FOREACH(MixpanelAnalyticsMessage message, next.messages())
+            QCOMPARE(message.type(), type);
+        batch.append(next.messages());
+    }
+
+    QCOMPARE(batch.size(), expected.size());
+    for (int i = 0; i < batch.size(); ++i)
+    {
+        QCOMPARE(batch.at(i).content(), expected.at(i).content());
+        QCOMPARE(batch.at(i).type(), expected.at(i).type());
+        QCOMPARE(batch.at(i).enqueueTime(), expected.at(i).enqueueTime());
+        QCOMPARE(batch.at(i).enqueueClock(), expected.at(i).enqueueClock());
+        QCOMPARE(batch.at(i).storageId(), expected.at(i).storageId());
+    }
+
+    QCOMPARE(ring.bytes(), Q_INT64_C(0));
+    QCOMPARE(ring.slabs(), 0);
+
+    QStringList eventNames;
+    eventNames << "First" << "Second" << "Third";
+    Q_FOREACH(QString eventName, eventNames)
+    {
+        QByteArray content = MixpanelStringPool::instance().compact(mixEvent->stdTrackEvent(eventName, QVariantMap()));
+        ring.append(MixpanelAnalyticsMessage::Event, MixpanelAnalyticsMessage::HighPriority, content, Q_INT64_C(1400000000000), -1, 7);
+    }
+
+    MixpanelMessageBatch eventBatch = ring.take(10);
+    QCOMPARE(eventBatch.size(), 3);
+    QCOMPARE(eventBatch.priority(), MixpanelAnalyticsMessage::HighPriority);
+    QCOMPARE(eventBatch.storageIds(), QList<qint64>() << 7 << 7 << 7);
+    QCOMPARE(eventBatch.enqueueTime(2), Q_INT64_C(1400000000000));
+
+    QByteArray postData;
+    QNetworkRequest request = eventBatch.toNetworkRequest(postData);
+    QCOMPARE(request.url(), QUrl(g_urlTrackEvent));
+    QVERIFY(postData.startsWith("data="));
+
+    JsonDataAccess dataAccess;
+    QVariantList sentEvents = dataAccess.loadFromBuffer(QByteArray::fromBase64(QByteArray::fromPercentEncoding(postData.mid(5)))).toList();
+    QCOMPARE(sentEvents.size(), 3);
+    for (int i = 0; i < sentEvents.size(); ++i)
+    {
+        QCOMPARE(sentEvents.at(i).toMap().value("event").toString(), eventNames.at(i));
+        QCOMPARE(dataAccess.loadFromBuffer(eventBatch.expandedContent(i)).toMap().value("event").toString(), eventNames.at(i));
+    }
+}
+
+void MixpanelModuleTest::testNumberFormatting()
+{
+    const double values[] = { 0.0, 0.1, 0.1 + 0.2, -2.5, 59.5, 100.0, 1e17, 1e21, 0.0001, 0.00001, 5e-324, 1.7976931348623157e308 };
+    const char* expected[] = { "0", "0.1", "0.30000000000000004", "-2.5", "59.5", "100", "100000000000000000", "1e+21",
+                               "0.0001", "1e-05", "5e-324", "1.7976931348623157e+308" };
+
+    for (int i = 0; i < int(sizeof(values) / sizeof(values[0])); ++i)
+    {
+        QByteArray json;
+        MixpanelJsonWriter::appendNumber(json, values[i]);
+        QCOMPARE(json, QByteArray(expected[i]));
+    }
+
+    QByteArray json;
+    MixpanelJsonWriter::appendNumber(json, std::numeric_limits<qint64>::min());
+    json.append(',');
+    MixpanelJsonWriter::appendNumber(json, std::numeric_limits<quint64>::max());
+    json.append(',');
+    MixpanelJsonWriter::appendNumber(json, qSNaN());
+    json.append(',');
+    MixpanelJsonWriter::appendNumber(json, -qInf());
+    QCOMPARE(json, QByteArray("-9223372036854775808,18446744073709551615,null,null"));
+
+    qsrand(49);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const quint64 bits = (quint64(qrand()) << 42) ^ (quint64(qrand()) << 21) ^ quint64(qrand());
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (qIsNaN(value) || qIsInf(value))
+            continue;
+
+        json.clear();
+        MixpanelJsonWriter::appendNumber(json, value);
+        QVERIFY(json.size() <= 25);
+        QCOMPARE(json.toDouble(), value);
+    }
+
+    QVariantMap properties;
+    properties.insert("Balance", 0.1);
+    properties.insert("Ratio", qQNaN());
+    const QVariantMap increment = JsonDataAccess().loadFromBuffer(mixPeople->stdPeopleMessage("$add", properties)).toMap()["$add"].toMap();
+    QCOMPARE(increment.value("Balance").toDouble(), 0.1);
+    QVERIFY(increment.contains("Ratio") && increment.value("Ratio").isNull());
+
+    QVariantHash details;
+    details.insert("Level", 3);
+    QVariantList variants;
+    variants << QVariant(2.5f) << QVariant::fromValue(short(-7)) << QVariant::fromValue(ushort(7)) << QVariant::fromValue(char(65))
+             << QVariant::fromValue(uchar(200)) << QVariant::fromValue(long(-9)) << QVariant::fromValue(ulong(9)) << QVariant(details);
+    json.clear();
+    QVERIFY(MixpanelJsonWriter::appendVariant(json, variants));
+    QCOMPARE(json, QByteArray("[2.5,-7,7,65,200,-9,9,{\"Level\":3}]"));
+}
+
+void MixpanelModuleTest::testUnicodeValidation()
+{
+    const QString text = QString::fromUtf8("Search: \"caf\xc3\xa9\" \\ \xf0\x9f\x98\x80\n") + QString(300, QChar('a'));
+
+    QByteArray json;
+    QVERIFY(MixpanelJsonWriter::appendString(json, text));
+    QCOMPARE(JsonDataAccess().loadFromBuffer("[" + json + "]").toList().value(0).toString(), text);
+
+    QByteArray utf8Json;
+    QVERIFY(MixpanelJsonWriter::appendUtf8String(utf8Json, text.toUtf8()));
+    QCOMPARE(utf8Json, json);
+
+    const ushort loneSurrogate[] = { 'a', 0xd83d, 'b', 0xde00 };
+    json.clear();
+    QVERIFY(!MixpanelJsonWriter::appendString(json, QString::fromUtf16(loneSurrogate, 4)));
+    QCOMPARE(json, QByteArray("\"a\xef\xbf\xbd" "b\xef\xbf\xbd\""));
+
+    const char* invalidUtf8[] = { "\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "abc\xe2\x82", "\x80" };
+    for (int i = 0; i < int(sizeof(invalidUtf8) / sizeof(invalidUtf8[0])); ++i)
+    {
+        json.clear();
+        QVERIFY(!MixpanelJsonWriter::appendUtf8String(json, QByteArray(invalidUtf8[i])));
+        QVERIFY(json.contains("\xef\xbf\xbd"));
+    }
+
+    MixpanelEvent event(NULL);
+    event.persistentIdentity() = persistentIdentity;
+    QSignalSpy recorded(&event, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+
+    QVariantMap properties;
+    properties.insert("Query", QString::fromUtf16(loneSurrogate, 2));
+    event.track("Search", properties);
+    event.track(MixpanelEventBuilder("Search").add("Query", QByteArray("\xed\xa0\x80")));
+    event.track(QString::fromUtf16(loneSurrogate, 2), QVariantMap());
+    QCOMPARE(recorded.count(), 0);
+    QVERIFY(event.stdTrackEvent("Search", properties).isEmpty());
+    QVERIFY(mixPeople->stdPeopleMessage("$set", properties).isEmpty());
+
+    event.track(MixpanelEventBuilder("Search").add("Query", text));
+    QCOMPARE(recorded.count(), 1);
+}
+
+void MixpanelModuleTest::testStringBufferBoundary()
+{
+    const QChar endings[] = { QChar(0x01), QChar('"'), QChar(0x20ac) };
+
+    for (int length = 240; length < 270; ++length)
+    {
+        for (int i = 0; i < int(sizeof(endings) / sizeof(endings[0])); ++i)
+        {
+            const QString text = QString(length, QChar('a')) + endings[i] + QChar(0x02);
+
+            QByteArray json;
+            QVERIFY(MixpanelJsonWriter::appendString(json, text));
+            QVERIFY(json.endsWith('"'));
+            QCOMPARE(JsonDataAccess().loadFromBuffer("[" + json + "]").toList().value(0).toString(), text);
+        }
+    }
+}
+
+void MixpanelModuleTest::testThreadStagingCollect()
+{
+    MixpanelThreadStaging staging;
+    QSignalSpy merged(&staging, SIGNAL(recordEventMessage(QByteArray,MixpanelAnalyticsMessage::Priority)));
+    staging.publish(persistentIdentity.snapshot(), MixpanelEventSampler(), 0, 0);
+
+    QSemaphore tracked;
+    QSemaphore released;
+    MixpanelIdleTrackingThread thread(staging, tracked, released);
+    thread.start();
+    tracked.acquire();
+
+    staging.merge();
+    QCOMPARE(merged.count(), 0);
+    QCOMPARE(staging.threads(), 1);
+
+    staging.collect();
+    QCOMPARE(merged.count(), 1);
+    staging.collect();
+    QCOMPARE(merged.count(), 1);
+
+    released.release();
+    thread.wait();
+    staging.merge();
+    QCOMPARE(merged.count(), 2);
+
+    JsonDataAccess dataAccess;
+    QCOMPARE(dataAccess.loadFromBuffer(merged.at(0).at(0).toByteArray()).toMap()["event"].toString(), QString("Before idle"));
+    QCOMPARE(dataAccess.loadFromBuffer(merged.at(1).at(0).toByteArray()).toMap()["event"].toString(), QString("After idle"));
+}
+
+void MixpanelModuleTest::benchmarkSettingsMessageStore()
+{
+    QList<MixpanelAnalyticsMessage> messages = benchmarkMessages();
+    MixpanelSettingsMessageStore store("Benchmark token");
+
+    QBENCHMARK_ONCE
+    {
+        Q_FOREACH(MixpanelAnalyticsMessage message, messages)
+            store.append(message);
+        store.save(messages);
+        QCOMPARE(store.restore().size(), g_benchmarkQueueSize);
+    }
+
+    MixpanelSettings("Benchmark token").remove("");
+}
+
+void MixpanelModuleTest::benchmarkSqliteMessageStore()
+{
+    QList<MixpanelAnalyticsMessage> messages = benchmarkMessages();
+    MixpanelSqliteMessageStore store(sqliteTestDatabase());
+
+    QBENCHMARK_ONCE
+    {
+        for (int i = 0; i < messages.size(); ++i)
+            store.append(messages[i]);
+        store.save(messages);
+        QCOMPARE(store.restore().size(), g_benchmarkQueueSize);
+    }
+
+    store.remove(messages);
+}
+
+void MixpanelModuleTest::benchmarkConcurrentTracking()
+{
+    const int threads = qMax(QThread::idealThreadCount(), 2);
+    const int events = 5000;
+
+    MixpanelThreadStaging staging;
+    staging.publish(persistentIdentity.snapshot(), MixpanelEventSampler(), 0, 0);
+
+    int mergedMessages = 0;
+    QBENCHMARK_ONCE
+    {
+        trackFromThreads(staging, threads, events);
+        staging.merge();
+        mergedMessages = int(staging.mergedMessages());
+    }
+
+    QCOMPARE(mergedMessages, threads * events);
+}
+
+void MixpanelModuleTest::benchmarkMessageRing()
+{
+    QList<MixpanelAnalyticsMessage> messages = benchmarkMessages();
+    MixpanelMessageRing ring;
+
+    QBENCHMARK_ONCE
+    {
+        for (int i = 0; i < messages.size(); ++i)
+            ring.append(messages.at(i));
+        while (!ring.isEmpty())
+            ring.take(50);
+    }
+
+    QCOMPARE(ring.slabs(), 0);
+}
+
+void MixpanelModuleTest::benchmarkNumericPayload()
+{
+    const QVariantMap properties = numericProperties();
+    QByteArray json;
+
+    QBENCHMARK
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            json.clear();
+            MixpanelJsonWriter::appendVariantMap(json, properties);
+        }
+    }
+
+    QVERIFY(!json.isEmpty());
+}
+
+void MixpanelModuleTest::benchmarkNumericJsonDataAccess()
+{
+    const QVariantMap properties = numericProperties();
+    JsonDataAccess dataAccess;
+    QByteArray json;
+
+    QBENCHMARK
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            json.clear();
+            dataAccess.saveToBuffer(properties, &json);
+        }
+    }
+
+    QVERIFY(!json.isEmpty());
+}
+
+void MixpanelModuleTest::benchmarkStringEscaping()
+{
+    const QString query = QString("error message with a \"quoted\" path C:\\data\\file.txt and plain text ").repeated(20);
+    QByteArray json;
+
+    QBENCHMARK
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            json.clear();
+            MixpanelJsonWriter::appendString(json, query);
+        }
+    }
+
+    QVERIFY(json.size() > query.size());
+}
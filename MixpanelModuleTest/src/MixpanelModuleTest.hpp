@@ -21,6 +21,37 @@ private slots:
     void testTrackSingleEvent();
     void testTrackEventProperties();
     void testMixpanelConfiguration();
+    void testTrackEventBuilder();
+    void testTrackEventSchema();
+    void testStringPool();
+    void testSqliteMessageStore();
+    void testEventSampler();
+    void testInsertIdDeduplication();
+    void testMessagePriority();
+    void testLatencyHistogram();
+    void testMemoryTransport();
+    void testBatchController();
+    void testImportSources();
+    void testVerboseResponse();
+    void testMessageRetention();
+    void testTimedEvents();
+    void testClockSkewCorrection();
+    void testProfileCache();
+    void testStorageNamespaces();
+    void testThreadStaging();
+    void testArenaAllocations();
+    void testMessageRing();
+    void testNumberFormatting();
+    void testUnicodeValidation();
+    void testStringBufferBoundary();
+    void testThreadStagingCollect();
+    void benchmarkSettingsMessageStore();
+    void benchmarkSqliteMessageStore();
+    void benchmarkConcurrentTracking();
+    void benchmarkMessageRing();
+    void benchmarkNumericPayload();
+    void benchmarkNumericJsonDataAccess();
+    void benchmarkStringEscaping();
 
 };
 